@@ -0,0 +1,83 @@
+/*
+ * Multi-threaded lookup benchmark: many threads read the same dictionary.
+ * Lookups don't write anything, so the rate should grow with number of
+ * threads almost linearly (until threads exceed CPU cores).
+ *
+ * Usage: mtbench [max threads] [sections] [keys in section]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "iniparser.h"
+
+#define NLOOKUPS    (2000000)   // lookups per thread
+
+static dictionary * ini ;
+static char      ** keys ;
+static size_t       nkeys ;
+
+static double dtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void * reader(void * arg)
+{
+    unsigned long long x = (unsigned long long)(size_t)arg * 2654435761ULL + 1;
+    size_t i, found = 0;
+    for(i = 0; i < NLOOKUPS; ++i){
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17; // xorshift
+        if(dictionary_get(ini, keys[x % nkeys], NULL)) ++found;
+    }
+    return (void*)found;
+}
+
+int main(int argc, char * argv[])
+{
+    long maxthr = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nsec = 100, nkey = 100, i, j;
+    long nthr;
+    char buf[64];
+    double t1 = 0.;
+
+    if(argc > 1) maxthr = atol(argv[1]);
+    if(argc > 2) nsec = (size_t)atol(argv[2]);
+    if(argc > 3) nkey = (size_t)atol(argv[3]);
+    if(maxthr < 1 || nsec < 1 || nkey < 1){
+        fprintf(stderr, "Usage: %s [max threads] [sections] [keys in section]\n", argv[0]);
+        return 1;
+    }
+    ini = dictionary_new(0);
+    nkeys = nsec * nkey;
+    keys = malloc(nkeys * sizeof(char*));
+    if(!ini || !keys) return 1;
+    for(i = 0; i < nsec; ++i)
+        for(j = 0; j < nkey; ++j){
+            snprintf(buf, sizeof(buf), "section%zu:key%zu", i, j);
+            dictionary_set(ini, buf, "value");
+            keys[i * nkey + j] = strdup(buf);
+        }
+    printf("%zu sections x %zu keys, %d lookups per thread\n", nsec, nkey, NLOOKUPS);
+    printf("threads  Mlookups/s  speedup\n");
+    for(nthr = 1; nthr <= maxthr; nthr = (nthr * 2 > maxthr && nthr < maxthr) ? maxthr : nthr * 2){
+        pthread_t *thr = malloc(nthr * sizeof(pthread_t));
+        double t0 = dtime(), rate;
+        long k;
+        for(k = 0; k < nthr; ++k) pthread_create(&thr[k], NULL, reader, (void*)(size_t)(k + 1));
+        for(k = 0; k < nthr; ++k) pthread_join(thr[k], NULL);
+        rate = (double)NLOOKUPS * nthr / (dtime() - t0) / 1e6;
+        if(nthr == 1) t1 = rate;
+        printf("%7ld  %10.2f  %7.2f\n", nthr, rate, rate / t1);
+        free(thr);
+    }
+    for(i = 0; i < nkeys; ++i) free(keys[i]);
+    free(keys);
+    dictionary_del(ini);
+    return 0;
+}
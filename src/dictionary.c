@@ -16,6 +16,10 @@
  ---------------------------------------------------------------------------*/
 #include "dictionary.h"
 
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,27 +37,125 @@
 /** Invalid key token */
 #define DICT_INVALID_KEY    ((char*)-1)
 
+/** Minimal allocated number of slots in lookup index */
+#define IDXMINSZ    (16)
+
+/** Default thresholds for lookup strategy */
+static const dicttune_t tune_default = {
+    .linear_max = 8,
+    .hash_min   = 64,
+    .sort_ratio = 2,
+    .count_reads = 0
+};
+
+/** Size of output buffer of dump */
+#define DUMPBUFSZ   (1<<16)
+
+/** Minimal size of dump made by several threads */
+#define DUMPPARMIN  (1<<20)
+
+/** Width of key field in dump ("%-30s = %s\n") */
+#define DUMPKEYW    (30)
+
+/** Number of keys processed together by dictionary_get_batch() */
+#define BATCHSZ     (32)
+
+/** Hint to CPU to load memory at given address into cache */
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p)
+#endif
+
 #ifdef DEBUG
 #define DBG(...) do{ DBG(__VA_ARGS__); }while(0)
 #else
 #define DBG(...)
 #endif
 
-/**
-    Static object used for more quick work.
-    The idea is follow: usually user search objects in same section several
-    times, so if we test section hash in search function with hash of last
-    dictentry accessed, we can save a lot of time, especially in large
-    ini-files.
-
-*/
-static dictentry * de_last = NULL;
-static hash_t      hash_last = 0;
-
 /*---------------------------------------------------------------------------
                             Private functions
  ---------------------------------------------------------------------------*/
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compute hash of a string with given length
+  @param    key     string (not necessary zero-terminated)
+  @param    len     length of string
+  @param    lwc     ==1 to compute hash of lowercased string
+  @return   hash (see dictionary_hash())
+ */
+/*--------------------------------------------------------------------------*/
+static hash_t hash_n(const char * key, size_t len, int lwc)
+{
+    hash_t      hash ;
+    size_t      i ;
+
+    for (hash=0, i=0 ; i<len ; i++) {
+        if(lwc) hash += (hash_t)(char)tolower((int)key[i]) ;
+        else hash += (hash_t)key[i] ;
+        hash += (hash<<10);
+        hash ^= (hash>>6) ;
+    }
+    hash += (hash <<3);
+    hash ^= (hash >>11);
+    hash += (hash <<15);
+    return hash ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compare name of item with a string of given length
+  @param    name    name of key or section (NULL for deleted items)
+  @param    nlen    length of `name`
+  @param    s       string to compare with (not necessary zero-terminated)
+  @param    len     length of `s`
+  @param    lwc     ==1 to compare with lowercased `s`
+  @return   1 if equal, 0 otherwise
+ */
+/*--------------------------------------------------------------------------*/
+static int name_eq(const char * name, size_t nlen, const char * s, size_t len, int lwc)
+{
+    size_t i;
+    if(!name || nlen != len) return 0;
+    if(!lwc) return !memcmp(name, s, len);
+    for(i = 0; i < len; ++i)
+        if(name[i] != (char)tolower((int)s[i])) return 0;
+    return 1;
+}
+
+/** Header of string (strings are shared by dictionaries cloned, see dictionary_clone()) */
+typedef struct {
+    size_t          refs ;  /** Number of owners besides the first one */
+} strhdr;
+#define STRHDR(s)   ((strhdr*)((char*)(s) - sizeof(strhdr)))
+
+/** Copy `len` bytes of `s` into newly allocated zero-terminated string */
+static char *strdup_n(const char * s, size_t len)
+{
+    strhdr *h = malloc(sizeof(strhdr) + len + 1);
+    char *str;
+    if(!h) return NULL;
+    h->refs = 0;
+    str = (char*)(h + 1);
+    memcpy(str, s, len);
+    str[len] = 0;
+    return str;
+}
+
+/** Add owner of string made by strdup_n() */
+static char *str_ref(char * s)
+{
+    if(s) __atomic_add_fetch(&STRHDR(s)->refs, 1, __ATOMIC_RELAXED);
+    return s;
+}
+
+/** Release string made by strdup_n(): it is freed by the last owner */
+static void str_free(void * s)
+{
+    if(s && !__atomic_fetch_sub(&STRHDR(s)->refs, 1, __ATOMIC_ACQ_REL)) free(STRHDR(s));
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Enlarge memory for dictionary entry by ENTMINSZ values
@@ -84,7 +186,7 @@ static int dictionary_grow(dictionary * d)
 {
     if(!d) return -2;
     size_t newlen = d->len + DICTMINSZ;
-    dictentry *new_e = realloc(d->entries, newlen * sizeof(dictentry));
+    dictentry **new_e = realloc(d->entries, newlen * sizeof(dictentry*));
     /* An allocation failed, leave the entry unchanged */
     if(!new_e) return -1;
     d->entries = new_e;
@@ -92,6 +194,542 @@ static int dictionary_grow(dictionary * d)
     return 0;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Choose lookup strategy for a list
+  @param    x   current index of list
+  @param    n   size of list
+  @param    t   thresholds
+  @return   lookup strategy
+
+  Middle-sized lists get sorted index. If lookups are counted, they switch
+  to sorted index after `sort_ratio` reads per write and back to linear scan
+  when writes become twice as frequent (so the list don't jumps between
+  modes at every access).
+ */
+/*--------------------------------------------------------------------------*/
+static dictmode_t dictindex_choose(const dictindex * x, size_t n, const dicttune_t * t)
+{
+    size_t ratio;
+    if(n <= t->linear_max) return DICT_LINEAR;
+    if(n >= t->hash_min) return DICT_HASHED;
+    if(!t->count_reads) return DICT_SORTED;
+    ratio = t->sort_ratio * (x->nwrite + 1);
+    if(x->mode == DICT_SORTED) ratio /= 2;
+    return (__atomic_load_n(&x->nread, __ATOMIC_RELAXED) >= ratio) ? DICT_SORTED : DICT_LINEAR;
+}
+
+/** Free memory of index; counters are kept */
+static void dictindex_free(dictindex * x)
+{
+    free(x->slots);
+    x->slots = NULL;
+    x->size = 0;
+    x->n = 0;
+    x->mode = DICT_LINEAR;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Allocate empty index
+  @param    x       index to allocate
+  @param    mode    lookup strategy
+  @param    n       number of items to store
+  @return   This function returns non-zero in case of failure
+ */
+/*--------------------------------------------------------------------------*/
+static int dictindex_alloc(dictindex * x, dictmode_t mode, size_t n)
+{
+    dictslot *s = NULL;
+    size_t i, size = 0;
+    if(mode == DICT_HASHED){ // power of 2, no more than half of slots used
+        for(size = IDXMINSZ; size < 2*n; size <<= 1);
+    }else if(mode == DICT_SORTED) size = n + IDXMINSZ;
+    if(size){
+        s = malloc(size * sizeof(dictslot));
+        if(!s) return -1;
+        if(mode == DICT_HASHED)
+            for(i = 0; i < size; ++i) s[i].pos = DICT_NOPOS;
+    }
+    free(x->slots);
+    x->slots = s;
+    x->size = size;
+    x->n = 0;
+    x->mode = mode;
+    return 0;
+}
+
+/** Put item into hash table without size check */
+static void dictindex_hashput(dictslot * s, size_t size, hash_t hash, size_t pos)
+{
+    size_t mask = size - 1, i = hash & mask;
+    while(s[i].pos != DICT_NOPOS) i = (i + 1) & mask;
+    s[i].hash = hash;
+    s[i].pos = pos;
+}
+
+/** Compare slots by hash, equal hashes - by position */
+static int cmpslots(const void *p1, const void *p2){
+    const dictslot *s1 = (const dictslot*)p1, *s2 = (const dictslot*)p2;
+    if(s1->hash < s2->hash) return -1;
+    else if(s1->hash > s2->hash) return 1;
+    else if(s1->pos < s2->pos) return -1;
+    else if(s1->pos > s2->pos) return 1;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Add item to index being rebuilt
+  @param    x       index allocated by dictindex_alloc()
+  @param    hash    hash of item
+  @param    pos     position of item in list
+
+  Sorted index should be finished by dictindex_finish() after all items added.
+ */
+/*--------------------------------------------------------------------------*/
+static void dictindex_fill(dictindex * x, hash_t hash, size_t pos)
+{
+    if(x->mode == DICT_HASHED){
+        dictindex_hashput(x->slots, x->size, hash, pos);
+    }else if(x->mode == DICT_SORTED){
+        x->slots[x->n].hash = hash;
+        x->slots[x->n].pos = pos;
+    }else return;
+    ++x->n;
+}
+
+/** Finish index rebuilding */
+static void dictindex_finish(dictindex * x)
+{
+    if(x->mode == DICT_SORTED && x->n > 1)
+        qsort((void*)x->slots, x->n, sizeof(dictslot), cmpslots);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Insert new item into index
+  @param    x       index to modify
+  @param    hash    hash of item
+  @param    pos     position of item in list
+  @return   This function returns non-zero in case of failure
+ */
+/*--------------------------------------------------------------------------*/
+static int dictindex_put(dictindex * x, hash_t hash, size_t pos)
+{
+    dictslot *s = x->slots;
+    size_t lo, hi, mid, i;
+    if(x->mode == DICT_HASHED){
+        if(2*(x->n + 1) > x->size){ // rehash into twice larger table
+            size_t newsize = x->size << 1;
+            s = malloc(newsize * sizeof(dictslot));
+            if(!s) return -1;
+            for(i = 0; i < newsize; ++i) s[i].pos = DICT_NOPOS;
+            for(i = 0; i < x->size; ++i)
+                if(x->slots[i].pos != DICT_NOPOS)
+                    dictindex_hashput(s, newsize, x->slots[i].hash, x->slots[i].pos);
+            free(x->slots);
+            x->slots = s;
+            x->size = newsize;
+        }
+        dictindex_hashput(s, x->size, hash, pos);
+    }else if(x->mode == DICT_SORTED){
+        if(x->n == x->size){
+            size_t newsize = x->size + x->size/2 + IDXMINSZ;
+            s = realloc(x->slots, newsize * sizeof(dictslot));
+            if(!s) return -1;
+            x->slots = s;
+            x->size = newsize;
+        }
+        lo = 0; hi = x->n;
+        while(lo < hi){ // insert after all items with same hash
+            mid = (lo + hi) / 2;
+            if(s[mid].hash <= hash) lo = mid + 1;
+            else hi = mid;
+        }
+        memmove(&s[lo+1], &s[lo], (x->n - lo) * sizeof(dictslot));
+        s[lo].hash = hash;
+        s[lo].pos = pos;
+    }else return 0;
+    ++x->n;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find first candidate with given hash in index
+  @param    x       index to search (not DICT_LINEAR)
+  @param    hash    hash of item
+  @param    cur     cursor for dictindex_next()
+  @return   position of item in list or DICT_NOPOS
+
+  Caller should check the name of item as hash collisions are possible.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t dictindex_first(const dictindex * x, hash_t hash, size_t * cur)
+{
+    const dictslot *s = x->slots;
+    size_t lo, hi, mid, mask;
+    if(!s) return DICT_NOPOS;
+    if(x->mode == DICT_HASHED){
+        mask = x->size - 1;
+        for(lo = hash & mask; s[lo].pos != DICT_NOPOS; lo = (lo + 1) & mask)
+            if(s[lo].hash == hash){
+                *cur = lo;
+                return s[lo].pos;
+            }
+        return DICT_NOPOS;
+    }
+    lo = 0; hi = x->n;
+    while(lo < hi){ // first item with given hash
+        mid = (lo + hi) / 2;
+        if(s[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    if(lo == x->n || s[lo].hash != hash) return DICT_NOPOS;
+    *cur = lo;
+    return s[lo].pos;
+}
+
+/** Find next candidate with given hash in index */
+static size_t dictindex_next(const dictindex * x, hash_t hash, size_t * cur)
+{
+    const dictslot *s = x->slots;
+    size_t i = *cur, mask;
+    if(x->mode == DICT_HASHED){
+        mask = x->size - 1;
+        for(i = (i + 1) & mask; s[i].pos != DICT_NOPOS; i = (i + 1) & mask)
+            if(s[i].hash == hash){
+                *cur = i;
+                return s[i].pos;
+            }
+        return DICT_NOPOS;
+    }
+    if(++i == x->n || s[i].hash != hash) return DICT_NOPOS;
+    *cur = i;
+    return s[i].pos;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Rebuild index of keys in dictionary entry
+  @param    e   entry to reindex
+  @param    t   thresholds
+  @param    force   ==1 to rebuild even if mode isn't changed
+  @return   This function returns non-zero in case of failure
+
+  On failure entry stays with linear scan.
+ */
+/*--------------------------------------------------------------------------*/
+static int dictentry_reindex(dictentry * e, const dicttune_t * t, int force)
+{
+    size_t i;
+    dictmode_t mode = dictindex_choose(&e->idx, e->n, t);
+    if(!force && mode == e->idx.mode) return 0;
+    if(dictindex_alloc(&e->idx, mode, e->n)){
+        dictindex_free(&e->idx);
+        return -1;
+    }
+    for(i = 0; i < e->n; ++i)
+        if(e->kvlist[i].key) dictindex_fill(&e->idx, e->kvlist[i].hash, i);
+    dictindex_finish(&e->idx);
+    return 0;
+}
+
+/** Rebuild index of entries in dictionary */
+static int dictionary_reindex(dictionary * d, int force)
+{
+    size_t i;
+    dictmode_t mode = dictindex_choose(&d->idx, d->n, &d->tune);
+    if(!force && mode == d->idx.mode) return 0;
+    if(dictindex_alloc(&d->idx, mode, d->n)){
+        dictindex_free(&d->idx);
+        return -1;
+    }
+    for(i = 0; i < d->n; ++i)
+        if(d->entries[i]->name) dictindex_fill(&d->idx, d->entries[i]->hash, i);
+    dictindex_finish(&d->idx);
+    return 0;
+}
+
+/** Rebuild all indexes after items were moved */
+static void dictorder_free(size_t ** order);
+static void dictionary_reindex_all(dictionary * d)
+{
+    size_t i;
+    d->last = DICT_NOPOS; // its position changed
+    if(d->noname){
+        dictentry_reindex(d->noname, &d->tune, 1);
+        dictorder_free(d->noname->order);
+    }
+    for(i = 0; i < d->n; ++i)
+        if(d->entries[i]->name){
+            dictentry_reindex(d->entries[i], &d->tune, 1);
+            dictorder_free(d->entries[i]->order);
+        }
+    dictionary_reindex(d, 1);
+    dictorder_free(d->order);
+}
+
+/** Name, hash and position of item (to build orders) */
+typedef struct {
+    const char *    name ;
+    hash_t          hash ;
+    size_t          pos ;
+} nameditem;
+
+static int cmpnamed(const void *p1, const void *p2){
+    return strcmp(((const nameditem*)p1)->name, ((const nameditem*)p2)->name);
+}
+
+static int cmphashed(const void *p1, const void *p2){
+    const nameditem *a = (const nameditem*)p1, *b = (const nameditem*)p2;
+    if(a->hash != b->hash) return (a->hash < b->hash) ? -1 : 1;
+    return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+/** Amount of memory (in size_t) allocated for order of `n` items: room for growing by dictorder_add() */
+static size_t dictorder_size(size_t n)
+{
+    size_t sz = 8;
+    while(sz < n) sz <<= 1;
+    return sz + 1;
+}
+
+/** Drop all orders of items (they will be built again when need) */
+static void dictorder_free(size_t ** order)
+{
+    int i;
+    for(i = 0; i < DICT_NORDERS; ++i){
+        free(order[i]);
+        order[i] = NULL;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build order of items and publish it
+  @param    items   names and positions of existing items (will be sorted)
+  @param    n       amount of items
+  @param    how     DICT_BYNAME or DICT_BYHASH
+  @param    order   where to store the order
+  @return   order or NULL if no memory
+
+  Queries are made on constant dictionary, so several readers could build
+  the order simultaneously: it's published atomically, and if another reader
+  was first, its order is used.
+ */
+/*--------------------------------------------------------------------------*/
+static const size_t * dictorder_publish(nameditem * items, size_t n, dictorder_t how, size_t ** order)
+{
+    size_t i, *expected = NULL, *o = malloc(dictorder_size(n) * sizeof(size_t));
+    if(!o) return NULL;
+    qsort(items, n, sizeof(nameditem), how == DICT_BYHASH ? cmphashed : cmpnamed);
+    o[0] = n;
+    for(i = 0; i < n; ++i) o[i+1] = items[i].pos;
+    if(!__atomic_compare_exchange_n(order, &expected, o, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+        free(o);
+        return expected;
+    }
+    return o;
+}
+
+/** Get order `how` of keys in entry (build it if need) */
+static const size_t * dictentry_order(const dictentry * de, dictorder_t how)
+{
+    size_t i, n = 0, *o = __atomic_load_n(&de->order[how], __ATOMIC_ACQUIRE);
+    nameditem *items;
+    if(o) return o;
+    if(!(items = malloc((de->n + 1) * sizeof(nameditem)))) return NULL;
+    for(i = 0; i < de->n; ++i){
+        if(!de->kvlist[i].key) continue; // deleted
+        items[n].name = de->kvlist[i].key;
+        items[n].hash = de->kvlist[i].hash;
+        items[n++].pos = i;
+    }
+    o = (size_t*)dictorder_publish(items, n, how, &((dictentry*)de)->order[how]);
+    free(items);
+    return o;
+}
+
+/** Get order `how` of entries in dictionary (build it if need) */
+static const size_t * dictionary_order(const dictionary * d, dictorder_t how)
+{
+    size_t i, n = 0, *o = __atomic_load_n(&d->order[how], __ATOMIC_ACQUIRE);
+    nameditem *items;
+    if(o) return o;
+    if(!(items = malloc((d->n + 1) * sizeof(nameditem)))) return NULL;
+    for(i = 0; i < d->n; ++i){
+        if(!d->entries[i]->name) continue; // deleted
+        items[n].name = d->entries[i]->name;
+        items[n].hash = d->entries[i]->hash;
+        items[n++].pos = i;
+    }
+    o = (size_t*)dictorder_publish(items, n, how, &((dictionary*)d)->order[how]);
+    free(items);
+    return o;
+}
+
+/** Item `pos` of list: key of `de` or section of `d` (if `de` is NULL) */
+static nameditem dictorder_item(const dictionary * d, const dictentry * de, size_t pos)
+{
+    nameditem it;
+    it.pos = pos;
+    if(de){
+        it.name = de->kvlist[pos].key;
+        it.hash = de->kvlist[pos].hash;
+    }else{
+        it.name = d->entries[pos]->name;
+        it.hash = d->entries[pos]->hash;
+    }
+    return it;
+}
+
+/** Place of item in order `o` (1-based: the first item not less than `it`) */
+static size_t dictorder_find(const dictionary * d, const dictentry * de, const size_t * o,
+                             dictorder_t how, const nameditem * it)
+{
+    int (*cmp)(const void*, const void*) = (how == DICT_BYHASH) ? cmphashed : cmpnamed;
+    size_t lo = 1, hi = o[0] + 1;
+    while(lo < hi){
+        size_t mid = (lo + hi) / 2;
+        nameditem m = dictorder_item(d, de, o[mid]);
+        if(cmp(&m, it) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Put new item into orders already built
+  @param    order   orders of list
+  @param    d       dictionary (for list of sections)
+  @param    de      entry (for list of keys) or NULL
+  @param    pos     position of new item in list
+
+  Item is inserted at place found by binary search, so orders aren't
+  rebuilt by the next query. If there's no memory, order is dropped.
+ */
+/*--------------------------------------------------------------------------*/
+static void dictorder_add(size_t ** order, const dictionary * d, const dictentry * de, size_t pos)
+{
+    nameditem it = dictorder_item(d, de, pos);
+    int how;
+    for(how = 0; how < DICT_NORDERS; ++how){
+        size_t i, n, *o = order[how];
+        if(!o) continue;
+        n = o[0];
+        if(dictorder_size(n + 1) != dictorder_size(n)){
+            size_t *no = realloc(o, dictorder_size(n + 1) * sizeof(size_t));
+            if(!no){
+                free(o);
+                order[how] = NULL;
+                continue;
+            }
+            order[how] = o = no;
+        }
+        i = dictorder_find(d, de, o, (dictorder_t)how, &it);
+        memmove(&o[i + 1], &o[i], (n + 1 - i) * sizeof(size_t));
+        o[i] = pos;
+        o[0] = n + 1;
+    }
+}
+
+/** Remove item from orders already built (call it before item is erased) */
+static void dictorder_del(size_t ** order, const dictionary * d, const dictentry * de, size_t pos)
+{
+    nameditem it = dictorder_item(d, de, pos);
+    int how;
+    for(how = 0; how < DICT_NORDERS; ++how){
+        size_t i, *o = order[how];
+        if(!o) continue;
+        for(i = dictorder_find(d, de, o, (dictorder_t)how, &it); i <= o[0] && o[i] != pos; ++i);
+        if(i > o[0]){ // not found: order is broken, rebuild it
+            free(o);
+            order[how] = NULL;
+            continue;
+        }
+        memmove(&o[i], &o[i + 1], (o[0] - i) * sizeof(size_t));
+        --o[0];
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compare beginning of name with prefix
+  @param    name    name of item
+  @param    p       prefix
+  @param    plen    length of prefix
+  @param    lwc     ==1 to compare with lowercased prefix
+  @return   <0, 0 or >0 as strncmp()
+ */
+/*--------------------------------------------------------------------------*/
+static int prefix_cmp(const char * name, const char * p, size_t plen, int lwc)
+{
+    size_t i;
+    for(i = 0; i < plen; ++i){
+        unsigned char c = (unsigned char)(lwc ? tolower((int)p[i]) : p[i]);
+        if((unsigned char)name[i] != c) return (int)(unsigned char)name[i] - (int)c;
+    }
+    return 0;
+}
+
+/** Match one character `c` of name by pattern `*pp` (not '*'), move `*pp` to next if matched */
+static int glob_char(const char ** pp, char c, int lwc)
+{
+    const char *p = *pp;
+    char pc = *p++;
+    if(pc == '['){
+        const char *start;
+        int neg = 0, ok = 0;
+        if(*p == '!' || *p == '^'){
+            neg = 1;
+            ++p;
+        }
+        for(start = p; *p && (*p != ']' || p == start); ++p){
+            char lo = lwc ? (char)tolower((int)*p) : *p, hi = lo;
+            if(p[1] == '-' && p[2] && p[2] != ']'){
+                hi = lwc ? (char)tolower((int)p[2]) : p[2];
+                p += 2;
+            }
+            if((unsigned char)c >= (unsigned char)lo && (unsigned char)c <= (unsigned char)hi) ok = 1;
+        }
+        if(!*p || ok == neg) return 0; // bad class or not matched
+        *pp = p + 1;
+        return 1;
+    }
+    if(pc != '?'){
+        if(pc == '\\' && *p) pc = *p++;
+        if(lwc) pc = (char)tolower((int)pc);
+        if(pc != c) return 0;
+    }
+    *pp = p;
+    return 1;
+}
+
+/** Check if name matches glob pattern (wildcards `*`, `?`, `[...]`) */
+static int glob_match(const char * p, const char * name, int lwc)
+{
+    const char *pstar = NULL, *nstar = NULL;
+    while(*name){
+        if(*p == '*'){ // remember position to return when next chars won't match
+            pstar = ++p;
+            nstar = name;
+            continue;
+        }
+        if(*p && glob_char(&p, *name, lwc)){
+            ++name;
+            continue;
+        }
+        if(!pstar) return 0;
+        p = pstar; // let previous '*' eat one more character
+        name = ++nstar;
+    }
+    while(*p == '*') ++p;
+    return *p == 0;
+}
+
 
 /*---------------------------------------------------------------------------
                             Function codes
@@ -110,23 +748,24 @@ static int dictionary_grow(dictionary * d)
 /*--------------------------------------------------------------------------*/
 hash_t dictionary_hash(const char * key)
 {
-    size_t      len ;
-    hash_t      hash ;
-    size_t      i ;
-
     if (!key)
         return 0 ;
+    return hash_n(key, strlen(key), 0);
+}
 
-    len = strlen(key);
-    for (hash=0, i=0 ; i<len ; i++) {
-        hash += (hash_t)key[i] ;
-        hash += (hash<<10);
-        hash ^= (hash>>6) ;
-    }
-    hash += (hash <<3);
-    hash ^= (hash >>11);
-    hash += (hash <<15);
-    return hash ;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compute the hash key for a string of given length.
+  @param    key     Character string (not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @return   the same hash as dictionary_hash() of zero-terminated string.
+ */
+/*--------------------------------------------------------------------------*/
+hash_t dictionary_hash_n(const char * key, size_t len)
+{
+    if (!key)
+        return 0 ;
+    return hash_n(key, len, 0);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -177,222 +816,1103 @@ dictionary * dictionary_new(size_t size)
     d = (dictionary*) calloc(1, sizeof(dictionary)) ;
 
     if (d) {
-        d->entries = calloc(size, sizeof(dictentry));
+        d->entries = calloc(size, sizeof(dictentry*));
         if(d->entries) d->len = size;
         d->noname = dictentry_new(0);
+        d->tune = tune_default;
+        d->last = DICT_NOPOS;
     }
     return d ;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Release string of dictionary
+  @param    d   dictionary object (or NULL)
+  @param    p   string to release
+
+  While new version is built by dictionary_update(), strings could be used
+  by readers of old version: they are stored in `d->garbage` instead of
+  freeing.
+ */
+/*--------------------------------------------------------------------------*/
+static void dict_release(dictionary * d, void * p)
+{
+    if(!p) return;
+    if(d && d->garbage){
+        d->garbage[d->ngarbage].p = p;
+        d->garbage[d->ngarbage++].fn = str_free;
+    }else str_free(p);
+}
+
+/** Delete content of dictentry, releasing its strings by dict_release() */
+static void dictentry_clear(dictionary * d, dictentry * e)
+{
+    size_t  i, n;
+    if(!e) return;
+    n = e->n;
+    for(i = 0; i < n; ++i){
+        keyval *k = &(e->kvlist[i]);
+        if(k){
+            dict_release(d, k->key);
+            dict_release(d, k->val);
+        }
+    }
+    free(e->kvlist);
+    dict_release(d, e->name);
+    dictindex_free(&e->idx);
+    dictorder_free(e->order);
+}
+
+/** Release dictentry shared by dictionaries: the last owner frees it */
+static void dictentry_put(void * p)
+{
+    dictentry *e = (dictentry*)p;
+    if(!e || __atomic_fetch_sub(&e->shared, 1, __ATOMIC_ACQ_REL)) return;
+    dictentry_clear(NULL, e);
+    free(e);
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Delete a dictionary object
   @param    d   dictionary object to deallocate.
   @return   void
 
-  Deallocate a dictionary object and all memory associated to it.
+  Deallocate a dictionary object and all memory associated to it.
+ */
+/*--------------------------------------------------------------------------*/
+void dictionary_del(dictionary * d)
+{
+    size_t  i, n;
+
+    if (d==NULL) return ;
+    n = d->n;
+    dictentry_put(d->noname);
+    for(i = 0; i < n; ++i)
+        dictentry_put(d->entries[i]);
+    free(d->entries);
+    dictindex_free(&d->idx);
+    dictorder_free(d->order);
+    dictionary_track(d, NULL);
+    free(d);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Delete a dictentry object
+  @param    e   dictentry object to deallocate.
+  @return   void
+
+  Deallocate a dictentry object.
+  WARNING! The dictentry e itself isn't deallocated!
+ */
+/*--------------------------------------------------------------------------*/
+void dictentry_del(dictentry * e)
+{
+    dictentry_clear(NULL, e);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Count lookup in a list
+  @param    x   index of list
+  @param    t   thresholds
+
+  Lookups are counted only if `t->count_reads` is set: by default readers
+  don't write anything, so lookups from many threads don't fight for
+  cache lines. Index isn't changed here: lookup strategy is changed by
+  insertions or dictionary_optimize().
+ */
+/*--------------------------------------------------------------------------*/
+static void dictindex_read(const dictindex * x, const dicttune_t * t)
+{
+    if(t->count_reads)
+        __atomic_fetch_add(&((dictindex*)x)->nread, 1, __ATOMIC_RELAXED);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Count insertion into a list
+  @param    x   index of list
+  @param    n   size of list (with new item)
+  @param    t   thresholds
+  @return   1 if lookup strategy should be changed, 0 otherwise
+ */
+/*--------------------------------------------------------------------------*/
+static int dictindex_write(dictindex * x, size_t n, const dicttune_t * t)
+{
+    ++x->nwrite;
+    return dictindex_choose(x, n, t) != x->mode;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find position of section in given dictionary
+  @param    d       dictionary object to search.
+  @param    hash    hash of section name.
+  @param    name    section name (not necessary zero-terminated).
+  @param    len     length of `name`.
+  @param    lwc     ==1 to compare with lowercased `name`.
+  @return   position of entry in d->entries or DICT_NOPOS
+
+  This function don't change anything: no counters nor cache.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t dictentry_lookup(const dictionary * d, hash_t hash, const char * name, size_t len, int lwc)
+{
+    dictentry **elist = d->entries;
+    size_t i, cur, L = d->n;
+    if(!elist) return DICT_NOPOS;
+    if(d->idx.mode != DICT_LINEAR){ // search in index
+        for(i = dictindex_first(&d->idx, hash, &cur); i != DICT_NOPOS;
+            i = dictindex_next(&d->idx, hash, &cur)){
+            /* Compare string, to avoid hash collisions */
+            if(name_eq(elist[i]->name, elist[i]->nlen, name, len, lwc)) return i;
+        }
+    }else{ // small list - direct lookup
+        for(i = 0; i < L; ++i){
+            if(elist[i]->hash == hash){
+            /* Compare string, to avoid hash collisions */
+                if(name_eq(elist[i]->name, elist[i]->nlen, name, len, lwc)) return i;
+            }
+        }
+    }
+    return DICT_NOPOS;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find position of key in dictionary entry
+  @param    de      dictionary entry to search.
+  @param    hash    hash of key name.
+  @param    key     key name (not necessary zero-terminated).
+  @param    len     length of `key`.
+  @param    lwc     ==1 to compare with lowercased `key`.
+  @return   position of key in de->kvlist or DICT_NOPOS
+
+  This function don't change anything: no counters nor cache.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t keyval_lookup(const dictentry * de, hash_t hash, const char * key, size_t len, int lwc)
+{
+    keyval *kvlist = de->kvlist;
+    size_t i, cur, L = de->n;
+    if(!kvlist) return DICT_NOPOS;
+    if(de->idx.mode != DICT_LINEAR){ // search in index
+        for(i = dictindex_first(&de->idx, hash, &cur); i != DICT_NOPOS;
+            i = dictindex_next(&de->idx, hash, &cur)){
+            /* Compare string, to avoid hash collisions */
+            if(name_eq(kvlist[i].key, kvlist[i].klen, key, len, lwc)) return i;
+        }
+    }else{ // small list - direct lookup
+        for(i = 0; i < L; ++i){
+            if(kvlist[i].hash == hash){
+            /* Compare string, to avoid hash collisions */
+                if(name_eq(kvlist[i].key, kvlist[i].klen, key, len, lwc)) return i;
+            }
+        }
+    }
+    return DICT_NOPOS;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find section and its position in given dictionary
+  @param    d       dictionary object to search.
+  @param    key     Entry to look for in the dictionary (not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+  @param    pos     If not NULL, position of entry found.
+  @return   pointer to entry or NULL
+ */
+/*--------------------------------------------------------------------------*/
+static dictentry * dictentry_findpos(const dictionary * d, const char * key, size_t len, int lwc, size_t * pos){
+    if(!d || !key || !d->entries) return NULL;
+    size_t i;
+    hash_t hash = hash_n(key, len, lwc);
+    DBG("search entry %.*s (%u)\n", (int)len, key, hash);
+    dictindex_read(&d->idx, &d->tune);
+    i = dictentry_lookup(d, hash, key, len, lwc);
+    if(i == DICT_NOPOS) return NULL;
+    if(pos) *pos = i;
+    return d->entries[i];
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find section to modify
+  @param    d       dictionary object to search.
+  @param    key     Entry name (not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    pos     Position of entry found.
+  @return   pointer to entry or NULL
+
+  Usually user sets many keys of the same section (e.g. when file is loaded),
+  so position of last section changed is kept in dictionary and checked
+  first. Only writer uses it: lookups don't change anything.
+ */
+/*--------------------------------------------------------------------------*/
+static dictentry * dictentry_findlast(dictionary * d, const char * key, size_t len, size_t * pos)
+{
+    dictentry *de;
+    if(d->last < d->n){
+        de = d->entries[d->last];
+        if(name_eq(de->name, de->nlen, key, len, 0)){
+            *pos = d->last;
+            return de;
+        }
+    }
+    if((de = dictentry_findpos(d, key, len, 0, pos))) d->last = *pos;
+    return de;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find section in given dictionary
+  @param    d       dictionary object to search.
+  @param    name    Entry to look for in the dictionary.
+  @return   pointer to entry or NULL
+
+  This function locates a section in dictionary `d` and returns pointer to it
+  or NULL if no entries found.
+ */
+/*--------------------------------------------------------------------------*/
+dictentry * dictentry_find(const dictionary * d, const char * key){
+    if(!key) return NULL;
+    return dictentry_findpos(d, key, strlen(key), 0, NULL);
+}
+
+/** Position of section in d->entries (DICT_NOPOS if not found) */
+size_t dictentry_pos(const dictionary * d, const char * key){
+    size_t pos;
+    if(!key || !dictentry_findpos(d, key, strlen(key), 0, &pos)) return DICT_NOPOS;
+    return pos;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find keyval object with given key name from a dictionary entry.
+  @param    de      dictionary entry to search.
+  @param    key     key to look for in the dictionary ("keyname", not necessary zero-terminated).
+  @param    len     length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+  @param    t       thresholds for lookup strategy
+  @return   pointer to keyval found or NULL
+
+  This function locates a key in a dictionary entry and returns a pointer to
+  keyval with given key value, or NULL if no such key can be found in.
+ */
+/*--------------------------------------------------------------------------*/
+static keyval *keyval_find(const dictentry * de, const char * key, size_t len, int lwc, const dicttune_t * t)
+{
+    size_t i;
+    if(!de || !key) return NULL;
+    dictindex_read(&de->idx, t);
+    i = keyval_lookup(de, hash_n(key, len, lwc), key, len, lwc);
+    return (i == DICT_NOPOS) ? NULL : &de->kvlist[i];
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in a dictionary.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for in the dictionary ("entryname:keyname").
+  @param    h       If not NULL, filled with position of key found.
+  @return   pointer to key/value pair or NULL if not found.
+
+  If key not found, `h` is filled with invalid position. The key/value pair
+  returned is internal to the dictionary, don't modify it.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_getkv(const dictionary * d, const char * key, dictkey * h)
+{
+    return dictionary_getkv_n(d, key, key ? strlen(key) : 0, 0, h);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in a dictionary by key of given length.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+  @param    h       If not NULL, filled with position of key found.
+  @return   pointer to key/value pair or NULL if not found.
+
+  The key isn't copied or modified, so it could be a part of larger buffer.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_getkv_n(const dictionary * d, const char * key, size_t len, int lwc, dictkey * h)
+{
+    const char *delim;
+    dictentry *de = NULL;
+    keyval *kv = NULL;
+    size_t sec = DICT_NOPOS;
+
+    if(h){
+        h->sec = h->pos = DICT_NOPOS;
+        h->gen = d ? d->gen : 0;
+    }
+    if(!d || !key) return NULL;
+    if((delim = memchr(key, ':', len))){
+        de = dictentry_findpos(d, key, (size_t)(delim - key), lwc, &sec);
+        len -= (size_t)(delim - key) + 1;
+        key = delim + 1;
+    }else de = d->noname;
+    if(!de) return NULL;
+    DBG("de name: %s\n", de->name);
+    kv = keyval_find(de, key, len, lwc, &d->tune);
+    DBG("kv %s found\n", kv ? "" : "not");
+    if(kv && h){
+        h->sec = sec;
+        h->pos = (size_t)(kv - de->kvlist);
+    }
+    return kv;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in given section of a dictionary.
+  @param    d       dictionary object containing `de`.
+  @param    de      section to search (d->noname or an item of d->entries).
+  @param    key     Key to look for in the section ("keyname").
+  @return   pointer to key/value pair or NULL if not found.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictentry_getkv(const dictionary * d, const dictentry * de, const char * key)
+{
+    if(!d || !key) return NULL;
+    return keyval_find(de, key, strlen(key), 0, &d->tune);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get key/value pair by resolved key.
+  @param    d       dictionary object to search.
+  @param    h       key resolved by dictionary_getkv().
+  @return   pointer to key/value pair or NULL if `h` is invalid or stale.
+
+  Access is direct: no strings are compared. NULL is returned if key
+  wasn't found when resolved, if it was deleted after this or if the
+  dictionary was sorted (so `h.gen` differs from `d->gen`).
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_keyval(const dictionary * d, dictkey h)
+{
+    const dictentry *de;
+    const keyval *kv;
+    if(!d || h.gen != d->gen || h.pos == DICT_NOPOS) return NULL;
+    if(h.sec == DICT_NOPOS) de = d->noname;
+    else if(h.sec < d->n) de = d->entries[h.sec];
+    else return NULL;
+    if(!de || h.pos >= de->n) return NULL; // deleted section
+    kv = &de->kvlist[h.pos];
+    return kv->key ? kv : NULL; // NULL for deleted key
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get a value from a dictionary.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for in the dictionary ("entryname:keyname").
+  @param    def     Default value to return if key not found.
+  @return   1 pointer to internally allocated character string.
+
+  This function locates a key in a dictionary and returns a pointer to its
+  value, or the passed 'def' pointer if no such key can be found in
+  dictionary. The returned character pointer points to data internal to the
+  dictionary object, you should not try to free it or modify it.
+  Value of key have format "entry:name" for key inside given entry, or just
+  "name" for keys from unnamed entry (d->noname).
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictionary_get(const dictionary * d, const char * key, const char * def)
+{
+    const keyval *kv = dictionary_getkv(d, key, NULL);
+    return kv ? kv->val : def;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get a value from a dictionary by key of given length.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    def     Default value to return if key not found.
+  @param    vlen    If not NULL, length of value returned.
+  @return   pointer to internally allocated character string.
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictionary_get_n(const dictionary * d, const char * key, size_t len, const char * def, size_t * vlen)
+{
+    const keyval *kv = dictionary_getkv_n(d, key, len, 0, NULL);
+    if(vlen) *vlen = kv ? kv->vlen : (def ? strlen(def) : 0);
+    return kv ? kv->val : def;
+}
+
+
+/** Key being searched by dictionary_get_batch() */
+typedef struct {
+    const char *    sec ;   /** Section name (NULL for unnamed section) */
+    const char *    key ;   /** Key name */
+    size_t          slen ;  /** Length of section name */
+    size_t          klen ;  /** Length of key name */
+    hash_t          shash ; /** Hash of section name */
+    hash_t          khash ; /** Hash of key name */
+    size_t          id ;    /** Index of key in array of keys */
+    const dictentry*de ;    /** Section found */
+    size_t          cur ;   /** Cursor of section index */
+    size_t          pos ;   /** Position of candidate in section */
+} batchkey;
+
+/** Compare keys by section to group them */
+static int cmpbatch(const void *p1, const void *p2){
+    const batchkey *b1 = (const batchkey*)p1, *b2 = (const batchkey*)p2;
+    if(b1->shash < b2->shash) return -1;
+    else if(b1->shash > b2->shash) return 1;
+    else if(b1->id < b2->id) return -1;
+    else if(b1->id > b2->id) return 1;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find values of BATCHSZ keys or less
+  @param    d       dictionary object to search.
+  @param    bk      keys (hashed)
+  @param    m       number of keys
+  @param    out     array for values found
+  @param    lwc     ==1 to compare with lowercased keys
+  @return   number of keys found
+
+  Keys are grouped by section, so each section searched once. Then all keys
+  are searched simultaneously in stages: when address of next memory to read
+  (slot of index, key/value pair, key name) is known for all keys, this
+  memory is prefetched, so its loading runs in parallel.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t batch_find(const dictionary * d, batchkey * bk, size_t m, const char ** out, int lwc)
+{
+    size_t i, found = 0;
+    batchkey *b, *prev = NULL;
+    const dictindex *x;
+
+    qsort((void*)bk, m, sizeof(batchkey), cmpbatch);
+    /* Sections */
+    if(d->idx.mode == DICT_HASHED)
+        for(i = 0, b = bk; i < m; ++i, ++b)
+            if(b->sec) PREFETCH(&d->idx.slots[b->shash & (d->idx.size - 1)]);
+    for(i = 0, b = bk; i < m; ++i, ++b){
+        if(!b->sec){
+            b->de = d->noname;
+            continue;
+        }
+        if(prev && prev->sec && prev->de && prev->shash == b->shash
+            && name_eq(prev->de->name, prev->de->nlen, b->sec, b->slen, lwc)){
+            b->de = prev->de;
+        }else{
+            size_t pos = dictentry_lookup(d, b->shash, b->sec, b->slen, lwc);
+            b->de = (pos == DICT_NOPOS) ? NULL : d->entries[pos];
+        }
+        prev = b;
+    }
+    /* Slots of indexes */
+    for(i = 0, b = bk; i < m; ++i, ++b){
+        if(!b->de || !b->de->kvlist) continue;
+        x = &b->de->idx;
+        if(x->mode == DICT_HASHED) PREFETCH(&x->slots[b->khash & (x->size - 1)]);
+        else if(x->mode == DICT_SORTED) PREFETCH(&x->slots[x->n / 2]);
+        else PREFETCH(b->de->kvlist);
+    }
+    /* Key/value pairs */
+    for(i = 0, b = bk; i < m; ++i, ++b){
+        b->pos = DICT_NOPOS;
+        if(!b->de || !b->de->kvlist || b->de->idx.mode == DICT_LINEAR) continue;
+        b->pos = dictindex_first(&b->de->idx, b->khash, &b->cur);
+        if(b->pos != DICT_NOPOS) PREFETCH(&b->de->kvlist[b->pos]);
+    }
+    /* Key names */
+    for(i = 0, b = bk; i < m; ++i, ++b)
+        if(b->pos != DICT_NOPOS && b->de->kvlist[b->pos].key)
+            PREFETCH(b->de->kvlist[b->pos].key);
+    /* Compare names */
+    for(i = 0, b = bk; i < m; ++i, ++b){
+        const dictentry *de = b->de;
+        if(!de || !de->kvlist) continue;
+        if(de->idx.mode == DICT_LINEAR)
+            b->pos = keyval_lookup(de, b->khash, b->key, b->klen, lwc);
+        else while(b->pos != DICT_NOPOS && !name_eq(de->kvlist[b->pos].key, de->kvlist[b->pos].klen, b->key, b->klen, lwc))
+            b->pos = dictindex_next(&de->idx, b->khash, &b->cur);
+        if(b->pos != DICT_NOPOS){
+            out[b->id] = de->kvlist[b->pos].val;
+            ++found;
+        }
+    }
+    return found;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get values of many keys from a dictionary.
+  @param    d       dictionary object to search.
+  @param    keys    array of keys ("entryname:keyname" or "keyname").
+  @param    n       number of keys.
+  @param    out     array of `n` values.
+  @param    lwc     ==1 to search keys case-insensitive.
+  @return   number of keys found.
+
+  For each key found, its value is stored in corresponding item of `out`.
+  Items of `out` for keys not found aren't changed, so `out` can be filled
+  with default values before call.
+  Keys are processed in groups: keys of group are hashed first, sorted by
+  section, then searched simultaneously with prefetching memory. This
+  function don't modify anything in dictionary or global state.
+  When `lwc` is 1, keys in dictionary should be lowercase (as keys of
+  dictionary loaded by iniparser_load()).
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictionary_get_batch(const dictionary * d, const char ** keys, size_t n, const char ** out, int lwc)
+{
+    batchkey bk[BATCHSZ];
+    size_t i, m = 0, found = 0;
+    const char *delim;
+
+    if(!d || !keys || !out) return 0;
+    for(i = 0; i < n; ++i){
+        batchkey *b = &bk[m];
+        if(!keys[i]) continue;
+        b->id = i;
+        if((delim = strchr(keys[i], ':'))){
+            b->sec = keys[i];
+            b->slen = (size_t)(delim - keys[i]);
+            b->shash = hash_n(b->sec, b->slen, lwc);
+            b->key = delim + 1;
+        }else{
+            b->sec = NULL;
+            b->slen = 0;
+            b->shash = 0;
+            b->key = keys[i];
+        }
+        b->klen = strlen(b->key);
+        b->khash = hash_n(b->key, b->klen, lwc);
+        if(++m == BATCHSZ){
+            found += batch_find(d, bk, m, out, lwc);
+            m = 0;
+        }
+    }
+    if(m) found += batch_find(d, bk, m, out, lwc);
+    return found;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Prepare key for searching in many dictionaries.
+  @param    p       probe to fill.
+  @param    key     Key ("entryname:keyname" or "keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+ */
+/*--------------------------------------------------------------------------*/
+void dictprobe_init(dictprobe * p, const char * key, size_t len, int lwc)
+{
+    const char *delim;
+    if(!p) return;
+    p->lwc = lwc;
+    p->sec = NULL;
+    p->slen = 0;
+    p->shash = 0;
+    if(key && (delim = memchr(key, ':', len))){
+        p->sec = key;
+        p->slen = (size_t)(delim - key);
+        p->shash = hash_n(key, p->slen, lwc);
+        len -= p->slen + 1;
+        key = delim + 1;
+    }
+    p->key = key;
+    p->klen = key ? len : 0;
+    p->khash = key ? hash_n(key, len, lwc) : 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find key/value pair prepared by dictprobe_init()
+  @param    d       dictionary object to search.
+  @param    p       prepared key.
+  @return   pointer to key/value pair or NULL if not found.
+
+  The same as dictionary_getkv_n(), but hashes aren't computed.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_probe(const dictionary * d, const dictprobe * p)
+{
+    const dictentry *de;
+    size_t i;
+    if(!d || !p || !p->key) return NULL;
+    if(p->sec){
+        dictindex_read(&d->idx, &d->tune);
+        if((i = dictentry_lookup(d, p->shash, p->sec, p->slen, p->lwc)) == DICT_NOPOS) return NULL;
+        de = d->entries[i];
+    }else de = d->noname;
+    if(!de) return NULL;
+    dictindex_read(&de->idx, &d->tune);
+    i = keyval_lookup(de, p->khash, p->key, p->klen, p->lwc);
+    return (i == DICT_NOPOS) ? NULL : &de->kvlist[i];
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in overlay of dictionaries.
+  @param    o       overlay to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+  @param    layer   If not NULL, filled with number of layer where key found.
+  @return   pointer to key/value pair or NULL.
+
+  Key is split and hashed once, then layers are probed from the highest.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictoverlay_getkv_n(const dictoverlay * o, const char * key, size_t len, int lwc, size_t * layer)
+{
+    dictprobe p;
+    const keyval *kv;
+    size_t i;
+    if(!o || !o->layers || !key) return NULL;
+    dictprobe_init(&p, key, len, lwc);
+    for(i = o->n; i-- > 0;){
+        if(!(kv = dictionary_probe(o->layers[i], &p))) continue;
+        if(layer) *layer = i;
+        return kv;
+    }
+    return NULL;
+}
+
+const char * dictoverlay_get(const dictoverlay * o, const char * key, const char * def)
+{
+    const keyval *kv = dictoverlay_getkv_n(o, key, key ? strlen(key) : 0, 0, NULL);
+    return kv ? kv->val : def;
+}
+
+/** Name of item found by query */
+static const char * dictquery_name(const dictquery * q, size_t pos)
+{
+    return q->de ? q->de->kvlist[pos].key : q->d->entries[pos]->name;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start query of sections or keys by name.
+  @param    d       dictionary object to search.
+  @param    pattern "entryname:pattern" to search keys in given entry (":pattern"
+                    for keys outside of entries) or "pattern" to search entries.
+  @param    flags   DICTQ_GLOB for glob pattern, DICTQ_LWC to compare lowercased.
+  @param    q       query to initialize.
+  @return   0 if Ok, anything else otherwise
+
+  If entry not found, query is empty. First item with given prefix is found
+  by binary search in name order.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_query(const dictionary * d, const char * pattern, int flags, dictquery * q)
+{
+    const char *delim;
+    size_t lo, hi;
+    int lwc = (flags & DICTQ_LWC) ? 1 : 0;
+
+    if(!q) return -1;
+    memset(q, 0, sizeof(dictquery));
+    if(!d || !pattern) return -1;
+    q->d = d;
+    q->flags = flags;
+    if((delim = strchr(pattern, ':'))){ // keys of entry
+        size_t slen = (size_t)(delim - pattern);
+        q->de = slen ? dictentry_findpos(d, pattern, slen, lwc, NULL) : d->noname;
+        pattern = delim + 1;
+        if(!q->de) return 0; // no entry - nothing found
+        q->order = dictentry_order(q->de, DICT_BYNAME);
+    }else q->order = dictionary_order(d, DICT_BYNAME);
+    if(!q->order) return -1;
+    q->pattern = pattern;
+    q->plen = (flags & DICTQ_GLOB) ? strcspn(pattern, "*?[\\") : strlen(pattern);
+    for(lo = 0, hi = q->order[0]; lo < hi;){
+        size_t mid = (lo + hi) / 2;
+        if(prefix_cmp(dictquery_name(q, q->order[mid+1]), pattern, q->plen, lwc) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    q->cur = lo;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item of query.
+  @param    q       query initialized by dictionary_query().
+  @param    name    If not NULL, name of key or entry found.
+  @param    val     If not NULL, value of key found (NULL for entries).
+  @return   1 if item found, 0 if there's no more items.
+ */
+/*--------------------------------------------------------------------------*/
+int dictquery_next(dictquery * q, const char ** name, const char ** val)
+{
+    int lwc;
+    if(!q || !q->order) return 0;
+    lwc = (q->flags & DICTQ_LWC) ? 1 : 0;
+    while(q->cur < q->order[0]){
+        size_t pos = q->order[1 + q->cur++];
+        const char *nm = dictquery_name(q, pos);
+        if(prefix_cmp(nm, q->pattern, q->plen, lwc)){ // out of prefix range
+            q->cur = q->order[0];
+            break;
+        }
+        if((q->flags & DICTQ_GLOB) && !glob_match(q->pattern, nm, lwc)) continue;
+        if(name) *name = nm;
+        if(val) *val = q->de ? q->de->kvlist[pos].val : NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start walking over entries or keys of entry.
+  @param    d       dictionary object.
+  @param    de      entry to walk over its keys or NULL to walk over entries.
+  @param    how     order of items (DICT_BYPOS, DICT_BYNAME or DICT_BYHASH).
+  @param    it      iterator to initialize.
+  @return   0 if Ok, anything else otherwise
+
+  Storage order needs nothing, list sorted by hash (after dictionary_sort_hash())
+  is walked in storage order too. Other orders are built once and updated when
+  items added or deleted (the same name order is used by dictionary_query()).
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_iter(const dictionary * d, const dictentry * de, dictorder_t how, dictiter * it)
+{
+    if(!it) return -1;
+    memset(it, 0, sizeof(dictiter));
+    if(!d || how < 0 || how > DICT_BYPOS) return -1;
+    it->d = d;
+    it->de = de;
+    if(de && !de->kvlist) return 0; // empty or deleted entry
+    if(how == DICT_BYHASH && (de ? de->sorted : d->sorted)) how = DICT_BYPOS;
+    if(how == DICT_BYPOS){
+        it->n = de ? de->n : d->n;
+        return 0;
+    }
+    it->order = de ? dictentry_order(de, how) : dictionary_order(d, how);
+    if(!it->order) return -1;
+    it->n = it->order[0];
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item of iterator.
+  @param    it      iterator initialized by dictionary_iter().
+  @return   position of item (in de->kvlist or d->entries) or DICT_NOPOS at end.
+
+  Deleted items are skipped.
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictiter_next(dictiter * it)
+{
+    if(!it || !it->d) return DICT_NOPOS;
+    while(it->cur < it->n){
+        size_t pos = it->order ? it->order[1 + it->cur] : it->cur;
+        ++it->cur;
+        if(it->de ? it->de->kvlist[pos].key != NULL : it->d->entries[pos]->name != NULL)
+            return pos;
+    }
+    return DICT_NOPOS;
+}
+
+/** Copy index of list (on failure copy gets linear scan) */
+static void dictindex_copy(dictindex * dst, const dictindex * src)
+{
+    dst->mode = src->mode;
+    dst->n = src->n;
+    dst->size = src->size;
+    dst->nread = __atomic_load_n(&src->nread, __ATOMIC_RELAXED);
+    dst->nwrite = src->nwrite;
+    dst->slots = NULL;
+    if(!src->size) return;
+    if(!(dst->slots = malloc(src->size * sizeof(dictslot)))){
+        dictindex_free(dst);
+        return;
+    }
+    memcpy(dst->slots, src->slots, src->size * sizeof(dictslot));
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Copy dictentry sharing its strings
+  @param    e   entry to copy
+  @return   copy or NULL if no memory
+
+  Strings aren't copied: the copy becomes one more their owner. Readers of
+  `e` could fill cache of values or build orders simultaneously, so these
+  fields aren't copied (only KV_DIRTY flag and positions in source file).
+ */
+/*--------------------------------------------------------------------------*/
+static dictentry * dictentry_copy(const dictentry * e)
+{
+    size_t i;
+    dictentry *c = calloc(1, sizeof(dictentry));
+    if(!c) return NULL;
+    if(e->len && !(c->kvlist = calloc(e->len, sizeof(keyval)))){
+        free(c);
+        return NULL;
+    }
+    for(i = 0; i < e->n; ++i){
+        keyval *k = &c->kvlist[i];
+        const keyval *o = &e->kvlist[i];
+        k->key = str_ref(o->key);
+        k->val = str_ref(o->val);
+        k->klen = o->klen;
+        k->vlen = o->vlen;
+        k->hash = o->hash;
+        k->vtype = __atomic_load_n(&o->vtype, __ATOMIC_RELAXED) & KV_DIRTY; // not saved yet
+        k->src = o->src;
+    }
+    c->n = e->n;
+    c->len = e->len;
+    c->sorted = e->sorted;
+    c->name = str_ref(e->name);
+    c->nlen = e->nlen;
+    c->hash = e->hash;
+    c->src = e->src;
+    dictindex_copy(&c->idx, &e->idx);
+    return c;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get entry of dictionary for changing it
+  @param    d   dictionary object
+  @param    pos position of entry (DICT_NOPOS for unnamed one)
+  @return   entry or NULL if no memory
+
+  If entry is shared with other dictionaries (see dictionary_clone()), it
+  is copied first (strings stay shared). Hash of its text in file is
+  forgotten: entry is going to be changed.
  */
 /*--------------------------------------------------------------------------*/
-void dictionary_del(dictionary * d)
+static dictentry * dictentry_own(dictionary * d, size_t pos)
 {
-    size_t  i, n;
+    dictentry **pe = (pos == DICT_NOPOS) ? &d->noname : &d->entries[pos], *c;
+    if(!__atomic_load_n(&(*pe)->shared, __ATOMIC_ACQUIRE)){
+        (*pe)->tlen = 0; // differs from text in file now
+        return *pe;
+    }
+    if(!(c = dictentry_copy(*pe))) return NULL;
+    dictentry_put(*pe);
+    return (*pe = c);
+}
 
-    if (d==NULL) return ;
-    n = d->n;
-    dictentry_del(d->noname);
-    for(i = 0; i < n; ++i)
-        dictentry_del(&(d->entries[i]));
+/** Make all entries of dictionary its own (before moving items) */
+static int dictionary_own_all(dictionary * d)
+{
+    size_t i;
+    if(!dictentry_own(d, DICT_NOPOS)) return -1;
+    for(i = 0; i < d->n; ++i)
+        if(!dictentry_own(d, i)) return -1;
+    return 0;
+}
+
+/** Copy dictionary sharing its entries (entries aren't owned by copy) */
+static dictionary * dictionary_shell_copy(const dictionary * d)
+{
+    dictionary *c = calloc(1, sizeof(dictionary));
+    if(!c) return NULL;
+    if(!(c->entries = malloc(d->len * sizeof(dictentry*)))){
+        free(c);
+        return NULL;
+    }
+    memcpy(c->entries, d->entries, d->n * sizeof(dictentry*));
+    c->n = d->n;
+    c->len = d->len;
+    c->noname = d->noname;
+    c->sorted = d->sorted;
+    c->tune = d->tune;
+    c->gen = d->gen;
+    c->last = d->last;
+    dictindex_copy(&c->idx, &d->idx);
+    return c;
+}
+
+/** Free memory of dictionary not shared with its copy (entries are shared) */
+static void dictionary_shell_free(void * p)
+{
+    dictionary *d = (dictionary*)p;
     free(d->entries);
-    free(d->noname);
+    dictindex_free(&d->idx);
+    dictorder_free(d->order);
     free(d);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Delete a dictentry object
-  @param    e   dictentry object to deallocate.
-  @return   void
+  @brief    Clone a dictionary.
+  @param    d   dictionary object to clone.
+  @return   new dictionary or NULL in case of failure
 
-  Deallocate a dictentry object.
-  WARNING! The dictentry e itself isn't deallocated!
+  Clone shares all entries with `d`: only array of entries and its index are
+  copied. Shared entry is copied when one of dictionaries changes it first,
+  strings (names, keys and values) are never copied.
  */
 /*--------------------------------------------------------------------------*/
-void dictentry_del(dictentry * e)
+dictionary * dictionary_clone(const dictionary * d)
 {
-    size_t  i, n;
-    if(!e) return;
-    n = e->n;
-    for(i = 0; i < n; ++i){
-        keyval *k = &(e->kvlist[i]);
-        if(k){
-            free(k->key);
-            free(k->val);
-        }
-    }
-    free(e->kvlist);
-    free(e->name);
+    dictionary *c;
+    size_t i;
+    if(!d || !(c = dictionary_shell_copy(d))) return NULL;
+    __atomic_add_fetch(&c->noname->shared, 1, __ATOMIC_RELAXED);
+    for(i = 0; i < c->n; ++i)
+        __atomic_add_fetch(&c->entries[i]->shared, 1, __ATOMIC_RELAXED);
+    return c;
 }
 
-static int iter = 0;
-
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Find section in given dictionary
-  @param    d       dictionary object to search.
-  @param    name    Entry to look for in the dictionary.
-  @return   pointer to entry or NULL
+  @brief    Add section of other dictionary sharing it.
+  @param    d       dictionary object to modify.
+  @param    de      section of other dictionary (unnamed section replaces empty unnamed section of `d`).
+  @return   0 if Ok, -1 if there's section with the same name or no memory
 
-  This function locates a section in dictionary `d` and returns pointer to it
-  or NULL if no entries found.
+  Section is indexed as new section created by dictionary_set().
  */
 /*--------------------------------------------------------------------------*/
-dictentry * dictentry_find(const dictionary * d, const char * key){
-    if(!d || !key || !d->entries) return NULL;
-    dictentry *elist = d->entries;
-    int i, L = (int)d->n, down = 0, up = L-1;
-    hash_t hash = dictionary_hash(key);
-    DBG("search entry %s (%u, last: %u [%s])\n", key, hash, hash_last, de_last ? de_last->name : "(null)");
-iter = 0;
-    if(hash_last == hash) return de_last;
-    if(d->sorted){ // sorted dictionary - binary search
-        while(down <= up){
-++iter;
-            i = (up + down)/2;
-            if(elist[i].hash == hash){
-            /* Compare string, to avoid hash collisions */
-                if (!strcmp(key, elist[i].name)) {
-                    de_last = &elist[i];
-                    hash_last = de_last->hash;
-                    return de_last;
-                }else{ // maybe there's several entries with same hash?
-                    while(i && elist[--i].hash == hash); // goto first entry with this hash
-                    --L;
-                    while(i < L && elist[++i].hash == hash){
-                        if (!strcmp(key, elist[i].name)){
-                            de_last = &elist[i];
-                            hash_last = de_last->hash;
-                            return de_last;
-                        }
-                    }
-                    return NULL; // not found
-                }
-            }else if(elist[i].hash < hash) down = i + 1; // hash searched is in right half
-            else up = i - 1; // hash searched is in left half
-        }
-    }else{ // unsorted - direct lookup
-        for(i = 0; i < L; ++i){
-++iter;
-            if(elist[i].hash == hash){
-            /* Compare string, to avoid hash collisions */
-                if (!strcmp(key, elist[i].name)) {
-                    de_last = &elist[i];
-                    hash_last = de_last->hash;
-                    return de_last;
-                }
-            }
-        }
+int dictionary_adopt(dictionary * d, const dictentry * de)
+{
+    if(!d || !de) return -1;
+    if(!de->name){ // unnamed section
+        if(d->noname->n) return -1;
+        __atomic_add_fetch(&((dictentry*)de)->shared, 1, __ATOMIC_RELAXED);
+        dictentry_put(d->noname);
+        d->noname = (dictentry*)de;
+        return 0;
     }
-    return NULL;
+    if(dictentry_findpos(d, de->name, de->nlen, 0, NULL)) return -1;
+    if(d->n == d->len && dictionary_grow(d)) return -1;
+    __atomic_add_fetch(&((dictentry*)de)->shared, 1, __ATOMIC_RELAXED);
+    d->entries[d->n++] = (dictentry*)de;
+    d->last = d->n - 1;
+    d->sorted = 0;
+    dictorder_add(d->order, d, NULL, d->n - 1);
+    if(dictindex_write(&d->idx, d->n, &d->tune))
+        dictionary_reindex(d, 1);
+    else if(dictindex_put(&d->idx, de->hash, d->n - 1))
+        dictindex_free(&d->idx); // no memory for index: linear search
+    return 0;
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Find keyval object with given key name from a dictionary entry.
-  @param    de      dictionary entry to search.
-  @param    key     key to look for in the dictionary ("keyname").
-  @return   pointer to keyval found or NULL
+  @brief    Start or stop tracking source file of dictionary.
+  @param    d       dictionary object.
+  @param    file    name of source file or NULL to stop tracking.
+  @return   0 if Ok, anything else otherwise
 
-  This function locates a key in a dictionary entry and returns a pointer to
-  keyval with given key value, or NULL if no such key can be found in.
+  `src` fields of all items are reset: spans are filled by parser of file.
  */
 /*--------------------------------------------------------------------------*/
-static keyval *keyval_find(const dictentry * de, const char * key)
+int dictionary_track(dictionary * d, const char * file)
 {
-    if(!de || !key) return NULL;
-    hash_t hash = dictionary_hash(key);
-    keyval *kvlist = de->kvlist;
-    if(!kvlist) return NULL;
-    int i, L = (int)de->n, down = 0, up = L-1;
-iter = 0;
-    if(de->sorted){ // sorted dictionary - binary search
-        while(down <= up){
-++iter;
-            i = (up + down)/2;
-            if(kvlist[i].hash == hash){
-            /* Compare string, to avoid hash collisions */
-                if (!strcmp(key, kvlist[i].key)) {
-                    return &kvlist[i];
-                }else{ // maybe there's several entries with same hash?
-                    while(i && kvlist[--i].hash == hash); // goto first entry with this hash
-                    --L;
-                    while(i < L && kvlist[++i].hash == hash){
-                        if (!strcmp(key, kvlist[i].key)){
-                            return &kvlist[i];
-                        }
-                    }
-                    return NULL; // not found
-                }
-            }else if(kvlist[i].hash < hash) down = i + 1; // hash searched is in right half
-            else up = i - 1; // hash searched is in left half
-        }
-    }else{ // unsorted - direct lookup
-        for(i = 0; i < L; ++i){
-++iter;
-            if(kvlist[i].hash == hash){
-            /* Compare string, to avoid hash collisions */
-                if (!strcmp(key, kvlist[i].key)){
-                    return &kvlist[i];
-                }
-            }
-        }
+    dictsrc *s;
+    size_t i, j;
+    if(!d) return -1;
+    if(file && !(s = calloc(1, sizeof(dictsrc)))) return -1;
+    if(file && !(s->file = strdup(file))){
+        free(s);
+        return -1;
     }
-    return NULL;
+    if(d->src){
+        free(d->src->file);
+        free(d->src->spans);
+        free(d->src->changes);
+        free(d->src);
+        d->src = NULL;
+    }
+    if(!file) return 0;
+    for(i = 0; i < d->noname->n; ++i) d->noname->kvlist[i].src = 0;
+    for(i = 0; i < d->n; ++i){
+        dictentry *de = d->entries[i];
+        de->src = 0;
+        for(j = 0; j < de->n; ++j) de->kvlist[j].src = 0;
+    }
+    s->gen = d->gen;
+    d->src = s;
+    return 0;
+}
+
+/** Add span to source of dictionary, returns its number + 1 (for `src` fields) or 0 if no memory */
+size_t dictsrc_addspan(dictsrc * s, const dictspan * span)
+{
+    if(s->nspans == s->lspans){
+        size_t l = s->lspans ? 2 * s->lspans : 256;
+        dictspan *n = realloc(s->spans, l * sizeof(dictspan));
+        if(!n) return 0;
+        s->spans = n;
+        s->lspans = l;
+    }
+    s->spans[s->nspans] = *span;
+    return ++s->nspans;
+}
+
+/** Forget changes of dictionary (after they were saved) */
+void dictsrc_clean(dictionary * d)
+{
+    dictsrc *s = d->src;
+    if(!s) return;
+    s->nchanges = 0;
+    s->lost = 0;
+    s->gen = d->gen;
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Get a value from a dictionary.
-  @param    d       dictionary object to search.
-  @param    key     Key to look for in the dictionary ("entryname:keyname").
-  @param    def     Default value to return if key not found.
-  @return   1 pointer to internally allocated character string.
+  @brief    Remember change of dictionary with source tracked
+  @param    d       dictionary object.
+  @param    sec     section of key changed (DICT_NOPOS for unnamed).
+  @param    pos     position of key changed.
+  @param    span    number of span removed + 1 (0 for key changed).
 
-  This function locates a key in a dictionary and returns a pointer to its
-  value, or the passed 'def' pointer if no such key can be found in
-  dictionary. The returned character pointer points to data internal to the
-  dictionary object, you should not try to free it or modify it.
-  Value of key have format "entry:name" for key inside given entry, or just
-  "name" for keys from unnamed entry (d->noname).
+  Changed keys are marked by KV_DIRTY and removed spans by `removed` flag,
+  so when list can't be kept (no memory or dictionary was sorted since
+  first change) saving scans all items.
  */
 /*--------------------------------------------------------------------------*/
-const char * dictionary_get(const dictionary * d, const char * key, const char * def)
+static void dictsrc_change(dictionary * d, size_t sec, size_t pos, size_t span)
 {
-    char *delim, *str = strdup(key), *k = NULL;
-    const char *ret = def;
-    dictentry *de = NULL;
-
-    if((delim = strchr(str, ':'))){
-        *delim++ = 0;
-        k = delim;
-        de = dictentry_find(d, str);
-    DBG("de found by %d steps\n", iter);
-    }else{
-        k = str;
-        de = d->noname;
+    dictsrc *s = d->src;
+    dictchange *c;
+    if(span) s->spans[span - 1].removed = 1;
+    if(s->lost) return;
+    if(!s->nchanges) s->gen = d->gen;
+    else if(s->gen != d->gen){ // positions in list are obsolete
+        s->lost = 1;
+        return;
     }
-    if(!de){
-        goto rtn;
+    if(s->nchanges){ // the same key changed again?
+        c = &s->changes[s->nchanges - 1];
+        if(!span && !c->span && c->sec == sec && c->pos == pos) return;
     }
-    DBG("de name: %s\n", de->name);
-    keyval *kv = keyval_find(de, k);
-    DBG("kv %s found by %d steps\n", kv ? "" : "not", iter);
-    if(kv) ret = kv->val;
-    rtn:
-    free(str);
-    return ret;
+    if(s->nchanges == s->lchanges){
+        size_t l = s->lchanges ? 2 * s->lchanges : 64;
+        if(!(c = realloc(s->changes, l * sizeof(dictchange)))){
+            s->lost = 1;
+            return;
+        }
+        s->changes = c;
+        s->lchanges = l;
+    }
+    c = &s->changes[s->nchanges++];
+    c->sec = sec;
+    c->pos = pos;
+    c->span = span;
 }
 
-
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Set a value in a dictionary.
@@ -424,91 +1944,386 @@ const char * dictionary_get(const dictionary * d, const char * key, const char *
  */
 /*--------------------------------------------------------------------------*/
 int dictionary_set(dictionary * d, const char * key, const char * val)
+{
+    if (key==NULL) return -1 ;
+    return dictionary_set_n(d, key, strlen(key), val, val ? strlen(val) : 0);
+}
+
+/** Change dictionary (see dictionary_set_n()) */
+static int dict_set(dictionary * d, const char * key, size_t klen, const char * val, size_t vlen)
 {
     hash_t hash ;
     keyval * kv = NULL;
     dictentry *de = NULL;
+    size_t sec = DICT_NOPOS, slen = 0;
+    const char *delim, *name = key;
     if (d==NULL || key==NULL) return -1 ;
-    DBG("set %s to %s\n", key, val);
-    char *dup = strdup(key), *delim = strchr(dup, ':');
+    DBG("set %.*s to %.*s\n", (int)klen, key, (int)vlen, val);
+    delim = memchr(key, ':', klen);
     if(delim){
-        *delim++ = 0;
-        key = (const char*) delim;
+        slen = (size_t)(delim - key);
+        klen -= slen + 1;
+        key = delim + 1;
     }else{ // user give section or global parameter name
         if(!val){ // remove whole section?
-            if((de = dictentry_find(d, dup))){
-                dictentry_del(de);
-                memset(de, 0, sizeof(dictentry));
+            if(dictentry_findpos(d, key, klen, 0, &sec)){
+                if(!(de = dictentry_own(d, sec))) return -1;
+                if(d->src && de->src) dictsrc_change(d, sec, 0, de->src);
+                dictorder_del(d->order, d, NULL, sec);
+                dictentry_clear(d, de);
+                memset(de, 0, sizeof(dictentry)); // keep deleted entry for section handles
+                if(sec == d->last) d->last = DICT_NOPOS;
                 d->sorted = 0;
-                free(dup);
                 return 0;
             }
         }
     }
     /* Find if value is already in dictionary */
     if(delim)
-        de = dictentry_find(d, dup); // section
+        de = dictentry_findlast(d, name, slen, &sec); // section
     else de = d->noname; // global
     DBG("de name: %s\n", de ? de->name : "not found");
     if(de){
-        if((kv = keyval_find(de, key))){ // key found - just change its value
-            free(kv->val);
+        if((kv = keyval_find(de, key, klen, 0, &d->tune))){ // key found - just change its value
+            size_t i = (size_t)(kv - de->kvlist);
+            if(!(de = dictentry_own(d, sec))) return -1;
+            kv = &de->kvlist[i];
             if(!val){ // erase object
-                free(kv->key);
+                if(d->src && kv->src) dictsrc_change(d, sec, i, kv->src);
+                dictorder_del(de->order, d, de, i);
+                dict_release(d, kv->val);
+                dict_release(d, kv->key);
                 memset(kv, 0, sizeof(keyval));
                 de->sorted = 0;
-            }else
-                kv->val = strdup(val);
-            free(dup);
+            }else{
+                char *v = strdup_n(val, vlen);
+                if(!v) return -1;
+                dict_release(d, kv->val);
+                kv->val = v;
+                kv->vlen = vlen;
+                kv->vtype = 0; // cached values are obsolete
+                if(d->src){
+                    kv->vtype = KV_DIRTY;
+                    dictsrc_change(d, sec, i, 0);
+                }
+            }
             return 0;
         }
     }
     /* Not found: add a new value. First check for entries */
-    if(!val) return 0; // no key for erasing === we already erase it
-    hash = dictionary_hash(key);
+    if(!val){ // no key for erasing === we already erase it
+        return 0;
+    }
+    hash = hash_n(key, klen, 0);
     if(!de){ // there's no entry for given key
         if(delim){ // this key should be stored in named entry - create it
             d->sorted = 0; // newly created entry breaks sort order
             /* See if dictionary needs to grow */
             if (d->n == d->len)
                 if (dictionary_grow(d)){
-                    free(dup);
     DBG("can't enlarge directory size!\n");
                     return -1;
                 }
-            de = &d->entries[d->n++];
-            de->name = strdup(dup);
-            de->hash = dictionary_hash(dup);
+            if(!(de = dictentry_new(0))) return -1;
+            if(!(de->name = strdup_n(name, slen))){
+                dictentry_del(de);
+                return -1;
+            }
+            de->nlen = slen;
+            de->hash = hash_n(name, slen, 0);
+            sec = d->n;
+            d->entries[d->n++] = de;
+            d->last = sec;
+            dictorder_add(d->order, d, NULL, sec);
+            if(dictindex_write(&d->idx, d->n, &d->tune))
+                dictionary_reindex(d, 1);
+            else if(dictindex_put(&d->idx, de->hash, d->n - 1))
+                dictindex_free(&d->idx); // no memory for index: linear search
     DBG("new record: %s with hash %u\n", de->name, de->hash);
         }else // global section
             de = d->noname;
     }
-    hash_last = de->hash;
-    de_last = de;
+    if(!(de = dictentry_own(d, sec))) return -1;
     de->sorted = 0; // we broke sort order
     /* See if dictentry needs to grow */
     if(de->n == de->len)
-        if(dictentry_grow(de)){
-            free(dup);
-            return -1;
-        }
-    kv = &de->kvlist[de->n++];
-    kv->key = strdup(key);
-    kv->val = strdup(val);
+        if(dictentry_grow(de)) return -1;
+    kv = &de->kvlist[de->n];
+    kv->key = strdup_n(key, klen);
+    kv->val = strdup_n(val, vlen);
+    if(!kv->key || !kv->val){
+        str_free(kv->key);
+        str_free(kv->val);
+        memset(kv, 0, sizeof(keyval));
+        return -1;
+    }
+    ++de->n;
+    kv->klen = klen;
+    kv->vlen = vlen;
     kv->hash = hash;
+    dictorder_add(de->order, d, de, de->n - 1);
+    kv->vtype = 0;
+    kv->src = 0;
+    if(d->src){
+        kv->vtype = KV_DIRTY;
+        dictsrc_change(d, sec, de->n - 1, 0);
+    }
+    if(dictindex_write(&de->idx, de->n, &d->tune))
+        dictentry_reindex(de, &d->tune, 1);
+    else if(dictindex_put(&de->idx, hash, de->n - 1))
+        dictindex_free(&de->idx);
     DBG("new key: %s with hash %u & value %s\n", kv->key, kv->hash, kv->val);
-    free(dup);
     return 0 ;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value in a dictionary by key and value of given length.
+  @param    d       dictionary object to modify.
+  @param    key     Key to modify or add ("entryname:keyname", not necessary zero-terminated).
+  @param    klen    Length of `key`.
+  @param    val     Value to add (not necessary zero-terminated) or NULL to erase.
+  @param    vlen    Length of `val`.
+  @return   int     0 if Ok, anything else otherwise
+
+  The same as dictionary_set(), but key and value could be parts of larger
+  buffer: they are copied with given lengths.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_set_n(dictionary * d, const char * key, size_t klen, const char * val, size_t vlen)
+{
+    if(dict_set(d, key, klen, val, vlen)) return -1;
+    if(d->hook) d->hook(d->hookarg, key, klen, val, vlen);
+    return 0;
+}
+
+/** Set function called after each change of dictionary (NULL to remove it) */
+void dictionary_sethook(dictionary * d, dicthook_t hook, void * arg)
+{
+    if(!d) return;
+    d->hook = hook;
+    d->hookarg = arg;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make new version of a dictionary with one value changed.
+  @param    d       dictionary object (not modified).
+  @param    key     Key to modify, add or erase (as in dictionary_set_n()).
+  @param    klen    Length of `key`.
+  @param    val     Value to set or NULL to erase.
+  @param    vlen    Length of `val`.
+  @param    garbage filled with array of memory of `d` not used by new version.
+  @param    ngarbage filled with number of items in `garbage`.
+  @return   new version or NULL in case of failure
+
+  Sections changed by dictionary_set_n() (unnamed section for "keyname",
+  named section for "entryname:keyname" and section to delete) are copied
+  first, so dictionary_set_n() works only with memory of new version;
+  strings it releases are stored in garbage array. Array is allocated
+  before any change: its size is known from the section changed.
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * dictionary_update(const dictionary * d, const char * key, size_t klen,
+                               const char * val, size_t vlen, dictgarbage ** garbage, size_t * ngarbage)
+{
+    dictionary *nd;
+    dictentry *old[2], *de;
+    dictgarbage *g;
+    size_t pos[2], i, nold = 0, nmax = 3; // old dictionary, key and value erased
+    const char *delim;
+    if(!d || !key || !garbage || !ngarbage) return NULL;
+    delim = memchr(key, ':', klen);
+    if(delim){
+        if((de = dictentry_findpos(d, key, (size_t)(delim - key), 0, &pos[nold])))
+            old[nold++] = de;
+    }else{
+        old[nold] = d->noname;
+        pos[nold++] = DICT_NOPOS;
+        if(!val && (de = dictentry_findpos(d, key, klen, 0, &pos[nold]))){
+            old[nold++] = de;
+            nmax += 2 * de->n + 1; // all strings of section deleted
+        }
+    }
+    nmax += nold;
+    if(!(g = malloc(nmax * sizeof(dictgarbage)))) return NULL;
+    if(!(nd = dictionary_shell_copy(d))){
+        free(g);
+        return NULL;
+    }
+    for(i = 0; i < nold; ++i){
+        if(!(de = dictentry_copy(old[i]))) goto bad;
+        if(pos[i] == DICT_NOPOS) nd->noname = de;
+        else nd->entries[pos[i]] = de;
+    }
+    nd->garbage = g;
+    if(dictionary_set_n(nd, key, klen, val, vlen)) goto bad;
+    nd->garbage = NULL;
+    for(i = 0; i < nold; ++i){
+        g[nd->ngarbage].p = old[i];
+        g[nd->ngarbage++].fn = dictentry_put;
+    }
+    g[nd->ngarbage].p = (void*)d;
+    g[nd->ngarbage++].fn = dictionary_shell_free;
+    *garbage = g;
+    *ngarbage = nd->ngarbage;
+    nd->ngarbage = 0;
+    return nd;
+bad: // dictionary_set_n() fails before releasing anything
+    for(i = 0; i < nold; ++i){
+        de = (pos[i] == DICT_NOPOS) ? nd->noname : nd->entries[pos[i]];
+        if(de != old[i]) dictentry_put(de);
+    }
+    for(i = d->n; i < nd->n; ++i) // sections created by new version
+        dictentry_put(nd->entries[i]);
+    dictionary_shell_free(nd);
+    free(g);
+    return NULL;
+}
+
+/** Output buffer of dump */
+typedef struct {
+    char     *  buf ;   /** Buffer */
+    size_t      size ;  /** Size of buffer */
+    size_t      len ;   /** Bytes used */
+    FILE     *  f ;     /** Output file (or NULL) */
+    int         fd ;    /** Output descriptor if `f` is NULL (-1 for memory buffer) */
+    int         err ;   /** ==1 if output failed */
+    int         pos ;   /** ==1 to write by pwrite() at `off` */
+    off_t       off ;   /** Offset in file for pwrite() */
+} dumpbuf;
+
+/** Write buffer content to output (memory buffer is never flushed: it has exact size) */
+static void dumpbuf_flush(dumpbuf * b)
+{
+    size_t done = 0;
+    ssize_t w;
+    if(!b->len || b->err) return;
+    if(b->f){
+        if(fwrite(b->buf, 1, b->len, b->f) != b->len) b->err = 1;
+    }else if(b->fd > -1){
+        while(done < b->len){
+            if(b->pos) w = pwrite(b->fd, b->buf + done, b->len - done, b->off + (off_t)done);
+            else w = write(b->fd, b->buf + done, b->len - done);
+            if(w < 0){
+                if(errno == EINTR) continue;
+                b->err = 1;
+                break;
+            }
+            done += (size_t)w;
+        }
+        b->off += (off_t)done;
+    }
+    b->len = 0;
+}
+
+/** Put `len` bytes of `s` into buffer (flushing it when full) */
+static void dumpbuf_put(dumpbuf * b, const char * s, size_t len)
+{
+    size_t l;
+    while(len){
+        if(b->len == b->size) dumpbuf_flush(b);
+        l = b->size - b->len;
+        if(l > len) l = len;
+        memcpy(b->buf + b->len, s, l);
+        b->len += l;
+        s += l;
+        len -= l;
+    }
+}
+
+/** Length of line "key = value\n" as printed by "%-30s = %s\n" */
+static size_t dump_kvlen(const keyval * kv)
+{
+    return (kv->klen < DUMPKEYW ? DUMPKEYW : kv->klen) + 3 + kv->vlen + 1;
+}
+
+/** Dump keys of entry */
+static void dump_entry(dumpbuf * b, const dictentry * de)
+{
+    static const char spaces[DUMPKEYW] = "                              ";
+    const keyval *kv = de->kvlist;
+    size_t i, L;
+    char *p;
+    for(i = 0; i < de->n; ++i, ++kv){
+        if(!kv->key) continue; // deleted key/val
+        L = dump_kvlen(kv);
+        if(b->size - b->len < L) dumpbuf_flush(b);
+        if(b->size - b->len < L){ // line is larger than buffer
+            dumpbuf_put(b, kv->key, kv->klen);
+            if(kv->klen < DUMPKEYW) dumpbuf_put(b, spaces, DUMPKEYW - kv->klen);
+            dumpbuf_put(b, " = ", 3);
+            dumpbuf_put(b, kv->val, kv->vlen);
+            dumpbuf_put(b, "\n", 1);
+            continue;
+        }
+        p = b->buf + b->len;
+        memcpy(p, kv->key, kv->klen);
+        p += kv->klen;
+        if(kv->klen < DUMPKEYW){
+            memset(p, ' ', DUMPKEYW - kv->klen);
+            p += DUMPKEYW - kv->klen;
+        }
+        memcpy(p, " = ", 3);
+        p += 3;
+        memcpy(p, kv->val, kv->vlen);
+        p[kv->vlen] = '\n';
+        b->len += L;
+    }
+}
+
+/** Dump section header "\n[name]\n" */
+static void dump_header(dumpbuf * b, const dictentry * de)
+{
+    dumpbuf_put(b, "\n[", 2);
+    dumpbuf_put(b, de->name, de->nlen);
+    dumpbuf_put(b, "]\n", 2);
+}
+
+/** Dump sections [from, to) of dictionary (with unnamed section if `from` is 0) */
+static void dump_range(dumpbuf * b, const dictionary * d, size_t from, size_t to)
+{
+    size_t i;
+    if(!from && d->noname) dump_entry(b, d->noname); // unsectioned data
+    for(i = from; i < to; ++i){ // dump sections
+        const dictentry *de = d->entries[i];
+        if(!de->n) continue; // deleted section
+        dump_header(b, de);
+        dump_entry(b, de);
+    }
+    dumpbuf_flush(b);
+}
+
+/** Dump whole dictionary (it isn't empty) */
+static void dump_all(dumpbuf * b, const dictionary * d)
+{
+    dump_range(b, d, 0, d->n);
+}
+
+/** Initialize buffer of dump into file or descriptor */
+static void dumpbuf_init(dumpbuf * b, FILE * f, int fd, char * stackbuf, size_t stacksize)
+{
+    b->f = f;
+    b->fd = fd;
+    b->len = 0;
+    b->err = 0;
+    b->pos = 0;
+    b->off = 0;
+    if((b->buf = malloc(DUMPBUFSZ))) b->size = DUMPBUFSZ;
+    else{ // no memory: use small buffer
+        b->buf = stackbuf;
+        b->size = stacksize;
+    }
+}
+
 void dictentry_dump(const dictentry *de, FILE *out){
-    if(!de || !out) return;
-    keyval *kv = de->kvlist;
-    size_t i, n = de->n;
-    if(!kv || !n) return; // empty dictentry
-    for(i = 0; i < n; ++i, ++kv)
-        if(kv->key) // not empty key/val
-            fprintf(out, "%-30s = %s\n", kv->key, kv->val);
+    dumpbuf b;
+    char sbuf[256];
+    if(!de || !out || !de->kvlist || !de->n) return;
+    dumpbuf_init(&b, out, -1, sbuf, sizeof(sbuf));
+    dump_entry(&b, de);
+    dumpbuf_flush(&b);
+    if(b.buf != sbuf) free(b.buf);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -519,22 +2334,195 @@ void dictentry_dump(const dictentry *de, FILE *out){
   @return   void
 
   Dumps a dictionary onto an opened file pointer, creating ini-file.
+  Lines are formatted without printf into large buffer written by fwrite().
  */
 /*--------------------------------------------------------------------------*/
 dicterr_t dictionary_dump(const dictionary * d, FILE * out)
 {
-    size_t  i, n;
+    dumpbuf b;
+    char sbuf[256];
 
     if (d==NULL || out==NULL) return DERR_BADDATA;
-    if ((n = d->n) < 1) return DERR_EMPTY;
-    dictentry_dump(d->noname, out); // unsectioned data
-    dictentry *de = d->entries;
-    for(i = 0; i < n; ++i, ++de){ // dump all sections
-        if(!de->n) continue; // deleted section
-        fprintf(out, "\n[%s]\n", de->name); // print section name
-        dictentry_dump(de, out);
+    if (d->n < 1) return DERR_EMPTY;
+    dumpbuf_init(&b, out, -1, sbuf, sizeof(sbuf));
+    dump_all(&b, d);
+    if(b.buf != sbuf) free(b.buf);
+    return b.err ? DERR_IO : DERR_OK;
+}
+
+/** The same as dictionary_dump() to file descriptor (write() is called for each DUMPBUFSZ bytes) */
+dicterr_t dictionary_dump_fd(const dictionary * d, int fd)
+{
+    dumpbuf b;
+    char sbuf[256];
+
+    if (d==NULL || fd < 0) return DERR_BADDATA;
+    if (d->n < 1) return DERR_EMPTY;
+    dumpbuf_init(&b, NULL, fd, sbuf, sizeof(sbuf));
+    dump_all(&b, d);
+    if(b.buf != sbuf) free(b.buf);
+    return b.err ? DERR_IO : DERR_OK;
+}
+
+/** Size of dump of entry (with header for named one) */
+static size_t dump_entrysize(const dictentry * de, int header)
+{
+    size_t j, size = 0;
+    if(!de || !de->n) return 0;
+    if(header) size += de->nlen + 4; // "\n[name]\n"
+    for(j = 0; j < de->n; ++j)
+        if(de->kvlist[j].key) size += dump_kvlen(&de->kvlist[j]);
+    return size;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compute size of dictionary dump
+  @param    d   Dictionary to dump
+  @return   exact number of bytes written by dictionary_dump()
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictionary_dump_size(const dictionary * d)
+{
+    size_t i, size;
+    if(!d || d->n < 1) return 0;
+    size = dump_entrysize(d->noname, 0);
+    for(i = 0; i < d->n; ++i)
+        size += dump_entrysize(d->entries[i], 1);
+    return size;
+}
+
+/** Part of parallel dump */
+typedef struct {
+    const dictionary *  d ;
+    size_t              from ;  /** First section */
+    size_t              to ;    /** Section after the last one */
+    int                 fd ;    /** Output file */
+    off_t               off ;   /** Offset of part in file */
+    int                 err ;   /** ==1 if output failed */
+    int                 started;/** ==1 if part is dumped by separate thread */
+} dumpjob;
+
+/** Dump part of dictionary at its offset */
+static void * dump_job(void * arg)
+{
+    dumpjob *j = (dumpjob*)arg;
+    dumpbuf b;
+    char sbuf[256];
+    dumpbuf_init(&b, NULL, j->fd, sbuf, sizeof(sbuf));
+    b.pos = 1;
+    b.off = j->off;
+    dump_range(&b, j->d, j->from, j->to);
+    if(b.buf != sbuf) free(b.buf);
+    j->err = b.err;
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into file by several threads
+  @param    d           Dictionary to dump
+  @param    fd          File descriptor (opened for writing)
+  @param    nthreads    Number of threads
+  @return   0 or error code
+
+  Sizes of sections are computed first, so offset of each section in file
+  is known. Sections are divided into `nthreads` ranges of roughly equal
+  size; each range is formatted by its own thread into own buffer and
+  written by pwrite() at its offset, so no ordering between threads is
+  needed. Output is written from the current position of `fd`, which is
+  moved to the end of dump after all. If `fd` can't be seeked (pipe,
+  socket), is opened with O_APPEND (pwrite() appends ignoring offset) or
+  dictionary is small, it is dumped by the calling thread.
+ */
+/*--------------------------------------------------------------------------*/
+dicterr_t dictionary_dump_parallel(const dictionary * d, int fd, int nthreads)
+{
+    size_t *sz, i, k, total, part, acc;
+    dumpjob *jobs;
+    pthread_t *thr;
+    off_t base;
+    int err = 0, flags;
+
+    if (d==NULL || fd < 0) return DERR_BADDATA;
+    if (d->n < 1) return DERR_EMPTY;
+    if(nthreads > (int)d->n) nthreads = (int)d->n;
+    if(nthreads < 2 || (flags = fcntl(fd, F_GETFL)) < 0 || (flags & O_APPEND)) // pwrite() ignores offset
+        return dictionary_dump_fd(d, fd);
+    if((base = lseek(fd, 0, SEEK_CUR)) < 0)
+        return dictionary_dump_fd(d, fd);
+    sz = malloc((d->n + 1) * sizeof(size_t));
+    jobs = calloc((size_t)nthreads, sizeof(dumpjob));
+    thr = malloc((size_t)nthreads * sizeof(pthread_t));
+    if(!sz || !jobs || !thr){
+        free(sz); free(jobs); free(thr);
+        return dictionary_dump_fd(d, fd);
+    }
+    total = sz[d->n] = dump_entrysize(d->noname, 0); // sz[d->n] - unnamed section
+    for(i = 0; i < d->n; ++i) total += (sz[i] = dump_entrysize(d->entries[i], 1));
+    if(total < DUMPPARMIN){
+        free(sz); free(jobs); free(thr);
+        return dictionary_dump_fd(d, fd);
+    }
+    part = total / (size_t)nthreads + 1;
+    acc = sz[d->n];
+    jobs[0].off = base;
+    for(i = 0, k = 0; i < d->n; ++i){ // cut ranges of roughly `part` bytes
+        // never cut before the first section: unnamed section is dumped by range starting from 0
+        if(i && acc >= part * (k + 1) && k + 1 < (size_t)nthreads){
+            jobs[k++].to = i;
+            jobs[k].from = i;
+            jobs[k].off = base + (off_t)acc;
+        }
+        acc += sz[i];
+    }
+    jobs[k].to = d->n;
+    for(i = 0; i <= k; ++i){
+        jobs[i].d = d;
+        jobs[i].fd = fd;
+    }
+    for(i = 1; i <= k; ++i) // no thread - dump part here
+        if(!(jobs[i].started = !pthread_create(&thr[i], NULL, dump_job, &jobs[i])))
+            dump_job(&jobs[i]);
+    dump_job(&jobs[0]);
+    for(i = 0; i <= k; ++i){
+        if(jobs[i].started) pthread_join(thr[i], NULL);
+        err |= jobs[i].err;
     }
-    return DERR_OK;
+    if(lseek(fd, base + (off_t)total, SEEK_SET) < 0) err = 1;
+    free(sz);
+    free(jobs);
+    free(thr);
+    return err ? DERR_IO : DERR_OK;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into memory buffer
+  @param    d       Dictionary to dump
+  @param    buf     Buffer
+  @param    size    Size of buffer
+  @return   size of dump (as dictionary_dump_size())
+
+  Nothing is written if `size` is less than size of dump. If there's room,
+  dump is terminated by zero.
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictionary_dump_mem(const dictionary * d, char * buf, size_t size)
+{
+    dumpbuf b;
+    size_t need = dictionary_dump_size(d);
+    if(!buf || !need || size < need) return need;
+    b.buf = buf;
+    b.size = need;
+    b.len = 0;
+    b.f = NULL;
+    b.fd = -1;
+    b.err = 0;
+    b.pos = 0;
+    dump_all(&b, d);
+    if(size > need) buf[need] = 0;
+    return need;
 }
 
 /** Compare keyvals in dictentry (by hash) */
@@ -547,7 +2535,7 @@ static int cmpvals(const void *p1, const void *p2){
 
 /** Compare dictentries in dictionary (by hash) */
 static int cmpentries(const void *p1, const void *p2){
-    hash_t h1 = ((dictentry*)p1)->hash, h2 = ((dictentry*)p2)->hash;
+    hash_t h1 = (*(dictentry**)p1)->hash, h2 = (*(dictentry**)p2)->hash;
     if(h1 < h2) return -1;
     else if(h1 > h2) return 1;
     else return 0;
@@ -562,7 +2550,7 @@ static int cmpvalnm(const void *p1, const void *p2){
 
 /** Compare dictentries in dictionary (by names) */
 static int cmpentrienm(const void *p1, const void *p2){
-    char *ch1 = ((dictentry*)p1)->name, *ch2 = ((dictentry*)p2)->name;
+    char *ch1 = (*(dictentry**)p1)->name, *ch2 = (*(dictentry**)p2)->name;
     if(ch1 && ch2) return strcmp(ch1, ch2);
     else return 0;
 }
@@ -585,20 +2573,22 @@ void dictentry_sort(dictentry * de){
  */
 /*--------------------------------------------------------------------------*/
 void dictionary_sort_hash(dictionary * d){
-    if(!d) return;
+    if(!d || dictionary_own_all(d)) return;
     dictentry_sort(d->noname);
     size_t i, n = d->n;
-    dictentry *de = d->entries;
-    for(i = 0; i < n; ++i, ++de)
-        dictentry_sort(de);
-    qsort((void*)d->entries, d->n, sizeof(dictentry), cmpentries);
+    for(i = 0; i < n; ++i)
+        dictentry_sort(d->entries[i]);
+    qsort((void*)d->entries, d->n, sizeof(dictentry*), cmpentries);
     d->sorted = 1;
+    ++d->gen; // all items moved
+    dictionary_reindex_all(d);
 }
 
 /** Sort key/value pairs in dictionary section */
 void dictentry_sort_nm(dictentry * de){
     if(!de || !de->n) return;
     qsort((void*)de->kvlist, de->n, sizeof(keyval), cmpvalnm);
+    de->sorted = 0;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -612,11 +2602,96 @@ void dictentry_sort_nm(dictentry * de){
  */
 /*--------------------------------------------------------------------------*/
 void dictionary_sort(dictionary * d){
-    if(!d) return;
+    if(!d || dictionary_own_all(d)) return;
     dictentry_sort_nm(d->noname);
     size_t i, n = d->n;
-    dictentry *de = d->entries;
-    for(i = 0; i < n; ++i, ++de)
-        dictentry_sort_nm(de);
-    qsort((void*)d->entries, d->n, sizeof(dictentry), cmpentrienm);
+    for(i = 0; i < n; ++i)
+        dictentry_sort_nm(d->entries[i]);
+    qsort((void*)d->entries, d->n, sizeof(dictentry*), cmpentrienm);
+    d->sorted = 0;
+    ++d->gen;
+    dictionary_reindex_all(d);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Change thresholds for choosing lookup strategy.
+  @param    d   Dictionary to tune
+  @param    t   New thresholds or NULL to restore defaults
+  @return   0 if Ok, anything else otherwise
+
+  Set new thresholds (see dicttune_t) and rebuild indexes of all sections
+  according to them. `hash_min` less than `linear_max` is an error.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_tune(dictionary * d, const dicttune_t * t){
+    if(!d) return -1;
+    if(!t) t = &tune_default;
+    if(t->hash_min < t->linear_max) return -1;
+    if(dictionary_own_all(d)) return -1;
+    d->tune = *t;
+    dictionary_reindex_all(d);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Choose lookup strategy of all lists again.
+  @param    d   Dictionary to optimize
+  @return   0 if Ok, anything else otherwise
+
+  Lookups don't change indexes, so if lookups are counted (`count_reads`),
+  call this function from time to time to upgrade lists which are read
+  often. Only lists which strategy changed are reindexed.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_optimize(dictionary * d){
+    size_t i;
+    int ret = 0;
+    if(!d || dictionary_own_all(d)) return -1;
+    if(d->noname) ret |= dictentry_reindex(d->noname, &d->tune, 0);
+    for(i = 0; i < d->n; ++i)
+        if(d->entries[i]->name) ret |= dictentry_reindex(d->entries[i], &d->tune, 0);
+    ret |= dictionary_reindex(d, 0);
+    return ret;
+}
+
+/** Add statistics of list with given index */
+static void dictstats_add(dictstats_t * st, const dictindex * x){
+    ++st->nlists[x->mode];
+    st->nread += x->nread;
+    st->nwrite += x->nwrite;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get lookup statistics of a dictionary.
+  @param    d   Dictionary to examine
+  @param    st  Statistics to fill
+  @return   0 if Ok, anything else otherwise
+
+  Fill `st` with counts of sections and keys, number of lists (list of
+  sections and lists of keys in each section) using each lookup strategy
+  and total counts of lookups and insertions.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_stats(const dictionary * d, dictstats_t * st){
+    size_t i, j;
+    if(!d || !st) return -1;
+    memset(st, 0, sizeof(dictstats_t));
+    dictstats_add(st, &d->idx);
+    if(d->noname){
+        dictstats_add(st, &d->noname->idx);
+        for(j = 0; j < d->noname->n; ++j)
+            if(d->noname->kvlist[j].key) ++st->nkeys;
+    }
+    for(i = 0; i < d->n; ++i){
+        const dictentry *de = d->entries[i];
+        if(!de->name) continue; // deleted section
+        ++st->nsections;
+        dictstats_add(st, &de->idx);
+        for(j = 0; j < de->n; ++j)
+            if(de->kvlist[j].key) ++st->nkeys;
+    }
+    return 0;
 }
@@ -33,6 +33,19 @@ extern "C" {
 
 typedef uint32_t hash_t; /** hash is 32 bit unsigned */
 
+/** Invalid position in list (also position of unnamed section) */
+#define DICT_NOPOS  ((size_t)-1)
+
+/** Flags of converted values cached in keyval */
+#define KV_LONG         (1<<0)  /** `lval` is valid */
+#define KV_LONGBAD      (1<<1)  /** value isn't correct integer */
+#define KV_DOUBLE       (1<<2)  /** `dval` is valid */
+#define KV_DOUBLEBAD    (1<<3)  /** value isn't correct double */
+#define KV_BOOL         (1<<4)  /** boolean value is known */
+#define KV_TRUE         (1<<5)  /** value is boolean true */
+#define KV_BOOLBAD      (1<<6)  /** value isn't boolean */
+#define KV_DIRTY        (1<<7)  /** value changed since load or save (if source is tracked) */
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Key/value pair with hash
@@ -40,15 +53,119 @@ typedef uint32_t hash_t; /** hash is 32 bit unsigned */
   This object contains a pair key/value with hash. Looking up values
   in the dictionary is speeded up by the use of a (hopefully collision-free)
   hash function.
+  Results of value conversion to numbers are cached in `lval` and `dval` by
+  typed getters (iniparser_getint() etc), `vtype` shows which of them are
+  valid. Cache is reset by dictionary_set().
  */
 /*-------------------------------------------------------------------------*/
 typedef struct {
     char         *  key ;   /** Key name */
     char         *  val ;   /** Key value */
+    size_t          klen ;  /** Length of key name */
+    size_t          vlen ;  /** Length of value */
     hash_t          hash ;  /** Hash of key name */
+    unsigned        vtype ; /** Flags of cached values (KV_*) */
+    long            lval ;  /** Value converted to long int */
+    double          dval ;  /** Value converted to double */
+    size_t          src ;   /** Number of span in source file + 1 (0 if not known, see dictsrc) */
 } keyval;
 
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Lookup strategy of a list of keys or sections
+
+  Small lists are scanned linearly, middle-sized lists which are read much
+  more often than written get an array of positions sorted by hash (binary
+  search), large lists get an open addressing hash table. The strategy is
+  chosen automatically, see dicttune_t.
+ */
+/*-------------------------------------------------------------------------*/
+typedef enum{
+    DICT_LINEAR = 0,    // linear scan of list
+    DICT_SORTED,        // binary search in positions sorted by hash
+    DICT_HASHED,        // hash table of positions
+    DICT_NMODES         // amount of modes
+} dictmode_t;
+
+/** Index slot: hash of list item & its position in list */
+typedef struct {
+    hash_t          hash ;  /** Hash of item name */
+    size_t          pos ;   /** Position of item in list */
+} dictslot;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Lookup index of a list of keys or sections
+
+  Index stores only positions of items, so the order of items in list (e.g.
+  order of keys in ini file) is kept. Deleted items are not removed from
+  index: they are filled with zeros, so the name check fails on them.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    dictmode_t      mode ;  /** Current lookup strategy */
+    size_t          n ;     /** Number of slots used */
+    size_t          size ;  /** Number of slots allocated */
+    dictslot     *  slots ; /** Sorted array (DICT_SORTED) or hash table (DICT_HASHED) */
+    size_t          nread ; /** Number of lookups in list */
+    size_t          nwrite ;/** Number of insertions into list */
+} dictindex;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Thresholds for choosing lookup strategy
+
+  Lists with up to `linear_max` items are always scanned linearly; lists
+  with `hash_min` items or more always have hash index. Lists of middle
+  size get sorted index. If `count_reads` is set, lookups are counted and
+  middle-sized lists get sorted index only when there was at least
+  `sort_ratio` lookups per insertion, otherwise they are scanned linearly.
+  Counting makes each lookup write to shared counter, so don't set it for
+  dictionaries read by many threads.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    size_t          linear_max ;/** Max size of list for linear scan */
+    size_t          hash_min ;  /** Min size of list for hash index */
+    size_t          sort_ratio ;/** Min reads per write for sorted index */
+    int             count_reads;/** ==1 to count lookups (0 by default) */
+} dicttune_t;
+
+/** Statistics of dictionary lookups */
+typedef struct {
+    size_t          nsections ; /** Number of named sections */
+    size_t          nkeys ;     /** Number of keys (all sections) */
+    size_t          nlists[DICT_NMODES]; /** Number of lists in each mode */
+    size_t          nread ;     /** Total number of lookups */
+    size_t          nwrite ;    /** Total number of insertions */
+} dictstats_t;
+
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Resolved key
+
+  Position of key/value pair in dictionary. Positions are not changed when
+  values are modified, other keys or sections are added or deleted, so the
+  key can be accessed directly. Only sorting of dictionary moves items: it
+  changes `gen` of dictionary, so all keys resolved before become stale.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    size_t          sec ;   /** Position of section (DICT_NOPOS for unnamed) */
+    size_t          pos ;   /** Position of key in section (DICT_NOPOS if not found) */
+    unsigned long   gen ;   /** Generation of dictionary */
+} dictkey;
+
+/** Order of items (sorted orders are built on demand) */
+typedef enum{
+    DICT_BYNAME = 0,    // sorted by name
+    DICT_BYHASH,        // sorted by hash
+    DICT_NORDERS,       // amount of orders built on demand
+    DICT_BYPOS = DICT_NORDERS // storage order: order of adding (of reading from file)
+} dictorder_t;
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dictionary entry object
@@ -61,12 +178,80 @@ typedef struct {
     size_t          n ;     /** Number of pairs in object */
     size_t          len ;   /** amount of memory allocated for kvlist (if n == len, grow entry size) */
     keyval       *  kvlist ;/** list of key/value pairs */
-    int             sorted ;/** ==1 if kvlist sorted */
+    int             sorted ;/** ==1 if kvlist sorted by hash */
     char         *  name;   /** entry name */
+    size_t          nlen ;  /** Length of entry name */
     hash_t          hash ;  /** Hash of entry name */
+    dictindex       idx ;   /** Lookup index of kvlist */
+    size_t       *  order[DICT_NORDERS] ; /** Keys positions in given order: [0] - amount, then positions (NULL if not built) */
+    size_t          shared ;/** Number of other dictionaries sharing entry (see dictionary_clone()) */
+    size_t          src ;   /** Number of span in source file + 1 (0 if not known) */
+    size_t          tlen ;  /** Length of text of section in file (0 if unknown or entry was changed, see iniparser_reload()) */
+    uint64_t        text ;  /** 64-bit hash of text of section in file (see iniparser_reload()) */
 } dictentry;
 
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Position of key or section in source file
+
+  For key: its line and value (with quotes if any); multi-line values are
+  replaced with whole lines (`whole` is 1). For section: its header line;
+  `val` is the end of section (offset of next header or end of file).
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    off_t           line ;  /** Offset of line */
+    size_t          llen ;  /** Length of line(s) with newline */
+    off_t           val ;   /** Offset of value (end of section for sections) */
+    size_t          vlen ;  /** Length of value in file */
+    int             whole ; /** ==1 if value should be changed with whole line */
+    int             section;/** ==1 for section */
+    int             removed;/** ==1 if item was deleted from dictionary */
+} dictspan;
+
+/** Changed item of dictionary: key changed or added, or span removed */
+typedef struct {
+    size_t          sec ;   /** Section of key (DICT_NOPOS for unnamed) */
+    size_t          pos ;   /** Position of key in section */
+    size_t          span ;  /** Number of span removed + 1 (0 for key changed) */
+} dictchange;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Source file of dictionary: positions of items and changes
+
+  Filled by iniparser_load_tracked(). dictionary_set() stores in `changes`
+  keys changed or added (they are marked by KV_DIRTY) and spans of keys and
+  sections deleted, so only changed spans of file could be rewritten (see
+  iniparser_save_incremental()).
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    char         *  file ;      /** File name */
+    dictspan     *  spans ;     /** Positions of keys and sections */
+    size_t          nspans ;    /** Number of spans */
+    size_t          lspans ;    /** Amount of memory allocated for spans */
+    off_t           noname_end ;/** End of keys outside of sections (first section header) */
+    off_t           size ;      /** Size of file */
+    int             nlend ;     /** ==1 if file ends with newline */
+    dictchange   *  changes ;   /** Keys changed and spans removed */
+    size_t          nchanges ;  /** Number of changes */
+    size_t          lchanges ;  /** Amount of memory allocated for changes */
+    unsigned long   gen ;       /** Generation of dictionary when changes started */
+    int             lost ;      /** ==1 if list of changes is incomplete (no memory or items moved):
+                                    all items should be checked for KV_DIRTY and `removed` */
+} dictsrc;
+
+/** Memory of old version of dictionary waiting to be freed (see dictionary_update()) */
+typedef struct {
+    void         *  p ;         /** Memory to free */
+    void (*fn)(void *) ;        /** Function to free it */
+} dictgarbage;
+
+/** Function called after each successful dictionary_set_n() (val is NULL for erasing) */
+typedef void (*dicthook_t)(void * arg, const char * key, size_t klen, const char * val, size_t vlen);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dictionary object
@@ -78,10 +263,72 @@ typedef struct _dictionary_ {
     size_t          n ;     /** Number of named entries in dictionary */
     size_t          len ;   /** amount of memory allocated for entries (if n == len, grow dictionary size) */
     dictentry    *  noname ;/** Unnamed entry (key/value pairs outside of any named block) */
-    dictentry    *  entries;/** List of entries in dictionary */
-    int             sorted ;/** ==1 if all entries are sorted */
+    dictentry    ** entries;/** List of entries in dictionary (deleted entries are filled with zeros) */
+    int             sorted ;/** ==1 if all entries are sorted by hash */
+    dictindex       idx ;   /** Lookup index of entries */
+    dicttune_t      tune ;  /** Thresholds for lookup strategy */
+    unsigned long   gen ;   /** Generation: incremented when items are moved */
+    size_t       *  order[DICT_NORDERS] ; /** Entries positions in given order (as in dictentry) */
+    size_t          last ;  /** Position of entry last changed by dictionary_set() */
+    dictgarbage  *  garbage ;   /** Memory released while building new version (NULL: free at once) */
+    size_t          ngarbage ;  /** Number of items in `garbage` */
+    dictsrc      *  src ;       /** Source file positions and changes (NULL if not tracked) */
+    dicthook_t      hook ;      /** Called after each change (see dictionary_sethook()) */
+    void         *  hookarg ;   /** Argument of `hook` */
 } dictionary ;
 
+#define DICTQ_GLOB      (1<<0)  /** pattern is glob (wildcards `*`, `?`, `[...]`), else prefix */
+#define DICTQ_LWC       (1<<1)  /** compare with lowercased pattern */
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Query of keys or sections by name (see dictionary_query())
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    const dictionary *  d ;     /** Dictionary to search */
+    const dictentry  *  de ;    /** Section to search keys in or NULL to search sections */
+    const size_t     *  order ; /** Name order of items (NULL if nothing to search) */
+    const char       *  pattern;/** Prefix or glob pattern */
+    size_t              plen ;  /** Length of literal prefix of pattern */
+    size_t              cur ;   /** Current position in `order` */
+    int                 flags ; /** DICTQ_* flags */
+} dictquery;
+
+/** Iterator over entries or keys of entry (see dictionary_iter()) */
+typedef struct {
+    const dictionary *  d ;     /** Dictionary */
+    const dictentry  *  de ;    /** Entry to walk over its keys or NULL to walk over entries */
+    const size_t     *  order ; /** Positions in given order (NULL for storage order) */
+    size_t              cur ;   /** Number of current item */
+    size_t              n ;     /** Amount of items */
+} dictiter;
+
+/** Key split and hashed once to search it in many dictionaries (see dictprobe_init()) */
+typedef struct {
+    const char  *   sec ;   /** Section name (NULL for keys outside of sections) */
+    size_t          slen ;  /** Length of section name */
+    hash_t          shash ; /** Hash of section name */
+    const char  *   key ;   /** Key name */
+    size_t          klen ;  /** Length of key name */
+    hash_t          khash ; /** Hash of key name */
+    int             lwc ;   /** ==1 to compare lowercased */
+} dictprobe;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Overlay: stack of dictionaries read as if they were merged
+
+  Layers are searched from the last one (highest priority, e.g. host
+  overrides) to the first one (e.g. built-in defaults). Overlay only refers
+  to layers: they are not copied, so their changes are seen at once.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    const dictionary * const * layers ; /** Layers from lowest to highest priority */
+    size_t              n ;     /** Number of layers */
+} dictoverlay;
+
 
 /*---------------------------------------------------------------------------
                             Function prototypes
@@ -101,6 +348,9 @@ typedef struct _dictionary_ {
 /*--------------------------------------------------------------------------*/
 hash_t dictionary_hash(const char * key);
 
+/** The same as dictionary_hash() for string `key` of length `len` (not necessary zero-terminated) */
+hash_t dictionary_hash_n(const char * key, size_t len);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Create a new dictionary & dictentry object.
@@ -127,6 +377,22 @@ dictentry * dictentry_new(size_t size);
 void dictionary_del(dictionary * o);
 void dictentry_del(dictentry * o);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Clone a dictionary.
+  @param    d   dictionary object to clone.
+  @return   new dictionary or NULL in case of failure
+
+  Clone shares sections and strings with `d` by reference counting, so
+  cloning costs O(number of sections). A section is copied (without its
+  strings) when clone or `d` changes it first; sorting, dictionary_tune()
+  and dictionary_optimize() copy all sections. Clones could be changed and
+  deleted independently, also from different threads. Don't change shared
+  sections directly (e.g. by dictentry_sort()).
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * dictionary_clone(const dictionary * d);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get a value from a dictionary.
@@ -143,6 +409,131 @@ void dictentry_del(dictentry * o);
 /*--------------------------------------------------------------------------*/
 const char * dictionary_get(const dictionary * d, const char * key, const char * def);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get a value from a dictionary by key of given length.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    def     Default value to return if key not found.
+  @param    vlen    If not NULL, length of value returned.
+  @return   pointer to internally allocated character string.
+
+  The same as dictionary_get(), but key could be a part of larger buffer:
+  it isn't copied and no zero-terminated strings are scanned.
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictionary_get_n(const dictionary * d, const char * key, size_t len, const char * def, size_t * vlen);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in a dictionary.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for in the dictionary ("entryname:keyname").
+  @param    h       If not NULL, filled with position of key found.
+  @return   pointer to key/value pair or NULL if not found.
+
+  If key not found, `h` is filled with invalid position. The key/value pair
+  returned is internal to the dictionary, don't modify it.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_getkv(const dictionary * d, const char * key, dictkey * h);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in a dictionary by key of given length.
+  @param    d       dictionary object to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key` (keys in dictionary should be lowercase).
+  @param    h       If not NULL, filled with position of key found.
+  @return   pointer to key/value pair or NULL if not found.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_getkv_n(const dictionary * d, const char * key, size_t len, int lwc, dictkey * h);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in given section of a dictionary.
+  @param    d       dictionary object containing `de`.
+  @param    de      section to search (d->noname or an item of d->entries).
+  @param    key     Key to look for in the section ("keyname").
+  @return   pointer to key/value pair or NULL if not found.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictentry_getkv(const dictionary * d, const dictentry * de, const char * key);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get key/value pair by resolved key.
+  @param    d       dictionary object to search.
+  @param    h       key resolved by dictionary_getkv().
+  @return   pointer to key/value pair or NULL if `h` is invalid or stale.
+
+  Access is direct: no strings are compared. NULL is returned if key
+  wasn't found when resolved, if it was deleted after this or if the
+  dictionary was sorted (so `h.gen` differs from `d->gen`).
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictionary_keyval(const dictionary * d, dictkey h);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get values of many keys from a dictionary.
+  @param    d       dictionary object to search.
+  @param    keys    array of keys ("entryname:keyname" or "keyname").
+  @param    n       number of keys.
+  @param    out     array of `n` values.
+  @param    lwc     ==1 to search keys case-insensitive.
+  @return   number of keys found.
+
+  For each key found, its value is stored in corresponding item of `out`.
+  Items of `out` for keys not found aren't changed, so `out` can be filled
+  with default values before call.
+  Keys are processed in groups: keys of group are hashed first, sorted by
+  section, then searched simultaneously with prefetching memory. This
+  function don't modify anything in dictionary or global state.
+  When `lwc` is 1, keys in dictionary should be lowercase (as keys of
+  dictionary loaded by iniparser_load()).
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictionary_get_batch(const dictionary * d, const char ** keys, size_t n, const char ** out, int lwc);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Prepare key for searching in many dictionaries.
+  @param    p       probe to fill.
+  @param    key     Key ("entryname:keyname" or "keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+
+  Key is split and hashed once, probe refers to `key` without copying it.
+ */
+/*--------------------------------------------------------------------------*/
+void dictprobe_init(dictprobe * p, const char * key, size_t len, int lwc);
+
+/** Find key/value pair prepared by dictprobe_init() (NULL if not found) */
+const keyval * dictionary_probe(const dictionary * d, const dictprobe * p);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a key/value pair in overlay of dictionaries.
+  @param    o       overlay to search.
+  @param    key     Key to look for ("entryname:keyname", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to search lowercased `key`.
+  @param    layer   If not NULL, filled with number of layer where key found.
+  @return   pointer to key/value pair of the highest layer containing key or NULL.
+
+  Key is hashed once for all layers, so lookup missing in upper layers costs
+  only index probes. NULL layers are skipped.
+ */
+/*--------------------------------------------------------------------------*/
+const keyval * dictoverlay_getkv_n(const dictoverlay * o, const char * key, size_t len, int lwc, size_t * layer);
+
+/** The same as dictionary_get() for overlay of dictionaries */
+const char * dictoverlay_get(const dictoverlay * o, const char * key, const char * def);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Find a section from given dictionary.
@@ -156,6 +547,9 @@ const char * dictionary_get(const dictionary * d, const char * key, const char *
 /*--------------------------------------------------------------------------*/
 dictentry * dictentry_find(const dictionary * d, const char * key);
 
+/** Position of section in d->entries (DICT_NOPOS if not found) */
+size_t dictentry_pos(const dictionary * d, const char * key);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Set a value in a dictionary.
@@ -186,11 +580,150 @@ dictentry * dictentry_find(const dictionary * d, const char * key);
 /*--------------------------------------------------------------------------*/
 int dictionary_set(dictionary * vd, const char * key, const char * val);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value in a dictionary by key and value of given length.
+  @param    d       dictionary object to modify.
+  @param    key     Key to modify or add ("entryname:keyname", not necessary zero-terminated).
+  @param    klen    Length of `key`.
+  @param    val     Value to add (not necessary zero-terminated) or NULL to erase.
+  @param    vlen    Length of `val`.
+  @return   int     0 if Ok, anything else otherwise
+
+  The same as dictionary_set(), but key and value could be parts of larger
+  buffer: they are copied with given lengths.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_set_n(dictionary * d, const char * key, size_t klen, const char * val, size_t vlen);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make new version of a dictionary with one value changed.
+  @param    d       dictionary object (not modified).
+  @param    key     Key to modify, add or erase (as in dictionary_set_n()).
+  @param    klen    Length of `key`.
+  @param    val     Value to set or NULL to erase.
+  @param    vlen    Length of `val`.
+  @param    garbage filled with array of memory of `d` not used by new version.
+  @param    ngarbage filled with number of items in `garbage`.
+  @return   new version or NULL in case of failure
+
+  New version shares with `d` all sections except changed one: only that
+  section and arrays of sections are copied, strings aren't copied at all.
+  So readers can use `d` while new version is built. When no reader can see
+  `d` any more, call `fn(p)` for each item of `garbage` (the last one is `d`
+  itself) and free() the array. On failure `d` stays unchanged and valid.
+  See dictrcu.h for ready-to-use wrapper.
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * dictionary_update(const dictionary * d, const char * key, size_t klen,
+                               const char * val, size_t vlen, dictgarbage ** garbage, size_t * ngarbage);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set function called after each change of dictionary.
+  @param    d       dictionary object.
+  @param    hook    function (NULL to remove it).
+  @param    arg     its first argument.
+
+  Hook gets key and value as they were given to dictionary_set_n(), so
+  calling dictionary_set_n() with them repeats the change (e.g. journal
+  could replay changes). Copies and clones of dictionary have no hook.
+ */
+/*--------------------------------------------------------------------------*/
+void dictionary_sethook(dictionary * d, dicthook_t hook, void * arg);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Add section of other dictionary sharing it.
+  @param    d       dictionary object to modify.
+  @param    de      section of other dictionary (unnamed section replaces empty unnamed section of `d`).
+  @return   0 if Ok, -1 if there's section with the same name or no memory
+
+  Section is shared as by dictionary_clone(): it is copied when one of
+  dictionaries changes it first. New section is the last in `d`.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_adopt(dictionary * d, const dictentry * de);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start or stop tracking source file of dictionary.
+  @param    d       dictionary object.
+  @param    file    name of source file or NULL to stop tracking.
+  @return   0 if Ok, anything else otherwise
+
+  Spans of items in source file are dropped; fill them by dictsrc_addspan().
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_track(dictionary * d, const char * file);
+
+/** Add span to source of dictionary, returns its number + 1 (for `src` fields) or 0 if no memory */
+size_t dictsrc_addspan(dictsrc * s, const dictspan * span);
+
+/** Forget changes of dictionary (after they were saved) */
+void dictsrc_clean(dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start query of sections or keys by name.
+  @param    d       dictionary object to search.
+  @param    pattern "entryname:pattern" to search keys in given entry (":pattern"
+                    for keys outside of entries) or "pattern" to search entries.
+  @param    flags   DICTQ_GLOB for glob pattern, DICTQ_LWC to compare lowercased.
+  @param    q       query to initialize.
+  @return   0 if Ok, anything else otherwise
+
+  Items are searched in name order which is built on first query and then
+  updated when items added or deleted (O(log n) search and O(n) move). The range of names starting with prefix
+  (literal prefix of glob pattern) is found by binary search, so query costs
+  O(log n + matches). Dictionary shouldn't be changed while query is in use.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_query(const dictionary * d, const char * pattern, int flags, dictquery * q);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item of query.
+  @param    q       query initialized by dictionary_query().
+  @param    name    If not NULL, name of key or entry found.
+  @param    val     If not NULL, value of key found (NULL for entries).
+  @return   1 if item found, 0 if there's no more items.
+ */
+/*--------------------------------------------------------------------------*/
+int dictquery_next(dictquery * q, const char ** name, const char ** val);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start walking over entries or keys of entry.
+  @param    d       dictionary object.
+  @param    de      entry to walk over its keys or NULL to walk over entries.
+  @param    how     order of items (DICT_BYPOS, DICT_BYNAME or DICT_BYHASH).
+  @param    it      iterator to initialize.
+  @return   0 if Ok, anything else otherwise
+
+  Iterator itself needs no memory; sorted orders are built once and then
+  updated when items added or deleted. Dictionary shouldn't be changed while
+  iterating.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_iter(const dictionary * d, const dictentry * de, dictorder_t how, dictiter * it);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item of iterator.
+  @param    it      iterator initialized by dictionary_iter().
+  @return   position of item (in de->kvlist or d->entries) or DICT_NOPOS at end.
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictiter_next(dictiter * it);
+
 
 typedef enum{
     DERR_OK = 0,    // all OK
     DERR_BADDATA,   // bad arguments of function (NULL instead of data)
-    DERR_EMPTY      // empty dictionary
+    DERR_EMPTY,     // empty dictionary
+    DERR_IO         // output failed
 } dicterr_t;
 
 /*-------------------------------------------------------------------------*/
@@ -203,11 +736,51 @@ typedef enum{
   Dumps a dictionary onto an opened file pointer. Key pairs are printed out
   as @c [Key]=[Value], one per line. It is Ok to provide stdout or stderr as
   output file pointers.
+  Lines are formatted without printf into large buffer, which is written
+  by one fwrite() per 64K.
  */
 /*--------------------------------------------------------------------------*/
 dicterr_t dictionary_dump(const dictionary * d, FILE * out);
 void dictentry_dump(const dictentry *de, FILE *out);
 
+/** The same as dictionary_dump() into file descriptor */
+dicterr_t dictionary_dump_fd(const dictionary * d, int fd);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into file by several threads.
+  @param    d           Dictionary to dump
+  @param    fd          File descriptor opened for writing
+  @param    nthreads    Number of threads
+  @return   0 or error code
+
+  Output is the same as of dictionary_dump(). Sections are divided into
+  `nthreads` parts of roughly equal size, each part is formatted in its
+  own thread and written by pwrite() at its offset (sizes are computed
+  first). Non-seekable descriptors, descriptors opened with O_APPEND and
+  small dictionaries (less than 1M of output) are dumped by calling thread.
+ */
+/*--------------------------------------------------------------------------*/
+dicterr_t dictionary_dump_parallel(const dictionary * d, int fd, int nthreads);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into memory buffer.
+  @param    d       Dictionary to dump
+  @param    buf     Buffer
+  @param    size    Size of buffer
+  @return   size of dump in bytes (0 if dictionary is empty)
+
+  Output is the same as of dictionary_dump(). If `size` is less than size
+  of dump, nothing is written (so call it with NULL `buf` to get the size);
+  if there's room, dump is terminated by zero.
+ */
+/*--------------------------------------------------------------------------*/
+size_t dictionary_dump_mem(const dictionary * d, char * buf, size_t size);
+
+/** Exact size of dictionary_dump() output in bytes */
+size_t dictionary_dump_size(const dictionary * d);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Sort objects stored in dictionary for quick binary search.
@@ -215,6 +788,8 @@ void dictentry_dump(const dictentry *de, FILE *out);
   @return   void
 
   Sort all records in dictionary by their hash.
+  There's no need to call it for quick search: lookup indexes are
+  maintained automatically (see dictionary_tune()).
  */
 /*--------------------------------------------------------------------------*/
 void dictionary_sort_hash(dictionary *d);
@@ -222,6 +797,47 @@ void dictionary_sort_hash(dictionary *d);
 /** Sort by names */
 void dictionary_sort(dictionary *d);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Change thresholds for choosing lookup strategy.
+  @param    d   Dictionary to tune
+  @param    t   New thresholds or NULL to restore defaults
+  @return   0 if Ok, anything else otherwise
+
+  Set new thresholds (see dicttune_t) and rebuild indexes of all sections
+  according to them. `hash_min` less than `linear_max` is an error.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_tune(dictionary *d, const dicttune_t *t);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Choose lookup strategy of all lists again.
+  @param    d   Dictionary to optimize
+  @return   0 if Ok, anything else otherwise
+
+  Lookups never change dictionary, so they could be made from many threads
+  simultaneously. Lookup strategy is chosen when items are added; if
+  lookups are counted (`count_reads` in dicttune_t), call this function
+  to upgrade lists which are read often.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_optimize(dictionary *d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get lookup statistics of a dictionary.
+  @param    d   Dictionary to examine
+  @param    st  Statistics to fill
+  @return   0 if Ok, anything else otherwise
+
+  Fill `st` with counts of sections and keys, number of lists (list of
+  sections and lists of keys in each section) using each lookup strategy
+  and total counts of lookups and insertions.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_stats(const dictionary *d, dictstats_t *st);
+
 #ifdef __cplusplus
 }
 #endif
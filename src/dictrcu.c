@@ -0,0 +1,153 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictrcu.c
+   @author  E.V. Emelianov
+   @brief   Dictionary read by many threads while it is changed.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#include "dictrcu.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+dictrcu * dictrcu_new(dictionary * d)
+{
+    dictrcu *rc;
+    if(!d) return NULL;
+    if(!(rc = calloc(1, sizeof(dictrcu)))) return NULL;
+    if(!(rc->epoch = epoch_new())){
+        free(rc);
+        return NULL;
+    }
+    if(pthread_mutex_init(&rc->lock, NULL)){
+        epoch_del(rc->epoch);
+        free(rc);
+        return NULL;
+    }
+    rc->cur = d;
+    return rc;
+}
+
+void dictrcu_del(dictrcu * rc)
+{
+    if(!rc) return;
+    epoch_del(rc->epoch); // frees old versions
+    dictionary_del(rc->cur);
+    pthread_mutex_destroy(&rc->lock);
+    free(rc);
+}
+
+epoch_reader * dictrcu_reader_new(dictrcu * rc)
+{
+    if(!rc) return NULL;
+    return epoch_reader_new(rc->epoch);
+}
+
+void dictrcu_reader_del(epoch_reader * r)
+{
+    epoch_reader_del(r);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start reading
+  @param    rc  versioned dictionary
+  @param    r   reader of calling thread
+  @return   current version of dictionary
+
+  Epoch is entered before the pointer is loaded: if writer retired this
+  version after it was loaded, it sees the reader.
+ */
+/*--------------------------------------------------------------------------*/
+const dictionary * dictrcu_read_lock(dictrcu * rc, epoch_reader * r)
+{
+    epoch_enter(rc->epoch, r);
+    return __atomic_load_n(&rc->cur, __ATOMIC_ACQUIRE);
+}
+
+void dictrcu_read_unlock(epoch_reader * r)
+{
+    epoch_leave(r);
+}
+
+int dictrcu_set(dictrcu * rc, const char * key, const char * val)
+{
+    if(!key) return -1;
+    return dictrcu_set_n(rc, key, strlen(key), val, val ? strlen(val) : 0);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value and publish new version
+  @param    rc  versioned dictionary
+  @param    key Key to modify or add (not necessary zero-terminated)
+  @param    klen Length of `key`
+  @param    val Value to set (not necessary zero-terminated) or NULL to erase
+  @param    vlen Length of `val`
+  @return   0 if Ok, anything else otherwise
+
+  Memory of old version is retired only after new version is published,
+  so readers entered later can't get it.
+ */
+/*--------------------------------------------------------------------------*/
+int dictrcu_set_n(dictrcu * rc, const char * key, size_t klen, const char * val, size_t vlen)
+{
+    dictionary *nd;
+    dictgarbage *g = NULL;
+    size_t i, n = 0;
+    if(!rc || !key) return -1;
+    pthread_mutex_lock(&rc->lock);
+    nd = dictionary_update(rc->cur, key, klen, val, vlen, &g, &n);
+    if(nd){
+        __atomic_store_n(&rc->cur, nd, __ATOMIC_SEQ_CST);
+        for(i = 0; i < n; ++i) epoch_retire(rc->epoch, g[i].p, g[i].fn);
+        free(g);
+    }
+    pthread_mutex_unlock(&rc->lock);
+    if(!nd) return -1;
+    epoch_reclaim(rc->epoch);
+    return 0;
+}
+
+/** Free retired version of dictionary */
+static void dictrcu_free(void * p)
+{
+    dictionary_del((dictionary*)p);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Publish new dictionary as current version
+  @param    rc  versioned dictionary
+  @param    d   new version (e.g. returned by iniparser_load())
+  @return   0 if Ok, -1 in case of error
+
+  Old version is retired as whole: it is freed by dictionary_del() when
+  readers which could see it leave their epochs.
+ */
+/*--------------------------------------------------------------------------*/
+int dictrcu_replace(dictrcu * rc, dictionary * d)
+{
+    dictionary *old;
+    if(!rc || !d) return -1;
+    pthread_mutex_lock(&rc->lock);
+    old = rc->cur;
+    __atomic_store_n(&rc->cur, d, __ATOMIC_SEQ_CST);
+    epoch_retire(rc->epoch, old, dictrcu_free);
+    pthread_mutex_unlock(&rc->lock);
+    epoch_reclaim(rc->epoch);
+    return 0;
+}
+
+void dictrcu_synchronize(dictrcu * rc)
+{
+    if(rc) epoch_synchronize(rc->epoch);
+}
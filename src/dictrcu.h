@@ -0,0 +1,148 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictrcu.h
+   @author  E.V. Emelianov
+   @brief   Dictionary read by many threads while it is changed.
+
+   Writers don't change dictionary in place: each change makes new version
+   (see dictionary_update()) sharing unchanged sections with the old one,
+   and publishes it by single pointer store. Readers take current version
+   inside an epoch (see epoch.h) and run wait-free on it: no locks, no
+   writes to shared memory. Memory of old versions (including old values)
+   is freed when all readers which could see it left their epochs, so
+   strings returned by getters stay valid until dictrcu_read_unlock().
+
+   @code
+   epoch_reader *r = dictrcu_reader_new(rc); // once per thread
+   const dictionary *d = dictrcu_read_lock(rc, r);
+   const char *v = dictionary_get(d, "flags:newui", "off");
+   ... // use `v`
+   dictrcu_read_unlock(r);
+   @endcode
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DICTRCU_H_
+#define _DICTRCU_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "dictionary.h"
+#include "epoch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Versioned dictionary
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    dictionary  *   cur ;   /** Current version */
+    epoch_t     *   epoch ; /** Readers and memory of old versions */
+    pthread_mutex_t lock ;  /** Serializes writers */
+} dictrcu;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make dictionary concurrent
+  @param    d   dictionary object (e.g. returned by iniparser_load())
+  @return   versioned dictionary or NULL in case of failure
+
+  `d` becomes first version: it is freed by dictrcu_del() and shouldn't be
+  changed directly any more.
+ */
+/*--------------------------------------------------------------------------*/
+dictrcu * dictrcu_new(dictionary * d);
+
+/** Delete versioned dictionary with all its versions (there should be no readers) */
+void dictrcu_del(dictrcu * rc);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Register and unregister reader
+  @param    rc  versioned dictionary
+  @return   reader or NULL if no memory
+
+  Each reading thread should have its own reader.
+ */
+/*--------------------------------------------------------------------------*/
+epoch_reader * dictrcu_reader_new(dictrcu * rc);
+void dictrcu_reader_del(epoch_reader * r);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start and finish reading
+  @param    rc  versioned dictionary
+  @param    r   reader of calling thread
+  @return   current version of dictionary
+
+  Version returned and all strings got from it stay valid until
+  dictrcu_read_unlock(). Use any const function of dictionary or iniparser
+  on it. Both calls are wait-free; they could be nested.
+ */
+/*--------------------------------------------------------------------------*/
+const dictionary * dictrcu_read_lock(dictrcu * rc, epoch_reader * r);
+void dictrcu_read_unlock(epoch_reader * r);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value and publish new version
+  @param    rc  versioned dictionary
+  @param    key Key to modify or add ("entryname:keyname") or section to delete
+  @param    val Value to set or NULL to erase
+  @return   0 if Ok, anything else otherwise
+
+  The same as dictionary_set() and dictionary_set_n(). Writers are
+  serialized by mutex; readers aren't blocked. Memory of old versions
+  which can't be seen by readers is freed at once. Note that keys of
+  dictionary loaded by iniparser_load() are lowercase. Writer shouldn't be
+  inside dictrcu_read_lock() of its own.
+ */
+/*--------------------------------------------------------------------------*/
+int dictrcu_set(dictrcu * rc, const char * key, const char * val);
+int dictrcu_set_n(dictrcu * rc, const char * key, size_t klen, const char * val, size_t vlen);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Publish new dictionary as current version
+  @param    rc  versioned dictionary
+  @param    d   new version (e.g. returned by iniparser_load())
+  @return   0 if Ok, -1 in case of error
+
+  Used to swap whole dictionary (e.g. reloaded file): readers see old or
+  new version, old one is freed after its readers leave their epochs.
+  `d` is owned by `rc` after the call.
+ */
+/*--------------------------------------------------------------------------*/
+int dictrcu_replace(dictrcu * rc, dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Wait for readers of old versions and free their memory
+  @param    rc  versioned dictionary
+
+  Calling thread shouldn't be inside dictrcu_read_lock().
+ */
+/*--------------------------------------------------------------------------*/
+void dictrcu_synchronize(dictrcu * rc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
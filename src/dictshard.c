@@ -0,0 +1,177 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictshard.c
+   @author  E.V. Emelianov
+   @brief   Dictionary written by many threads.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#include "dictshard.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------
+                            Private functions
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find shard of key
+  @param    ds  sharded dictionary
+  @param    key "entryname:keyname", "keyname" or section name
+  @param    len length of `key`
+  @return   shard containing `key`
+ */
+/*--------------------------------------------------------------------------*/
+static dictshard_item * dictshard_of(const dictshard * ds, const char * key, size_t len)
+{
+    const char *delim = memchr(key, ':', len);
+    if(delim) len = (size_t)(delim - key);
+    return &ds->shards[dictionary_hash_n(key, len) & (ds->n - 1)];
+}
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+dictshard * dictshard_new(size_t n)
+{
+    dictshard *ds;
+    size_t i, size = 1;
+    if(!n) n = DICTSHARD_DEFAULT;
+    while(size < n) size <<= 1;
+    if(!(ds = calloc(1, sizeof(dictshard)))) return NULL;
+    if(posix_memalign((void**)&ds->shards, 64, size * sizeof(dictshard_item))){
+        free(ds);
+        return NULL;
+    }
+    for(i = 0; i < size; ++i){
+        if(!(ds->shards[i].d = dictionary_new(0))) break;
+        if(pthread_rwlock_init(&ds->shards[i].lock, NULL)){
+            dictionary_del(ds->shards[i].d);
+            break;
+        }
+    }
+    ds->n = i;
+    if(i < size){
+        dictshard_del(ds);
+        return NULL;
+    }
+    return ds;
+}
+
+void dictshard_del(dictshard * ds)
+{
+    size_t i;
+    if(!ds) return;
+    for(i = 0; i < ds->n; ++i){
+        pthread_rwlock_destroy(&ds->shards[i].lock);
+        dictionary_del(ds->shards[i].d);
+    }
+    free(ds->shards);
+    free(ds);
+}
+
+int dictshard_set(dictshard * ds, const char * key, const char * val)
+{
+    if(!key) return -1;
+    return dictshard_set_n(ds, key, strlen(key), val, val ? strlen(val) : 0);
+}
+
+int dictshard_set_n(dictshard * ds, const char * key, size_t klen, const char * val, size_t vlen)
+{
+    dictshard_item *s;
+    int ret;
+    if(!ds || !key) return -1;
+    s = dictshard_of(ds, key, klen);
+    pthread_rwlock_wrlock(&s->lock);
+    ret = dictionary_set_n(s->d, key, klen, val, vlen);
+    pthread_rwlock_unlock(&s->lock);
+    return ret;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Copy all keys of a dictionary into sharded dictionary
+  @param    ds  sharded dictionary
+  @param    d   dictionary object
+  @return   0 if Ok, anything else otherwise
+
+  Each section goes into one shard, so its shard is locked once.
+ */
+/*--------------------------------------------------------------------------*/
+int dictshard_add(dictshard * ds, const dictionary * d)
+{
+    size_t i, j, size = 0;
+    char *key = NULL;
+    int ret = 0;
+    if(!ds || !d) return -1;
+    for(j = 0; j < d->noname->n && !ret; ++j){
+        const keyval *kv = &d->noname->kvlist[j];
+        if(kv->key) ret = dictshard_set_n(ds, kv->key, kv->klen, kv->val, kv->vlen);
+    }
+    for(i = 0; i < d->n && !ret; ++i){
+        const dictentry *de = d->entries[i];
+        dictshard_item *s;
+        if(!de->name) continue; // deleted
+        s = dictshard_of(ds, de->name, de->nlen);
+        pthread_rwlock_wrlock(&s->lock);
+        for(j = 0; j < de->n && !ret; ++j){
+            const keyval *kv = &de->kvlist[j];
+            size_t len = de->nlen + 1 + kv->klen;
+            if(!kv->key) continue;
+            if(len > size){
+                char *k = realloc(key, len);
+                if(!k){
+                    ret = -1;
+                    break;
+                }
+                key = k;
+                size = len;
+            }
+            memcpy(key, de->name, de->nlen);
+            key[de->nlen] = ':';
+            memcpy(key + de->nlen + 1, kv->key, kv->klen);
+            ret = dictionary_set_n(s->d, key, len, kv->val, kv->vlen);
+        }
+        pthread_rwlock_unlock(&s->lock);
+    }
+    free(key);
+    return ret;
+}
+
+const char * dictshard_get(dictshard * ds, const char * key, const char * def, char * buf, size_t size)
+{
+    dictshard_item *s;
+    const char *val;
+    size_t len, vlen = 0;
+    if(!ds || !key || !buf || !size) return def;
+    len = strlen(key);
+    s = dictshard_of(ds, key, len);
+    pthread_rwlock_rdlock(&s->lock);
+    if((val = dictionary_get_n(s->d, key, len, NULL, &vlen))){
+        if(vlen >= size) vlen = size - 1;
+        memcpy(buf, val, vlen);
+        buf[vlen] = 0;
+    }
+    pthread_rwlock_unlock(&s->lock);
+    return val ? buf : def;
+}
+
+dictshard_item * dictshard_rdlock(dictshard * ds, const char * key, size_t len)
+{
+    dictshard_item *s;
+    if(!ds || !key) return NULL;
+    s = dictshard_of(ds, key, len);
+    pthread_rwlock_rdlock(&s->lock);
+    return s;
+}
+
+void dictshard_unlock(dictshard_item * s)
+{
+    if(s) pthread_rwlock_unlock(&s->lock);
+}
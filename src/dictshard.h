@@ -0,0 +1,137 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictshard.h
+   @author  E.V. Emelianov
+   @brief   Dictionary written by many threads.
+
+   Sections are partitioned across shards by hash of section name, each
+   shard is a separate dictionary with its own read-write lock. So writers
+   of different sections don't wait for each other. Keys outside of
+   sections ("keyname") are partitioned by hash of key name: key "name"
+   and section "name" are in the same shard, so dictshard_set(ds, "name",
+   NULL) works just as dictionary_set() (deletes section or erases key).
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DICTSHARD_H_
+#define _DICTSHARD_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "dictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+/** Default number of shards */
+#define DICTSHARD_DEFAULT   (16)
+
+/** Shard: dictionary with its lock (aligned to cache line, so locks of shards don't share lines) */
+typedef struct {
+    pthread_rwlock_t    lock ;  /** Lock of dictionary */
+    dictionary      *   d ;     /** Sections of shard */
+} __attribute__((aligned(64))) dictshard_item;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Sharded dictionary
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    size_t              n ;     /** Number of shards (power of 2) */
+    dictshard_item  *   shards ;/** Shards */
+} dictshard;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Create sharded dictionary
+  @param    n   number of shards (rounded up to power of 2; 0 for default)
+  @return   new object or NULL in case of failure
+
+  Number of shards should be several times greater than number of writing
+  threads.
+ */
+/*--------------------------------------------------------------------------*/
+dictshard * dictshard_new(size_t n);
+
+/** Delete sharded dictionary (there should be no other users) */
+void dictshard_del(dictshard * ds);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Copy all keys of a dictionary into sharded dictionary
+  @param    ds  sharded dictionary
+  @param    d   dictionary object (e.g. returned by iniparser_load())
+  @return   0 if Ok, anything else otherwise
+ */
+/*--------------------------------------------------------------------------*/
+int dictshard_add(dictshard * ds, const dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value in sharded dictionary.
+  @param    ds  sharded dictionary
+  @param    key Key to modify or add ("entryname:keyname" or "keyname")
+  @param    val Value to add or NULL to erase
+  @return   int 0 if Ok, anything else otherwise
+
+  The same as dictionary_set() and dictionary_set_n(); only shard of
+  key's section is locked for writing.
+ */
+/*--------------------------------------------------------------------------*/
+int dictshard_set(dictshard * ds, const char * key, const char * val);
+int dictshard_set_n(dictshard * ds, const char * key, size_t klen, const char * val, size_t vlen);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get a copy of value from sharded dictionary.
+  @param    ds      sharded dictionary
+  @param    key     Key to look for ("entryname:keyname" or "keyname")
+  @param    def     Default value to return if key not found
+  @param    buf     Buffer for value
+  @param    size    Size of `buf`
+  @return   `buf` or `def` if key not found
+
+  Value could be changed by another thread just after shard is unlocked,
+  so it is copied to `buf` (truncated if it's longer than size-1).
+  To read many keys of one section without copying, use dictshard_rdlock().
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictshard_get(dictshard * ds, const char * key, const char * def, char * buf, size_t size);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Lock shard of given key for reading
+  @param    ds      sharded dictionary
+  @param    key     Key ("entryname:keyname" or "keyname") or section name
+  @param    len     Length of `key`
+  @return   locked shard (or NULL if `ds` or `key` is NULL)
+
+  Get values from dictionary `d` of returned shard by dictionary_get() etc;
+  they stay valid until dictshard_unlock(). Keys of the same section are
+  always in the same shard.
+ */
+/*--------------------------------------------------------------------------*/
+dictshard_item * dictshard_rdlock(dictshard * ds, const char * key, size_t len);
+
+/** Unlock shard locked by dictshard_rdlock() */
+void dictshard_unlock(dictshard_item * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,486 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictsnap.c
+   @author  E.V. Emelianov
+   @brief   Binary snapshot of dictionary used without parsing.
+
+   Layout of block: header, array of sections, index of sections, then for
+   each section array of its keys and their index, then all strings. Arrays
+   are aligned to 8 bytes.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#define _GNU_SOURCE // memfd_create() and file seals
+#include "dictsnap.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------
+                                Defines
+ ---------------------------------------------------------------------------*/
+#define ALIGN8(x)   (((x) + 7) & ~(uint64_t)7)
+#define SNAPBASE(s) ((const char*)(s))
+
+/*---------------------------------------------------------------------------
+                            Private functions
+ ---------------------------------------------------------------------------*/
+
+/** Size of hash index for `n` items: power of 2 not less than 2n (0 for no items) */
+static uint32_t snap_idxsz(size_t n)
+{
+    uint32_t s = 2;
+    if(!n) return 0;
+    while(s < 2 * n) s <<= 1;
+    return s;
+}
+
+/** Section `i` of dictionary for snapshot: 0 is unnamed, i > 0 is d->entries[i-1] (NULL if deleted) */
+static const dictentry * snap_entry(const dictionary * d, size_t i)
+{
+    if(!i) return d->noname;
+    return d->entries[i - 1]->name ? d->entries[i - 1] : NULL;
+}
+
+/** Number of keys in section (without deleted ones) */
+static size_t snap_nkeys(const dictentry * de)
+{
+    size_t i, n = 0;
+    for(i = 0; i < de->n; ++i)
+        if(de->kvlist[i].key) ++n;
+    return n;
+}
+
+/** Put position `pos` into hash index */
+static void snap_idxput(uint32_t * idx, uint32_t size, hash_t hash, size_t pos)
+{
+    uint32_t i, mask = size - 1;
+    for(i = hash & mask; idx[i]; i = (i + 1) & mask);
+    idx[i] = (uint32_t)(pos + 1);
+}
+
+/** Put string of length `len` with terminating zero at offset `off` */
+static uint64_t snap_putstr(char * mem, uint64_t off, const char * s, size_t len)
+{
+    if(mem){
+        if(len) memcpy(mem + off, s, len);
+        mem[off + len] = 0;
+    }
+    return off + len + 1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Lay out snapshot of dictionary
+  @param    d       Dictionary.
+  @param    mem     Memory for snapshot filled with zeros (NULL to compute size only).
+  @return   size of snapshot (0 if dictionary is too large for format)
+
+  Sizes of all arrays are counted first, so strings are put after them in
+  the same pass which fills arrays.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t snap_layout(const dictionary * d, char * mem)
+{
+    dictsnap *h = (dictsnap*)mem;
+    dictsnap_sec *secs = NULL;
+    const dictentry *de;
+    uint32_t *sidx = NULL, sidxsz, idxsz;
+    size_t nsec = 1, nkeys = 0, i, k, j, s, n;
+    uint64_t off, str, first;
+    for(i = 0; i < d->n; ++i)
+        if(d->entries[i]->name) ++nsec;
+    if(nsec > UINT32_MAX) return 0;
+    sidxsz = snap_idxsz(nsec - 1);
+    off = ALIGN8(sizeof(dictsnap)) + nsec * sizeof(dictsnap_sec);
+    first = off = ALIGN8(off + (uint64_t)sidxsz * sizeof(uint32_t));
+    for(i = 0; i <= d->n; ++i){
+        if(!(de = snap_entry(d, i))) continue;
+        n = snap_nkeys(de);
+        if(n > UINT32_MAX / 2) return 0;
+        nkeys += n;
+        off = ALIGN8(off + n * sizeof(dictsnap_kv) + (uint64_t)snap_idxsz(n) * sizeof(uint32_t));
+    }
+    if(nkeys > UINT32_MAX) return 0;
+    str = off;
+    if(mem){
+        memcpy(h->magic, DICTSNAP_MAGIC, sizeof(h->magic));
+        h->version = DICTSNAP_VERSION;
+        h->endian = DICTSNAP_ENDIAN;
+        h->nsec = (uint32_t)nsec;
+        h->nkeys = (uint32_t)nkeys;
+        h->secs = ALIGN8(sizeof(dictsnap));
+        h->idx = h->secs + nsec * sizeof(dictsnap_sec);
+        h->idxsz = sidxsz;
+        secs = (dictsnap_sec*)(mem + h->secs);
+        sidx = (uint32_t*)(mem + h->idx);
+    }
+    off = first;
+    for(i = 0, s = 0; i <= d->n; ++i){
+        dictsnap_kv *kvs = NULL;
+        uint32_t *kidx = NULL;
+        if(!(de = snap_entry(d, i))) continue;
+        n = snap_nkeys(de);
+        idxsz = snap_idxsz(n);
+        if(mem){
+            dictsnap_sec *sec = &secs[s];
+            sec->keys = off;
+            sec->idx = off + n * sizeof(dictsnap_kv);
+            sec->n = (uint32_t)n;
+            sec->idxsz = idxsz;
+            sec->name = str;
+            sec->nlen = i ? (uint32_t)de->nlen : 0;
+            sec->hash = i ? de->hash : 0;
+            kvs = (dictsnap_kv*)(mem + sec->keys);
+            kidx = (uint32_t*)(mem + sec->idx);
+            if(s) snap_idxput(sidx, sidxsz, de->hash, s);
+        }
+        str = snap_putstr(mem, str, i ? de->name : "", i ? de->nlen : 0);
+        for(k = 0, j = 0; k < de->n; ++k){
+            const keyval *kv = &de->kvlist[k];
+            if(!kv->key) continue;
+            if(mem){
+                kvs[j].key = str;
+                kvs[j].klen = (uint32_t)kv->klen;
+                kvs[j].hash = kv->hash;
+                kvs[j].val = str + kv->klen + 1;
+                kvs[j].vlen = (uint32_t)kv->vlen;
+                snap_idxput(kidx, idxsz, kv->hash, j);
+            }
+            str = snap_putstr(mem, str, kv->key, kv->klen);
+            str = snap_putstr(mem, str, kv->val, kv->vlen);
+            ++j;
+        }
+        off = ALIGN8(off + n * sizeof(dictsnap_kv) + (uint64_t)idxsz * sizeof(uint32_t));
+        ++s;
+    }
+    str = ALIGN8(str);
+    if(mem){
+        h->size = str;
+        h->checksum = dictionary_hash_n(mem + sizeof(dictsnap), str - sizeof(dictsnap));
+    }
+    return (size_t)str;
+}
+
+/** ==1 if `len` bytes at offset `off` are inside of block of size `size` */
+static int snap_inside(uint64_t size, uint64_t off, uint64_t len)
+{
+    return off <= size && len <= size - off;
+}
+
+/** ==1 if zero-terminated string of length `len` at offset `off` is inside of block `s` of size `size` */
+static int snap_str_inside(const dictsnap * s, uint64_t size, uint64_t off, uint64_t len)
+{
+    return snap_inside(size, off, len + 1) && !SNAPBASE(s)[off + len];
+}
+
+/** Compare name in snapshot with given one (lowercased if `lwc` is 1) */
+static int snap_name_eq(const char * name, size_t nlen, const char * s, size_t len, int lwc)
+{
+    size_t i;
+    if(nlen != len) return 0;
+    if(!lwc) return !memcmp(name, s, len);
+    for(i = 0; i < len; ++i)
+        if(name[i] != (char)tolower((int)s[i])) return 0;
+    return 1;
+}
+
+/** Find section of key prepared by dictprobe_init() */
+static const dictsnap_sec * snap_findsec(const dictsnap * s, const dictprobe * p)
+{
+    const dictsnap_sec *secs = (const dictsnap_sec*)(SNAPBASE(s) + s->secs), *sec;
+    const uint32_t *idx;
+    uint32_t i, n, mask;
+    if(!p->sec) return secs;
+    if(!s->idxsz) return NULL;
+    idx = (const uint32_t*)(SNAPBASE(s) + s->idx);
+    mask = s->idxsz - 1;
+    // index without empty slot isn't written by snap_layout(), but could be read
+    for(i = p->shash & mask, n = 0; n < s->idxsz && idx[i]; i = (i + 1) & mask, ++n){
+        if(idx[i] > s->nsec) return NULL; // broken index
+        sec = &secs[idx[i] - 1];
+        if(sec->hash == p->shash && snap_name_eq(SNAPBASE(s) + sec->name, sec->nlen, p->sec, p->slen, p->lwc))
+            return sec;
+    }
+    return NULL;
+}
+
+/** Find key prepared by dictprobe_init() in section */
+static const dictsnap_kv * snap_findkey(const dictsnap * s, const dictsnap_sec * sec, const dictprobe * p)
+{
+    const dictsnap_kv *kvs = (const dictsnap_kv*)(SNAPBASE(s) + sec->keys), *kv;
+    const uint32_t *idx;
+    uint32_t i, n, mask;
+    if(!sec->idxsz) return NULL;
+    idx = (const uint32_t*)(SNAPBASE(s) + sec->idx);
+    mask = sec->idxsz - 1;
+    for(i = p->khash & mask, n = 0; n < sec->idxsz && idx[i]; i = (i + 1) & mask, ++n){
+        if(idx[i] > sec->n) return NULL;
+        kv = &kvs[idx[i] - 1];
+        if(kv->hash == p->khash && snap_name_eq(SNAPBASE(s) + kv->key, kv->klen, p->key, p->klen, p->lwc))
+            return kv;
+    }
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+/** Size of snapshot of dictionary (0 in case of error) */
+size_t dictsnap_size(const dictionary * d)
+{
+    if(!d) return 0;
+    return snap_layout(d, NULL);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build snapshot of dictionary in given memory
+  @param    d       Dictionary.
+  @param    mem     Memory (aligned to 8 bytes).
+  @param    size    Size of `mem` (not less than dictsnap_size()).
+  @return   snapshot (`mem`) or NULL if memory is too small
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * dictsnap_build(const dictionary * d, void * mem, size_t size)
+{
+    size_t need = dictsnap_size(d);
+    if(!need || !mem || size < need) return NULL;
+    memset(mem, 0, need); // padding and empty slots of indexes
+    snap_layout(d, (char*)mem);
+    return (const dictsnap*)mem;
+}
+
+/** Build snapshot of dictionary in anonymous mapping (NULL in case of error); free it by dictsnap_close() */
+const dictsnap * dictsnap_new(const dictionary * d)
+{
+    size_t size = dictsnap_size(d);
+    void *mem;
+    if(!size) return NULL;
+    mem = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED) return NULL;
+    snap_layout(d, (char*)mem); // anonymous memory is already zeroed
+    mprotect(mem, size, PROT_READ);
+    return (const dictsnap*)mem;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Write snapshot of dictionary into file
+  @param    d       Dictionary.
+  @param    path    File name.
+  @return   0 if Ok, -1 otherwise
+
+  Snapshot is built in memory, written into temporary file in the same
+  directory and renamed to `path`.
+ */
+/*--------------------------------------------------------------------------*/
+int dictsnap_write(const dictionary * d, const char * path)
+{
+    size_t size = dictsnap_size(d), done = 0, l;
+    char *mem, *tmp;
+    ssize_t w;
+    int fd, ret = -1;
+    if(!size || !path) return -1;
+    l = strlen(path) + 8;
+    mem = malloc(size);
+    tmp = malloc(l);
+    if(!mem || !tmp) goto ret;
+    dictsnap_build(d, mem, size);
+    snprintf(tmp, l, "%s.XXXXXX", path);
+    if((fd = mkstemp(tmp)) < 0) goto ret;
+    while(done < size){
+        if((w = write(fd, mem + done, size - done)) < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)w;
+    }
+    if(done == size && !fchmod(fd, 0644) && !fsync(fd) && !close(fd)){
+        if(!rename(tmp, path)) ret = 0;
+    }else close(fd);
+    if(ret) unlink(tmp);
+ret:
+    free(mem);
+    free(tmp);
+    return ret;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Check snapshot in memory
+  @param    mem     Memory with snapshot.
+  @param    size    Size of memory.
+  @return   snapshot or NULL if it's not a snapshot of this version
+
+  All offsets and lengths of sections and keys are checked against size
+  of block, so broken snapshot is refused instead of reading outside of
+  mapping (which gives SIGBUS for truncated file).
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * dictsnap_map(const void * mem, size_t size)
+{
+    const dictsnap *s = (const dictsnap*)mem;
+    const dictsnap_sec *secs;
+    const dictsnap_kv *kvs;
+    uint32_t i, k;
+    if(!mem || size < sizeof(dictsnap)) return NULL;
+    if(memcmp(s->magic, DICTSNAP_MAGIC, sizeof(s->magic)) || s->version != DICTSNAP_VERSION
+       || s->endian != DICTSNAP_ENDIAN || s->size > size || !s->nsec) return NULL;
+    size = s->size;
+    if(!snap_inside(size, s->secs, (uint64_t)s->nsec * sizeof(dictsnap_sec))
+       || !snap_inside(size, s->idx, (uint64_t)s->idxsz * sizeof(uint32_t))
+       || (s->idxsz & (s->idxsz - 1)) || (s->secs & 7) || (s->idx & 3)) return NULL;
+    secs = (const dictsnap_sec*)(SNAPBASE(s) + s->secs);
+    for(i = 0; i < s->nsec; ++i){
+        const dictsnap_sec *sec = &secs[i];
+        if(!snap_inside(size, sec->keys, (uint64_t)sec->n * sizeof(dictsnap_kv))
+           || !snap_inside(size, sec->idx, (uint64_t)sec->idxsz * sizeof(uint32_t))
+           || !snap_str_inside(s, size, sec->name, sec->nlen)
+           || (sec->idxsz & (sec->idxsz - 1)) || (sec->keys & 7) || (sec->idx & 3)) return NULL;
+        kvs = (const dictsnap_kv*)(SNAPBASE(s) + sec->keys);
+        for(k = 0; k < sec->n; ++k)
+            if(!snap_str_inside(s, size, kvs[k].key, kvs[k].klen)
+               || !snap_str_inside(s, size, kvs[k].val, kvs[k].vlen)) return NULL;
+    }
+    return s;
+}
+
+/** Map snapshot file read-only (NULL in case of error); close it by dictsnap_close() */
+const dictsnap * dictsnap_open(const char * path)
+{
+    const dictsnap *s;
+    int fd;
+    if(!path || (fd = open(path, O_RDONLY)) < 0) return NULL;
+    s = dictsnap_attach(fd);
+    close(fd);
+    return s;
+}
+
+/** Map snapshot from file descriptor read-only (descriptor could be closed after); close it by dictsnap_close() */
+const dictsnap * dictsnap_attach(int fd)
+{
+    struct stat st;
+    const dictsnap *s = NULL;
+    void *mem;
+    if(fstat(fd, &st) || st.st_size < (off_t)sizeof(dictsnap)) return NULL;
+    mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(mem == MAP_FAILED) return NULL;
+    s = dictsnap_map(mem, (size_t)st.st_size);
+    if(!s || s->size != (uint64_t)st.st_size){ // whole file is unmapped by dictsnap_close()
+        munmap(mem, (size_t)st.st_size);
+        s = NULL;
+    }
+    return s;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build snapshot of dictionary in shared memory
+  @param    d       Dictionary.
+  @return   descriptor of memory or -1 in case of error
+
+  Memory is memfd sealed against any changes, so processes which got
+  descriptor (by fork() or over unix socket) map the same pages read-only
+  by dictsnap_attach(). If memfd can't be sealed, -1 is returned. If kernel
+  has no memfd, unlinked file in /dev/shm is used: it can't be sealed, so
+  only descriptor opened read-only (of file with mode 0444) is returned.
+ */
+/*--------------------------------------------------------------------------*/
+int dictsnap_share(const dictionary * d)
+{
+    size_t size = dictsnap_size(d);
+    char tmp[] = "/dev/shm/iniparser.XXXXXX";
+    void *mem;
+    int fd = -1, rd = -1, sealed = 0;
+    if(!size) return -1;
+#ifdef MFD_ALLOW_SEALING
+    if((fd = memfd_create("iniparser", MFD_CLOEXEC|MFD_ALLOW_SEALING)) > -1) sealed = 1;
+    else if(errno != ENOSYS) return -1;
+#endif
+    if(fd < 0 && (fd = mkostemp(tmp, O_CLOEXEC)) < 0) return -1; // built with memfd, but kernel is older
+    if(ftruncate(fd, (off_t)size)) goto bad;
+    mem = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mem == MAP_FAILED) goto bad;
+    snap_layout(d, (char*)mem); // new file is filled with zeros
+    munmap(mem, size);
+    if(!sealed){ // nobody could get writable descriptor of file after this
+        if(!fchmod(fd, 0444)) rd = open(tmp, O_RDONLY|O_CLOEXEC);
+        unlink(tmp);
+        close(fd);
+        return rd;
+    }
+#ifdef F_ADD_SEALS
+    if(fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_WRITE|F_SEAL_SEAL)) goto bad;
+#endif
+    return fd;
+bad:
+    if(!sealed) unlink(tmp);
+    close(fd);
+    return -1;
+}
+
+/** Unmap snapshot got by dictsnap_open(), dictsnap_attach() or dictsnap_new() */
+void dictsnap_close(const dictsnap * s)
+{
+    if(s) munmap((void*)s, (size_t)s->size);
+}
+
+/** Check checksum of snapshot (O(size)), returns 0 if it's Ok */
+int dictsnap_verify(const dictsnap * s)
+{
+    if(!s) return -1;
+    return (dictionary_hash_n(SNAPBASE(s) + sizeof(dictsnap), s->size - sizeof(dictsnap)) == s->checksum) ? 0 : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find value in snapshot
+  @param    s       Snapshot.
+  @param    key     Key ("section:key" or "key", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to compare lowercased `key`.
+  @param    vlen    If not NULL, filled with length of value.
+  @return   value (zero-terminated, in memory of snapshot) or NULL if not found
+
+  Key is split and hashed as by dictionary lookups, so the same hashes
+  stored in snapshot are found.
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictsnap_get_n(const dictsnap * s, const char * key, size_t len, int lwc, size_t * vlen)
+{
+    const dictsnap_sec *sec;
+    const dictsnap_kv *kv;
+    dictprobe p;
+    if(!s || !key) return NULL;
+    dictprobe_init(&p, key, len, lwc);
+    if(!(sec = snap_findsec(s, &p)) || !(kv = snap_findkey(s, sec, &p))) return NULL;
+    if(vlen) *vlen = kv->vlen;
+    return SNAPBASE(s) + kv->val;
+}
+
+/** Number of named sections in snapshot */
+size_t dictsnap_nsec(const dictsnap * s)
+{
+    return s ? s->nsec - 1 : 0;
+}
+
+/** Name of named section number `n` (NULL if there's no such section) */
+const char * dictsnap_secname(const dictsnap * s, size_t n)
+{
+    const dictsnap_sec *secs;
+    if(!s || n + 1 >= s->nsec) return NULL;
+    secs = (const dictsnap_sec*)(SNAPBASE(s) + s->secs);
+    return SNAPBASE(s) + secs[n + 1].name;
+}
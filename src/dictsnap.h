@@ -0,0 +1,179 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictsnap.h
+   @author  E.V. Emelianov
+   @brief   Binary snapshot of dictionary used without parsing.
+
+   Snapshot is one block of memory: header, sections, keys, their hash
+   indexes and strings. All references are offsets from start of block,
+   so it could be mapped from file or shared memory at any address and
+   searched at once: opening a snapshot is mmap() and checking of offsets.
+   Strings are zero-terminated, values are returned as pointers into block.
+
+   Format is native for machine which wrote it (byte order and version are
+   checked by dictsnap_map()).
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DICTSNAP_H_
+#define _DICTSNAP_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "dictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+#define DICTSNAP_MAGIC      "INISNAP"   // with terminating zero: 8 bytes
+#define DICTSNAP_VERSION    (1)
+#define DICTSNAP_ENDIAN     (0x01020304U)
+
+/** Key of snapshot */
+typedef struct {
+    uint64_t        key ;   /** Offset of key name */
+    uint64_t        val ;   /** Offset of value */
+    uint32_t        klen ;  /** Length of key name */
+    uint32_t        vlen ;  /** Length of value */
+    uint32_t        hash ;  /** Hash of key name */
+    uint32_t        pad ;
+} dictsnap_kv;
+
+/** Section of snapshot (the first one is unnamed section) */
+typedef struct {
+    uint64_t        name ;  /** Offset of name */
+    uint64_t        keys ;  /** Offset of array of keys */
+    uint64_t        idx ;   /** Offset of hash index of keys */
+    uint32_t        nlen ;  /** Length of name */
+    uint32_t        hash ;  /** Hash of name */
+    uint32_t        n ;     /** Number of keys */
+    uint32_t        idxsz ; /** Size of index (power of 2 or 0) */
+} dictsnap_sec;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Snapshot: header at the start of block
+
+  Hash indexes are open addressing tables of positions + 1 (0 is empty
+  slot) probed linearly from `hash & (idxsz - 1)`.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    char            magic[8] ;  /** DICTSNAP_MAGIC */
+    uint32_t        version ;   /** DICTSNAP_VERSION */
+    uint32_t        endian ;    /** DICTSNAP_ENDIAN as written by native order */
+    uint64_t        size ;      /** Size of whole block */
+    uint32_t        checksum ;  /** Hash of block after header */
+    uint32_t        nsec ;      /** Number of sections (with unnamed one) */
+    uint64_t        secs ;      /** Offset of array of sections */
+    uint64_t        idx ;       /** Offset of hash index of named sections */
+    uint32_t        idxsz ;     /** Size of index */
+    uint32_t        nkeys ;     /** Total number of keys */
+} dictsnap;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/** Size of snapshot of dictionary (0 in case of error) */
+size_t dictsnap_size(const dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build snapshot of dictionary in given memory
+  @param    d       Dictionary.
+  @param    mem     Memory (aligned to 8 bytes).
+  @param    size    Size of `mem` (not less than dictsnap_size()).
+  @return   snapshot (`mem`) or NULL if memory is too small
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * dictsnap_build(const dictionary * d, void * mem, size_t size);
+
+/** Build snapshot of dictionary in anonymous mapping (NULL in case of error); free it by dictsnap_close() */
+const dictsnap * dictsnap_new(const dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Write snapshot of dictionary into file
+  @param    d       Dictionary.
+  @param    path    File name.
+  @return   0 if Ok, -1 otherwise
+
+  Snapshot is written into temporary file renamed to `path`, so readers
+  never see partially written snapshot.
+ */
+/*--------------------------------------------------------------------------*/
+int dictsnap_write(const dictionary * d, const char * path);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Check snapshot in memory
+  @param    mem     Memory with snapshot.
+  @param    size    Size of memory.
+  @return   snapshot or NULL if it's not a snapshot of this version
+
+  Header, sections and keys are checked to be inside of memory (O(keys)),
+  checksum isn't (see dictsnap_verify()).
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * dictsnap_map(const void * mem, size_t size);
+
+/** Map snapshot file read-only (NULL in case of error); close it by dictsnap_close() */
+const dictsnap * dictsnap_open(const char * path);
+
+/** Map snapshot from file descriptor read-only (descriptor could be closed after); close it by dictsnap_close() */
+const dictsnap * dictsnap_attach(int fd);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build snapshot of dictionary in shared memory
+  @param    d       Dictionary.
+  @return   descriptor of memory or -1 in case of error
+
+  Memory is sealed against changes. If kernel has no memfd_create(),
+  unsealed file in /dev/shm is used and descriptor is opened read-only.
+  Processes which got descriptor map it by dictsnap_attach(): snapshot
+  exists once in RAM for all of them.
+ */
+/*--------------------------------------------------------------------------*/
+int dictsnap_share(const dictionary * d);
+
+/** Unmap snapshot got by dictsnap_open(), dictsnap_attach() or dictsnap_new() */
+void dictsnap_close(const dictsnap * s);
+
+/** Check checksum of snapshot (O(size)), returns 0 if it's Ok */
+int dictsnap_verify(const dictsnap * s);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find value in snapshot
+  @param    s       Snapshot.
+  @param    key     Key ("section:key" or "key", not necessary zero-terminated).
+  @param    len     Length of `key`.
+  @param    lwc     ==1 to compare lowercased `key`.
+  @param    vlen    If not NULL, filled with length of value.
+  @return   value (zero-terminated, in memory of snapshot) or NULL if not found
+ */
+/*--------------------------------------------------------------------------*/
+const char * dictsnap_get_n(const dictsnap * s, const char * key, size_t len, int lwc, size_t * vlen);
+
+/** Number of named sections in snapshot */
+size_t dictsnap_nsec(const dictsnap * s);
+
+/** Name of named section number `n` (NULL if there's no such section) */
+const char * dictsnap_secname(const dictsnap * s, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    epoch.c
+   @author  E.V. Emelianov
+   @brief   Epoch-based reclamation of memory shared with readers.
+
+   Global epoch is incremented at each retirement and retired memory is
+   tagged with epoch before increment. A reader announces epoch it entered,
+   so memory tagged with epoch less than epochs of all active readers can't
+   be seen by anybody: readers entered later load new version.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#include "epoch.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+/*---------------------------------------------------------------------------
+                            Private functions
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find the oldest epoch which readers could be in
+  @param    e   Epoch domain
+  @return   minimal epoch of active readers (or current epoch if none)
+ */
+/*--------------------------------------------------------------------------*/
+static unsigned long epoch_min(epoch_t * e)
+{
+    unsigned long m = __atomic_load_n(&e->epoch, __ATOMIC_SEQ_CST), a;
+    epoch_reader *r;
+    for(r = __atomic_load_n(&e->readers, __ATOMIC_ACQUIRE); r; r = r->next){
+        a = __atomic_load_n(&r->active, __ATOMIC_SEQ_CST);
+        if(a && a < m) m = a;
+    }
+    return m;
+}
+
+/** Wait until all readers which could be in epoch `tag` leave */
+static void epoch_wait(epoch_t * e, unsigned long tag)
+{
+    while(epoch_min(e) <= tag) sched_yield();
+}
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+/** Create new epoch domain (NULL if no memory) */
+epoch_t * epoch_new(void)
+{
+    epoch_t *e = calloc(1, sizeof(epoch_t));
+    if(!e) return NULL;
+    if(pthread_mutex_init(&e->lock, NULL)){
+        free(e);
+        return NULL;
+    }
+    e->epoch = 1; // 0 means "outside of epoch"
+    return e;
+}
+
+/** Delete epoch domain: all memory retired is freed, there should be no readers */
+void epoch_del(epoch_t * e)
+{
+    epoch_reader *r, *rn;
+    epoch_garbage *g, *gn;
+    if(!e) return;
+    for(g = e->limbo; g; g = gn){
+        gn = g->next;
+        g->fn(g->p);
+        free(g);
+    }
+    for(r = e->readers; r; r = rn){
+        rn = r->next;
+        free(r);
+    }
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Register reader of epoch domain
+  @param    e   Epoch domain
+  @return   reader (NULL if no memory)
+
+  Unused record is taken if any, else new one is added to head of list:
+  readers scanning the list see either old or new head.
+ */
+/*--------------------------------------------------------------------------*/
+epoch_reader * epoch_reader_new(epoch_t * e)
+{
+    epoch_reader *r;
+    if(!e) return NULL;
+    pthread_mutex_lock(&e->lock);
+    for(r = e->readers; r; r = r->next)
+        if(!__atomic_load_n(&r->used, __ATOMIC_ACQUIRE)) break;
+    if(!r && (r = calloc(1, sizeof(epoch_reader)))){
+        r->next = e->readers;
+        __atomic_store_n(&e->readers, r, __ATOMIC_RELEASE);
+    }
+    if(r){
+        r->used = 1;
+        r->nest = 0;
+    }
+    pthread_mutex_unlock(&e->lock);
+    return r;
+}
+
+/** Unregister reader (it shouldn't be inside epoch) */
+void epoch_reader_del(epoch_reader * r)
+{
+    if(!r) return;
+    __atomic_store_n(&r->active, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->used, 0, __ATOMIC_RELEASE);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Enter epoch
+  @param    e   Epoch domain
+  @param    r   Reader of calling thread
+
+  Epoch is announced before any shared pointer is loaded (full fence), so
+  writer scanning readers after retirement either sees this reader or the
+  reader sees new version.
+ */
+/*--------------------------------------------------------------------------*/
+void epoch_enter(epoch_t * e, epoch_reader * r)
+{
+    if(r->nest++) return;
+    __atomic_store_n(&r->active, __atomic_load_n(&e->epoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/** Leave epoch: pointers loaded inside it shouldn't be used any more */
+void epoch_leave(epoch_reader * r)
+{
+    if(--r->nest) return;
+    __atomic_store_n(&r->active, 0, __ATOMIC_RELEASE);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Retire memory
+  @param    e   Epoch domain
+  @param    p   Memory which is not reachable by new readers any more
+  @param    fn  Function to free `p`
+ */
+/*--------------------------------------------------------------------------*/
+void epoch_retire(epoch_t * e, void * p, epoch_free_t fn)
+{
+    epoch_garbage *g;
+    unsigned long tag;
+    if(!p) return;
+    tag = __atomic_fetch_add(&e->epoch, 1, __ATOMIC_SEQ_CST);
+    if(!(g = malloc(sizeof(epoch_garbage)))){ // no memory: wait for readers
+        epoch_wait(e, tag);
+        fn(p);
+        return;
+    }
+    g->p = p;
+    g->fn = fn;
+    g->epoch = tag;
+    pthread_mutex_lock(&e->lock);
+    g->next = e->limbo;
+    e->limbo = g;
+    ++e->nlimbo;
+    pthread_mutex_unlock(&e->lock);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Free memory retired which can't be seen by readers
+  @param    e   Epoch domain
+  @return   amount of objects freed
+
+  Objects are unlinked under lock and freed after it is released.
+ */
+/*--------------------------------------------------------------------------*/
+size_t epoch_reclaim(epoch_t * e)
+{
+    epoch_garbage *g, **pg, *dead = NULL;
+    unsigned long m;
+    size_t n = 0;
+    if(!e) return 0;
+    m = epoch_min(e);
+    pthread_mutex_lock(&e->lock);
+    for(pg = &e->limbo; (g = *pg);){
+        if(g->epoch < m){
+            *pg = g->next;
+            g->next = dead;
+            dead = g;
+            --e->nlimbo;
+        }else pg = &g->next;
+    }
+    pthread_mutex_unlock(&e->lock);
+    for(g = dead; g; g = dead){
+        dead = g->next;
+        g->fn(g->p);
+        free(g);
+        ++n;
+    }
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Wait until all memory retired before this call is freed
+  @param    e   Epoch domain
+
+  Calling thread shouldn't be inside epoch, else it waits forever.
+ */
+/*--------------------------------------------------------------------------*/
+void epoch_synchronize(epoch_t * e)
+{
+    if(!e) return;
+    epoch_wait(e, __atomic_fetch_add(&e->epoch, 1, __ATOMIC_SEQ_CST));
+    epoch_reclaim(e);
+}
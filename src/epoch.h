@@ -0,0 +1,142 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    epoch.h
+   @author  E.V. Emelianov
+   @brief   Epoch-based reclamation of memory shared with readers.
+
+   Readers enter an epoch before reading shared data and leave it after.
+   Writer replaces data by new version, publishes it and retires the old
+   memory: it is freed only when all readers which could see it have left
+   their epochs. Readers are wait-free: entering and leaving an epoch are
+   single stores to reader's own record.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _EPOCH_H_
+#define _EPOCH_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+/** Function freeing retired memory */
+typedef void (*epoch_free_t)(void * p);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Reader of epoch domain
+
+  Each reading thread registers its own reader. Records are never freed
+  before domain: deleted readers are reused by next registrations.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct _epoch_reader_ {
+    unsigned long       active ;/** Epoch entered (0 if reader is outside) */
+    unsigned            nest ;  /** Depth of nested epoch_enter() */
+    int                 used ;  /** ==1 if record is registered */
+    struct _epoch_reader_ * next ;  /** Next reader of domain */
+} epoch_reader;
+
+/** Memory waiting for reclamation */
+typedef struct _epoch_garbage_ {
+    void            *   p ;     /** Memory retired */
+    epoch_free_t        fn ;    /** Function to free it */
+    unsigned long       epoch ; /** Epoch of retirement */
+    struct _epoch_garbage_ * next ;
+} epoch_garbage;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Epoch domain: readers and memory retired by writers
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    unsigned long       epoch ; /** Global epoch */
+    epoch_reader    *   readers;/** List of readers */
+    epoch_garbage   *   limbo ; /** List of memory retired */
+    size_t              nlimbo ;/** Length of `limbo` */
+    pthread_mutex_t     lock ;  /** Protects `limbo` and registration of readers */
+} epoch_t;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/** Create new epoch domain (NULL if no memory) */
+epoch_t * epoch_new(void);
+
+/** Delete epoch domain: all memory retired is freed, there should be no readers */
+void epoch_del(epoch_t * e);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Register reader of epoch domain
+  @param    e   Epoch domain
+  @return   reader (NULL if no memory)
+
+  Each reading thread should have its own reader.
+ */
+/*--------------------------------------------------------------------------*/
+epoch_reader * epoch_reader_new(epoch_t * e);
+
+/** Unregister reader (it shouldn't be inside epoch) */
+void epoch_reader_del(epoch_reader * r);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Enter and leave epoch
+  @param    e   Epoch domain
+  @param    r   Reader of calling thread
+
+  Pointers to shared data loaded after epoch_enter() stay valid until
+  epoch_leave(). Calls could be nested.
+ */
+/*--------------------------------------------------------------------------*/
+void epoch_enter(epoch_t * e, epoch_reader * r);
+void epoch_leave(epoch_reader * r);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Retire memory
+  @param    e   Epoch domain
+  @param    p   Memory which is not reachable by new readers any more
+  @param    fn  Function to free `p`
+
+  Call this after new version of data was published. `fn(p)` is called
+  by epoch_reclaim() when all readers which could see `p` left their
+  epochs. If there's no memory for bookkeeping, waits for readers and
+  frees `p` immediately.
+ */
+/*--------------------------------------------------------------------------*/
+void epoch_retire(epoch_t * e, void * p, epoch_free_t fn);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Free memory retired which can't be seen by readers
+  @param    e   Epoch domain
+  @return   amount of objects freed
+
+  Never blocks on readers, so writers could call it after each update.
+ */
+/*--------------------------------------------------------------------------*/
+size_t epoch_reclaim(epoch_t * e);
+
+/** Wait until all memory retired before this call is freed */
+void epoch_synchronize(epoch_t * e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,494 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inijournal.c
+   @author  E.V. Emelianov
+   @brief   Ini file with append-only journal of changes.
+
+   Journal "file.ini.journal.N" starts with magic, then records follow:
+   length of key and value (32 bit each, value length JOURNAL_DEL for
+   erasing), key, value and 32 bit hash of all previous bytes of record.
+   Record with bad hash or cut by end of file ends the journal.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#include "inijournal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------
+                                Defines
+ ---------------------------------------------------------------------------*/
+#define JOURNAL_MAGIC       "INIJRNL1"
+#define JOURNAL_MAGICLEN    (8)
+#define JOURNAL_DEL         (0xffffffffU)   // length of value for erasing
+#define JOURNAL_HDRLEN      (2 * sizeof(uint32_t))
+#define JOURNAL_BUFSZ       (1<<16)         // records are written when buffer is full
+
+/*---------------------------------------------------------------------------
+                            Private functions
+ ---------------------------------------------------------------------------*/
+
+/** Name of journal number `gen` of ini file (free() it after use) */
+static char * journal_name(const char * ininame, unsigned long gen)
+{
+    size_t l = strlen(ininame) + 32;
+    char *n = malloc(l);
+    if(n) snprintf(n, l, "%s.journal.%lu", ininame, gen);
+    return n;
+}
+
+/** Sync directory of file `name`, so new files and renames in it are durable */
+static void sync_dir(const char * name)
+{
+    char *dir = strdup(name), *s;
+    int fd;
+    if(!dir) return;
+    if((s = strrchr(dir, '/'))) s[s == dir ? 1 : 0] = 0;
+    else strcpy(dir, ".");
+    if((fd = open(dir, O_RDONLY)) > -1){
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Replay journal over dictionary
+  @param    d       Dictionary.
+  @param    name    Name of journal.
+  @return   length of valid part of journal, -1 if there's no journal, -2 in case of error
+ */
+/*--------------------------------------------------------------------------*/
+static off_t journal_replay(dictionary * d, const char * name)
+{
+    FILE *f;
+    struct stat st;
+    char *buf = NULL, magic[JOURNAL_MAGICLEN];
+    size_t size = 0, L;
+    uint32_t h[2], c;
+    off_t off = 0;
+    if(!(f = fopen(name, "r"))) return (errno == ENOENT) ? -1 : -2;
+    if(fstat(fileno(f), &st)) goto bad;
+    if(fread(magic, 1, JOURNAL_MAGICLEN, f) != JOURNAL_MAGICLEN){ // created just before crash
+        fclose(f);
+        return 0;
+    }
+    if(memcmp(magic, JOURNAL_MAGIC, JOURNAL_MAGICLEN)){
+        errno = EINVAL;
+        goto bad;
+    }
+    off = JOURNAL_MAGICLEN;
+    while(fread(h, 1, JOURNAL_HDRLEN, f) == JOURNAL_HDRLEN){
+        L = JOURNAL_HDRLEN + h[0] + (h[1] == JOURNAL_DEL ? 0 : h[1]);
+        if((off_t)(L + sizeof(uint32_t)) > st.st_size - off) break; // cut record
+        if(size < L){
+            char *n = realloc(buf, L);
+            if(!n) goto bad;
+            buf = n;
+            size = L;
+        }
+        memcpy(buf, h, JOURNAL_HDRLEN);
+        if(fread(buf + JOURNAL_HDRLEN, 1, L - JOURNAL_HDRLEN, f) != L - JOURNAL_HDRLEN
+           || fread(&c, 1, sizeof(c), f) != sizeof(c)
+           || c != dictionary_hash_n(buf, L)) break;
+        if(dictionary_set_n(d, buf + JOURNAL_HDRLEN, h[0],
+                            (h[1] == JOURNAL_DEL) ? NULL : buf + JOURNAL_HDRLEN + h[0],
+                            (h[1] == JOURNAL_DEL) ? 0 : h[1])) goto bad;
+        off += (off_t)(L + sizeof(c));
+    }
+    free(buf);
+    fclose(f);
+    return off;
+bad:
+    free(buf);
+    fclose(f);
+    return -2;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Open journal for appending
+  @param    j       Journal.
+  @param    gen     Its number.
+  @param    size    Length of valid records (0 for new journal).
+  @return   0 if Ok, -1 otherwise
+
+  Tail after valid records is cut, new journal gets magic. Journal and its
+  directory are synced, so it exists after crash.
+ */
+/*--------------------------------------------------------------------------*/
+static int journal_start(inijournal * j, unsigned long gen, off_t size)
+{
+    char *name = journal_name(j->ininame, gen);
+    int fd;
+    if(!name) return -1;
+    fd = open(name, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    free(name);
+    if(fd < 0) return -1;
+    if(size < JOURNAL_MAGICLEN){
+        if(ftruncate(fd, 0) || write(fd, JOURNAL_MAGIC, JOURNAL_MAGICLEN) != JOURNAL_MAGICLEN) goto bad;
+        size = JOURNAL_MAGICLEN;
+    }else if(ftruncate(fd, size)) goto bad;
+    if(fsync(fd)) goto bad;
+    sync_dir(j->ininame);
+    j->fd = fd;
+    j->gen = gen;
+    j->jsize = (size_t)size;
+    return 0;
+bad:
+    close(fd);
+    return -1;
+}
+
+/** Write records from buffer into journal (under lock), returns 0 if Ok */
+static int journal_write(inijournal * j)
+{
+    size_t done = 0;
+    ssize_t w;
+    while(done < j->len && !j->err){
+        if((w = write(j->fd, j->buf + done, j->len - done)) < 0){
+            if(errno != EINTR) j->err = 1;
+        }else done += (size_t)w;
+    }
+    j->len = 0;
+    if(!j->err) j->written = j->seq;
+    return j->err ? -1 : 0;
+}
+
+/** Write all records and start next journal (under lock) */
+static int journal_rotate(inijournal * j)
+{
+    int fd = j->fd;
+    while(j->syncing) pthread_cond_wait(&j->cond, &j->lock);
+    if(journal_write(j) || fdatasync(fd)){
+        j->err = 1;
+        return -1;
+    }
+    j->synced = j->seq;
+    if(journal_start(j, j->gen + 1, 0)) return -1; // old journal is still used
+    close(fd);
+    return 0;
+}
+
+/** Write snapshot of dictionary with quoted values (iniparser_dump() doesn't quote them), -1 if some key can't be written */
+static int journal_dumpsnap(const dictionary * d, int fd)
+{
+    iniwriter *w = iniwriter_open_fd(fd);
+    const dictentry *de;
+    size_t i, k;
+    int bad = 0;
+    if(!w) return -1;
+    for(i = 0; i <= d->n && !bad; ++i){
+        de = i ? d->entries[i - 1] : d->noname;
+        if(!de->n) continue; // deleted section
+        if(i && iniwriter_section(w, de->name)) bad = 1;
+        for(k = 0; k < de->n && !bad; ++k)
+            if(de->kvlist[k].key && iniwriter_kv_n(w, de->kvlist[k].key, de->kvlist[k].klen,
+                                                   de->kvlist[k].val, de->kvlist[k].vlen)) bad = 1;
+    }
+    return (iniwriter_close(w) || bad) ? -1 : 0;
+}
+
+/** Count keys of `a` found in `b` with the same values, `n` gets number of keys of `a` */
+static size_t journal_subset(const dictionary * a, const dictionary * b, size_t * n)
+{
+    const dictentry *de, *bde;
+    const keyval *kv, *bkv;
+    size_t i, k, same = 0;
+    *n = 0;
+    for(i = 0; i <= a->n; ++i){
+        de = i ? a->entries[i - 1] : a->noname;
+        if(!de->n) continue; // deleted section
+        bde = i ? dictentry_find(b, de->name) : b->noname;
+        for(k = 0, kv = de->kvlist; k < de->n; ++k, ++kv){
+            if(!kv->key) continue;
+            ++*n;
+            if(bde && (bkv = dictentry_getkv(b, bde, kv->key)) && bkv->vlen == kv->vlen
+               && !memcmp(bkv->val, kv->val, kv->vlen)) ++same;
+        }
+    }
+    return same;
+}
+
+/** Check that ini file `name` is read into the same keys and values as `d` has */
+static int journal_verify(const dictionary * d, const char * name)
+{
+    dictionary *f = iniparser_load(name);
+    size_t n, nf;
+    int ok = f && journal_subset(d, f, &n) == n && journal_subset(f, d, &nf) == nf;
+    dictionary_del(f);
+    return ok ? 0 : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Compaction thread: write snapshot into ini file
+  @param    arg Journal.
+
+  Snapshot goes into temporary file which is parsed again and compared
+  with snapshot, then it is renamed over ini file and journals folded into
+  it are removed. If something fails (or some key of snapshot can't be
+  read back from ini file), ini file and journals stay as they were.
+ */
+/*--------------------------------------------------------------------------*/
+static void * journal_compactor(void * arg)
+{
+    inijournal *j = (inijournal*)arg;
+    unsigned long gen, base, g;
+    size_t l = strlen(j->ininame) + 5;
+    char *tmp, *name, head[64];
+    int fd, hl, ok = 0;
+    pthread_mutex_lock(&j->lock);
+    gen = j->gen;
+    base = j->base;
+    pthread_mutex_unlock(&j->lock);
+    if((tmp = malloc(l))){
+        snprintf(tmp, l, "%s.tmp", j->ininame);
+        if((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666)) > -1){
+            hl = snprintf(head, sizeof(head), "; journal %lu\n", gen);
+            ok = (write(fd, head, hl) == hl && !journal_dumpsnap(j->snap, fd) && !fsync(fd));
+            if(close(fd)) ok = 0;
+            if(ok) ok = !journal_verify(j->snap, tmp);
+            if(ok && (ok = !rename(tmp, j->ininame))) sync_dir(j->ininame);
+            if(!ok) unlink(tmp);
+        }
+        free(tmp);
+    }
+    if(ok) for(g = base; g < gen; ++g)
+        if((name = journal_name(j->ininame, g))){
+            unlink(name);
+            free(name);
+        }
+    dictionary_del(j->snap);
+    pthread_mutex_lock(&j->lock);
+    j->snap = NULL;
+    if(ok) j->base = gen;
+    j->cerr = !ok;
+    j->compacting = 2;
+    pthread_cond_broadcast(&j->cond);
+    pthread_mutex_unlock(&j->lock);
+    return NULL;
+}
+
+/** Start compaction (under lock) */
+static int journal_compact(inijournal * j)
+{
+    dictionary *snap;
+    if(j->compacting == 1) return 0;
+    if(j->compacting == 2){ // previous one finished
+        pthread_join(j->compactor, NULL);
+        j->compacting = 0;
+    }
+    if(j->err || !(snap = dictionary_clone(j->d))) return -1;
+    if(journal_rotate(j)){
+        dictionary_del(snap);
+        return -1;
+    }
+    j->snap = snap;
+    j->compacting = 1;
+    if(pthread_create(&j->compactor, NULL, journal_compactor, j)){ // fold it next time
+        j->compacting = 0;
+        j->snap = NULL;
+        dictionary_del(snap);
+        return -1;
+    }
+    return 0;
+}
+
+/** Hook of dictionary: append record of change */
+static void journal_hook(void * arg, const char * key, size_t klen, const char * val, size_t vlen)
+{
+    inijournal *j = (inijournal*)arg;
+    size_t L = JOURNAL_HDRLEN + klen + (val ? vlen : 0);
+    uint32_t h[2], c;
+    char *p;
+    h[0] = (uint32_t)klen;
+    h[1] = val ? (uint32_t)vlen : JOURNAL_DEL;
+    pthread_mutex_lock(&j->lock);
+    if(j->err) goto ret;
+    if(j->size - j->len < L + sizeof(c) && journal_write(j)) goto ret;
+    if(j->size < L + sizeof(c)){ // very large record
+        if(!(p = realloc(j->buf, L + sizeof(c)))){
+            j->err = 1;
+            goto ret;
+        }
+        j->buf = p;
+        j->size = L + sizeof(c);
+    }
+    p = j->buf + j->len;
+    memcpy(p, h, JOURNAL_HDRLEN);
+    memcpy(p + JOURNAL_HDRLEN, key, klen);
+    if(val) memcpy(p + JOURNAL_HDRLEN + klen, val, vlen);
+    c = dictionary_hash_n(p, L);
+    memcpy(p + L, &c, sizeof(c));
+    j->len += L + sizeof(c);
+    j->jsize += L + sizeof(c);
+    ++j->seq;
+    if(j->compact && j->jsize >= j->compact) journal_compact(j);
+ret:
+    pthread_mutex_unlock(&j->lock);
+}
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Open ini file with journal
+  @param    ininame Name of ini file (could be absent: dictionary is empty then).
+  @return   journal or NULL in case of error
+
+  Number of first journal not folded is read from comment "; journal N" in
+  the first line of ini file. Journals from it are replayed while they exist,
+  the last one is continued.
+ */
+/*--------------------------------------------------------------------------*/
+inijournal * inijournal_open(const char * ininame)
+{
+    inijournal *j;
+    FILE *f;
+    char line[64], *name;
+    unsigned long g;
+    off_t size = 0, r;
+    if(!ininame){
+        errno = EINVAL;
+        return NULL;
+    }
+    if(!(j = calloc(1, sizeof(inijournal)))) return NULL;
+    j->fd = -1;
+    if(pthread_mutex_init(&j->lock, NULL)){
+        free(j);
+        return NULL;
+    }
+    if(pthread_cond_init(&j->cond, NULL)){
+        pthread_mutex_destroy(&j->lock);
+        free(j);
+        return NULL;
+    }
+    j->compact = INIJOURNAL_COMPACT;
+    if(!(j->ininame = strdup(ininame)) || !(j->buf = malloc(JOURNAL_BUFSZ))) goto bad;
+    j->size = JOURNAL_BUFSZ;
+    if((f = fopen(ininame, "r"))){
+        if(fgets(line, sizeof(line), f) && sscanf(line, "; journal %lu", &g) == 1) j->base = g;
+        fclose(f);
+        j->d = iniparser_load(ininame);
+    }else if(errno == ENOENT) j->d = dictionary_new(0);
+    if(!j->d) goto bad;
+    for(g = j->base; g-- > 0;){ // journals left by compaction interrupted after writing ini file
+        if(!(name = journal_name(ininame, g))) break;
+        r = unlink(name);
+        free(name);
+        if(r) break;
+    }
+    j->gen = j->base;
+    for(g = j->base; ; ++g){
+        if(!(name = journal_name(ininame, g))) goto bad;
+        r = journal_replay(j->d, name);
+        free(name);
+        if(r == -1) break;
+        if(r < 0) goto bad;
+        j->gen = g;
+        size = r;
+    }
+    if(journal_start(j, j->gen, size)) goto bad;
+    dictionary_sethook(j->d, journal_hook, j);
+    return j;
+bad:
+    dictionary_del(j->d);
+    free(j->buf);
+    free(j->ininame);
+    pthread_cond_destroy(&j->cond);
+    pthread_mutex_destroy(&j->lock);
+    free(j);
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Close ini file with journal
+  @param    j   Journal.
+  @return   0 if all changes were persisted, -1 otherwise
+ */
+/*--------------------------------------------------------------------------*/
+int inijournal_close(inijournal * j)
+{
+    int ret;
+    if(!j) return -1;
+    dictionary_sethook(j->d, NULL, NULL);
+    ret = inijournal_sync(j);
+    pthread_mutex_lock(&j->lock);
+    while(j->compacting == 1) pthread_cond_wait(&j->cond, &j->lock);
+    pthread_mutex_unlock(&j->lock);
+    if(j->compacting == 2) pthread_join(j->compactor, NULL);
+    if(j->fd > -1 && close(j->fd)) ret = -1;
+    dictionary_del(j->d);
+    free(j->buf);
+    free(j->ininame);
+    pthread_cond_destroy(&j->cond);
+    pthread_mutex_destroy(&j->lock);
+    free(j);
+    return ret;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make changes durable
+  @param    j   Journal.
+  @return   0 if Ok, -1 otherwise
+
+  Thread which finds nobody syncing writes all records appended (by any
+  thread) and syncs journal without lock; others wait for it and check if
+  their records were covered, else one of them syncs next group.
+ */
+/*--------------------------------------------------------------------------*/
+int inijournal_sync(inijournal * j)
+{
+    unsigned long long target, upto;
+    int fd, r, ret;
+    if(!j) return -1;
+    pthread_mutex_lock(&j->lock);
+    target = j->seq;
+    while(j->synced < target && !j->err){
+        if(j->syncing){
+            pthread_cond_wait(&j->cond, &j->lock);
+            continue;
+        }
+        if(journal_write(j)) break;
+        upto = j->written;
+        fd = j->fd;
+        j->syncing = 1;
+        pthread_mutex_unlock(&j->lock);
+        r = fdatasync(fd);
+        pthread_mutex_lock(&j->lock);
+        j->syncing = 0;
+        if(r) j->err = 1;
+        else if(upto > j->synced) j->synced = upto;
+        pthread_cond_broadcast(&j->cond);
+    }
+    ret = j->err ? -1 : 0;
+    pthread_mutex_unlock(&j->lock);
+    return ret;
+}
+
+/** Fold journal into ini file by background thread, returns 0 if compaction started or runs */
+int inijournal_compact(inijournal * j)
+{
+    int ret;
+    if(!j) return -1;
+    pthread_mutex_lock(&j->lock);
+    ret = journal_compact(j);
+    pthread_mutex_unlock(&j->lock);
+    return ret;
+}
@@ -0,0 +1,136 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inijournal.h
+   @author  E.V. Emelianov
+   @brief   Ini file with append-only journal of changes.
+
+   Each change of dictionary (dictionary_set() or iniparser_set()) is
+   appended as a small record to journal next to ini file, so changes are
+   persisted in O(1) without rewriting the file. inijournal_sync() makes
+   them durable: threads calling it together share one fsync (group
+   commit). Journal is replayed over ini file when it is opened and folded
+   back into ini file by compaction running in background thread.
+
+   Journals are numbered: compaction starts new journal, writes snapshot
+   of dictionary into ini file with comment "; journal N" (N is number of
+   the new journal) and then removes older journals. So after a crash ini
+   file and journals from N are always consistent.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INIJOURNAL_H_
+#define _INIJOURNAL_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "iniparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+/** Default size of journal which starts compaction */
+#define INIJOURNAL_COMPACT  (1<<24)
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Ini file with journal
+
+  Dictionary `d` is changed by usual functions; writes should be serialized
+  by caller as for any dictionary.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    dictionary      *   d ;         /** Content of ini file with journal applied */
+    char            *   ininame ;   /** Name of ini file */
+    int                 fd ;        /** Descriptor of current journal */
+    unsigned long       gen ;       /** Number of current journal */
+    unsigned long       base ;      /** Number of first journal not folded into ini file */
+    char            *   buf ;       /** Records not written yet */
+    size_t              len ;       /** Length of records in `buf` */
+    size_t              size ;      /** Size of `buf` */
+    size_t              jsize ;     /** Size of current journal (with records in buffer) */
+    size_t              compact ;   /** Journal size starting compaction (0: only inijournal_compact()) */
+    unsigned long long  seq ;       /** Number of records appended */
+    unsigned long long  written ;   /** Number of records written into journal */
+    unsigned long long  synced ;    /** Number of records synced to disk */
+    int                 syncing ;   /** ==1 while some thread syncs journal */
+    int                 err ;       /** ==1 after write error (changes aren't persisted any more) */
+    int                 compacting ;/** 1 while compaction runs, 2 when it finished */
+    int                 cerr ;      /** ==1 if last compaction failed */
+    dictionary      *   snap ;      /** Snapshot written by compaction */
+    pthread_t           compactor ; /** Compaction thread */
+    pthread_mutex_t     lock ;      /** Protects journal */
+    pthread_cond_t      cond ;      /** Signals end of sync */
+} inijournal;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Open ini file with journal
+  @param    ininame Name of ini file (could be absent: dictionary is empty then).
+  @return   journal or NULL in case of error (errno is set, get_error()
+            tells why ini file can't be parsed)
+
+  Ini file is loaded and its journals are replayed. Incomplete record at
+  end of last journal (written before crash) is cut off.
+ */
+/*--------------------------------------------------------------------------*/
+inijournal * inijournal_open(const char * ininame);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Close ini file with journal
+  @param    j   Journal.
+  @return   0 if all changes were persisted, -1 otherwise
+
+  Journal is synced, running compaction is waited for. Dictionary is freed.
+ */
+/*--------------------------------------------------------------------------*/
+int inijournal_close(inijournal * j);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make changes durable
+  @param    j   Journal.
+  @return   0 if Ok, -1 otherwise
+
+  Returns when all changes made before the call are on disk. If other
+  thread already syncs, waits for it and syncs together with other
+  waiters, so N threads calling this at once cost about two fsyncs.
+ */
+/*--------------------------------------------------------------------------*/
+int inijournal_sync(inijournal * j);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Fold journal into ini file
+  @param    j   Journal.
+  @return   0 if compaction started (or already runs), -1 otherwise
+
+  Snapshot of dictionary (dictionary_clone()) is written into ini file by
+  background thread, new changes go to the next journal meanwhile. Call it
+  serialized with changes of dictionary. It is called automatically when
+  journal becomes larger than `j->compact` bytes. Ini file written is
+  parsed again before it replaces old one: if some key can't be read back
+  (see iniwriter_open()), journals are kept and `cerr` is set.
+ */
+/*--------------------------------------------------------------------------*/
+int inijournal_compact(inijournal * j);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,12 +8,23 @@
 /*--------------------------------------------------------------------------*/
 /*---------------------------- Includes ------------------------------------*/
 #include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "iniparser.h"
 
 /*---------------------------- Defines -------------------------------------*/
 #define ASCIILINESZ         (1024)
 #define INI_INVALID_KEY     ((char*)-1)
+// iniparser_bind() searches keys one by one if section is BIND_RATIO times larger than
+// amount of fields bound from it, else checks all keys of section in one pass
+#define BIND_RATIO          (8)
+// buffer of iniwriter: lines are formatted right in it
+#define INIWRITER_BUFSZ     (1<<20)
 
 /*---------------------------------------------------------------------------
                         Private to this module
@@ -30,8 +41,9 @@ typedef enum _line_status_ {
     LINE_VALUE
 } line_status ;
 
-iniparser_err_t last_error; /** Last error code */
-char last_errmsg[ASCIILINESZ];
+/** Last error code and message of calling thread */
+static __thread iniparser_err_t last_error;
+static __thread char last_errmsg[ASCIILINESZ];
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -132,12 +144,12 @@ const char * iniparser_getsecname(const dictionary * d, int n)
         last_error = INIPARSER_NO_OBJECT;
         return NULL;
     }
-    if((int)d->n < n){
+    if(n < 0 || (size_t)n >= d->n){
         last_error = INIPARSER_BAD_IDX;
         return NULL;
     }
     last_error = INIPARSER_NO_ERROR;
-    return d->entries[n].name;
+    return d->entries[n]->name;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -156,6 +168,48 @@ void iniparser_dump(const dictionary * d, FILE * f)
     dictionary_dump(d, f);
 }
 
+/** The same as iniparser_dump() into file descriptor, returns 0 if Ok */
+int iniparser_dump_fd(const dictionary * d, int fd)
+{
+    dicterr_t e = dictionary_dump_fd(d, fd);
+    return (e == DERR_OK || e == DERR_EMPTY) ? 0 : -1;
+}
+
+/** The same as iniparser_dump_fd() by `nthreads` threads (see dictionary_dump_parallel()) */
+int iniparser_dump_parallel(const dictionary * d, int fd, int nthreads)
+{
+    dicterr_t e = dictionary_dump_parallel(d, fd, nthreads);
+    return (e == DERR_OK || e == DERR_EMPTY) ? 0 : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into newly allocated buffer.
+  @param    d   Dictionary to dump.
+  @param    len If not NULL, filled with length of dump.
+  @return   zero-terminated buffer or NULL in case of error
+ */
+/*--------------------------------------------------------------------------*/
+char * iniparser_dump_to_buffer(const dictionary * d, size_t * len)
+{
+    size_t size;
+    char *buf;
+    if(d==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    size = dictionary_dump_size(d);
+    if(!(buf = malloc(size + 1))){
+        last_error = INIPARSER_NO_MEM;
+        return NULL;
+    }
+    dictionary_dump_mem(d, buf, size + 1);
+    buf[size] = 0;
+    if(len) *len = size;
+    last_error = INIPARSER_NO_ERROR;
+    return buf;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the number of keys in a section of a dictionary.
@@ -175,6 +229,197 @@ int iniparser_getsecnkeys(const dictionary * d, const char * s)
     return de->n;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find key/value pair associated to a key of given length
+  @param    d       Dictionary to search
+  @param    key     Key string to look for (not necessary zero-terminated)
+  @param    len     Length of `key`
+  @param    h       If not NULL, filled with resolved key
+  @return   pointer to key/value pair or NULL
+
+  Key is case-insensitive: it's compared lowercased, without copying.
+  Sets last_error.
+ */
+/*--------------------------------------------------------------------------*/
+static const keyval * iniparser_getkv_n(const dictionary * d, const char * key, size_t len, iniparser_key_t * h)
+{
+    const keyval * kv ;
+
+    if (d==NULL || key==NULL){
+        if(h) dictionary_getkv(NULL, NULL, h);
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    kv = dictionary_getkv_n(d, key, len, 1, h);
+    last_error = kv ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+    return kv;
+}
+
+/** Find key/value pair (case-insensitive) without touching last error, returns status */
+static iniparser_err_t iniparser_findkv(const dictionary * d, const char * key, const keyval ** kv)
+{
+    if (d==NULL || key==NULL){
+        *kv = NULL;
+        return INIPARSER_NO_OBJECT;
+    }
+    *kv = dictionary_getkv_n(d, key, strlen(key), 1, NULL);
+    return *kv ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+}
+
+/** Find key/value pair associated to a key (case-insensitive), sets last_error */
+static const keyval * iniparser_getkv(const dictionary * d, const char * key, iniparser_key_t * h)
+{
+    return iniparser_getkv_n(d, key, key ? strlen(key) : 0, h);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find key/value pair by resolved key
+  @param    d       Dictionary to search
+  @param    h       Key resolved by iniparser_resolve()
+  @return   pointer to key/value pair or NULL
+
+  Sets last_error.
+ */
+/*--------------------------------------------------------------------------*/
+static const keyval * iniparser_getkv_h(const dictionary * d, iniparser_key_t h)
+{
+    const keyval * kv ;
+    if (d==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    kv = dictionary_keyval(d, h);
+    if(kv) last_error = INIPARSER_NO_ERROR;
+    else if(h.pos == DICT_NOPOS) last_error = INIPARSER_NOT_FOUND;
+    else last_error = INIPARSER_STALE_KEY;
+    return kv;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Cache converted value of key/value pair
+  @param    kv      key/value pair
+  @param    flags   KV_* flags of cached value
+  @return   all flags of cached values
+
+  Value (kv->lval or kv->dval) should be stored before call. Flags are set
+  atomically after it, so other readers see only fully stored values.
+ */
+/*--------------------------------------------------------------------------*/
+static unsigned kv_cache(const keyval * kv, unsigned flags)
+{
+    return __atomic_or_fetch(&((keyval*)kv)->vtype, flags, __ATOMIC_RELEASE);
+}
+
+/** Convert string to long int, returns INIPARSER_BAD_NUMBER if it isn't correct integer */
+static iniparser_err_t str_tolong(const char * str, long * l)
+{
+    char *eptr;
+    *l = strtol(str, &eptr, 0);
+    return (eptr == str || *eptr) ? INIPARSER_BAD_NUMBER : INIPARSER_NO_ERROR;
+}
+
+/** Convert string to double, returns INIPARSER_BAD_NUMBER if it isn't correct number */
+static iniparser_err_t str_todouble(const char * str, double * x)
+{
+    char *eptr;
+    *x = strtod(str, &eptr);
+    return (eptr == str || *eptr) ? INIPARSER_BAD_NUMBER : INIPARSER_NO_ERROR;
+}
+
+/** Convert string to boolean (`b` isn't changed if string isn't boolean) */
+static iniparser_err_t str_tobool(const char * c, int * b)
+{
+    if (c[0]=='y' || c[0]=='Y' || c[0]=='1' || c[0]=='t' || c[0]=='T') {
+        *b = 1 ;
+    } else if (c[0]=='n' || c[0]=='N' || c[0]=='0' || c[0]=='f' || c[0]=='F') {
+        *b = 0 ;
+    } else return INIPARSER_BAD_NUMBER;
+    return INIPARSER_NO_ERROR;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Convert value of key/value pair to long int
+  @param    kv  key/value pair (not NULL)
+  @param    l   converted value
+  @return   INIPARSER_NO_ERROR or INIPARSER_BAD_NUMBER
+
+  Value is converted once: result is cached in `kv`. These functions don't
+  change last error.
+ */
+/*--------------------------------------------------------------------------*/
+static iniparser_err_t kv_tolong(const keyval * kv, long * l)
+{
+    unsigned flags = __atomic_load_n(&kv->vtype, __ATOMIC_ACQUIRE);
+    if(flags & KV_LONG){
+        *l = __atomic_load_n(&kv->lval, __ATOMIC_RELAXED);
+    }else{
+        flags = str_tolong(kv->val, l) ? KV_LONG|KV_LONGBAD : KV_LONG;
+        __atomic_store_n(&((keyval*)kv)->lval, *l, __ATOMIC_RELAXED);
+        flags = kv_cache(kv, flags);
+    }
+    return (flags & KV_LONGBAD) ? INIPARSER_BAD_NUMBER : INIPARSER_NO_ERROR;
+}
+
+/** Convert value of key/value pair to double */
+static iniparser_err_t kv_todouble(const keyval * kv, double * x)
+{
+    unsigned flags = __atomic_load_n(&kv->vtype, __ATOMIC_ACQUIRE);
+    if(flags & KV_DOUBLE){
+        __atomic_load(&kv->dval, x, __ATOMIC_RELAXED);
+    }else{
+        flags = str_todouble(kv->val, x) ? KV_DOUBLE|KV_DOUBLEBAD : KV_DOUBLE;
+        __atomic_store(&((keyval*)kv)->dval, x, __ATOMIC_RELAXED);
+        flags = kv_cache(kv, flags);
+    }
+    return (flags & KV_DOUBLEBAD) ? INIPARSER_BAD_NUMBER : INIPARSER_NO_ERROR;
+}
+
+/** Convert value of key/value pair to boolean (`b` isn't changed if value isn't boolean) */
+static iniparser_err_t kv_tobool(const keyval * kv, int * b)
+{
+    unsigned flags = __atomic_load_n(&kv->vtype, __ATOMIC_ACQUIRE);
+    if(!(flags & KV_BOOL)){
+        int v = 0;
+        if(str_tobool(kv->val, &v)) flags = KV_BOOL|KV_BOOLBAD;
+        else flags = v ? KV_BOOL|KV_TRUE : KV_BOOL;
+        flags = kv_cache(kv, flags);
+    }
+    if(flags & KV_BOOLBAD) return INIPARSER_BAD_NUMBER;
+    *b = (flags & KV_TRUE) ? 1 : 0;
+    return INIPARSER_NO_ERROR;
+}
+
+/** Convert value of key/value pair to long int, set last_error */
+static long int kv_getlongint(const keyval * kv, long int notfound)
+{
+    long l;
+    if(!kv) return notfound;
+    if(kv_tolong(kv, &l)) last_error = INIPARSER_BAD_NUMBER;
+    return l;
+}
+
+/** Convert value of key/value pair to double, set last_error */
+static double kv_getdouble(const keyval * kv, double notfound)
+{
+    double x;
+    if(!kv) return notfound;
+    if(kv_todouble(kv, &x)) last_error = INIPARSER_BAD_NUMBER;
+    return x;
+}
+
+/** Convert value of key/value pair to boolean, set last_error */
+static int kv_getboolean(const keyval * kv, int notfound)
+{
+    int b = notfound;
+    if(!kv) return notfound;
+    if(kv_tobool(kv, &b)) last_error = INIPARSER_BAD_NUMBER;
+    return b;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the string associated to a key
@@ -192,19 +437,8 @@ int iniparser_getsecnkeys(const dictionary * d, const char * s)
 /*--------------------------------------------------------------------------*/
 const char * iniparser_getstring(const dictionary * d, const char * key, const char * def)
 {
-    const char * lc_key ;
-    const char * sval ;
-    char tmp_str[ASCIILINESZ+1];
-
-    if (d==NULL || key==NULL){
-        last_error = INIPARSER_NO_OBJECT;
-        return def;
-    }
-
-    lc_key = strlwc(key, tmp_str, sizeof(tmp_str));
-    sval = dictionary_get(d, lc_key, def);
-    last_error = INIPARSER_NO_ERROR;
-    return sval ;
+    const keyval * kv = iniparser_getkv(d, key, NULL);
+    return kv ? kv->val : def;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -236,21 +470,7 @@ const char * iniparser_getstring(const dictionary * d, const char * key, const c
 /*--------------------------------------------------------------------------*/
 long int iniparser_getlongint(const dictionary * d, const char * key, long int notfound)
 {
-    const char * str ;
-
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str==INI_INVALID_KEY){
-        last_error = INIPARSER_NOT_FOUND;
-        return notfound;
-    }
-
-    char *eptr;
-    long l = strtol(str, &eptr, 0);
-    if(eptr)
-        last_error = INIPARSER_BAD_NUMBER;
-    else
-        last_error = INIPARSER_NO_ERROR;
-    return l;
+    return kv_getlongint(iniparser_getkv(d, key, NULL), notfound);
 }
 
 
@@ -301,20 +521,7 @@ int iniparser_getint(const dictionary * d, const char * key, int notfound)
 /*--------------------------------------------------------------------------*/
 double iniparser_getdouble(const dictionary * d, const char * key, double notfound)
 {
-    const char * str ;
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str==INI_INVALID_KEY){
-        last_error = INIPARSER_NOT_FOUND;
-        return notfound;
-    }
-
-    char *eptr;
-    double ret = strtod(str, &eptr);
-    if(eptr)
-        last_error = INIPARSER_BAD_NUMBER;
-    else
-        last_error = INIPARSER_NO_ERROR;
-    return ret;
+    return kv_getdouble(iniparser_getkv(d, key, NULL), notfound);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -351,267 +558,2132 @@ double iniparser_getdouble(const dictionary * d, const char * key, double notfou
 /*--------------------------------------------------------------------------*/
 int iniparser_getboolean(const dictionary * d, const char * key, int notfound)
 {
-    int          ret ;
-    const char * c ;
-
-    c = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (c==INI_INVALID_KEY){
-        last_error = INIPARSER_NOT_FOUND;
-        return notfound;
-    }
-    last_error = INIPARSER_NO_ERROR;
-    if (c[0]=='y' || c[0]=='Y' || c[0]=='1' || c[0]=='t' || c[0]=='T') {
-        ret = 1 ;
-    } else if (c[0]=='n' || c[0]=='N' || c[0]=='0' || c[0]=='f' || c[0]=='F') {
-        ret = 0 ;
-    } else {
-        last_error = INIPARSER_BAD_NUMBER;
-        ret = notfound ;
-    }
-    return ret;
+    return kv_getboolean(iniparser_getkv(d, key, NULL), notfound);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Finds out if a given entry exists in a dictionary
-  @param    ini     Dictionary to search
-  @param    entry   Name of the entry to look for
-  @return   integer 1 if entry exists, 0 otherwise
-
-  Finds out if a given entry exists in the dictionary. Since sections
-  are stored as keys with NULL associated values, this is the only way
-  of querying for the presence of sections in a dictionary.
+  @brief    Get the string associated to a key of given length
+  @param    d       Dictionary to search
+  @param    key     Key string to look for (not necessary zero-terminated)
+  @param    len     Length of `key`
+  @param    def     Default value to return if key not found.
+  @param    vlen    If not NULL, length of value returned
+  @return   pointer to statically allocated character string
  */
 /*--------------------------------------------------------------------------*/
-int iniparser_find_entry(const dictionary * ini, const char * entry)
+const char * iniparser_getstring_n(const dictionary * d, const char * key, size_t len,
+                                   const char * def, size_t * vlen)
 {
-    int found=0 ;
-    if (iniparser_getstring(ini, entry, INI_INVALID_KEY)!=INI_INVALID_KEY) {
-        found = 1 ;
-    }
-    return found ;
+    const keyval * kv = iniparser_getkv_n(d, key, len, NULL);
+    if(vlen) *vlen = kv ? kv->vlen : (def ? strlen(def) : 0);
+    return kv ? kv->val : def;
+}
+
+/** Get value of a key of given length converted to long int */
+long int iniparser_getlongint_n(const dictionary * d, const char * key, size_t len, long int notfound)
+{
+    return kv_getlongint(iniparser_getkv_n(d, key, len, NULL), notfound);
+}
+
+/** Get value of a key of given length converted to int */
+int iniparser_getint_n(const dictionary * d, const char * key, size_t len, int notfound)
+{
+    return (int)iniparser_getlongint_n(d, key, len, notfound);
+}
+
+/** Get value of a key of given length converted to double */
+double iniparser_getdouble_n(const dictionary * d, const char * key, size_t len, double notfound)
+{
+    return kv_getdouble(iniparser_getkv_n(d, key, len, NULL), notfound);
+}
+
+/** Get value of a key of given length converted to boolean */
+int iniparser_getboolean_n(const dictionary * d, const char * key, size_t len, int notfound)
+{
+    return kv_getboolean(iniparser_getkv_n(d, key, len, NULL), notfound);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Set an entry in a dictionary.
-  @param    ini     Dictionary to modify.
-  @param    entry   Entry to modify (entry name)
-  @param    val     New value to associate to the entry.
-  @return   int 0 if Ok, -1 otherwise.
-
-  If the given entry can be found in the dictionary, it is modified to
-  contain the provided value. If it cannot be found, the entry is created.
-  It is Ok to set val to NULL.
+  @brief    Get the strings associated to many keys
+  @param    d       Dictionary to search
+  @param    keys    Array of `n` keys ("section:key")
+  @param    n       Number of keys
+  @param    out     Array of `n` values
+  @return   number of keys found
+
+  Same as iniparser_getstring() for each key, but all keys are searched in
+  one pass (see dictionary_get_batch()), which is faster for many keys.
+  Values of keys not found aren't changed: fill `out` with defaults before
+  call. This function don't change last error.
  */
 /*--------------------------------------------------------------------------*/
-int iniparser_set(dictionary * ini, const char * entry, const char * val)
+size_t iniparser_get_batch(const dictionary * d, const char ** keys, size_t n, const char ** out)
 {
-    char tmp_str[ASCIILINESZ+1];
-    return dictionary_set(ini, strlwc(entry, tmp_str, sizeof(tmp_str)), val) ;
+    return dictionary_get_batch(d, keys, n, out, 1);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Load a single line from an INI file
-  @param    input_line  Input line, may be concatenated multi-line input
-  @param    section     Output space to store section
-  @param    key         Output space to store key
-  @param    value       Output space to store value
-  @return   line_status value
+  @brief    Resolve a key for repeated access
+  @param    d       Dictionary to search
+  @param    key     Key string to look for ("section:key")
+  @return   resolved key
+
+  The key is searched once; getters iniparser_get*_h() with resolved key
+  access its value directly. Resolved key stays valid while the key exists
+  in dictionary: value changes, additions and deletions of other keys don't
+  affect it. It becomes stale after the key or its section deleted and
+  after sorting of dictionary; getters return `notfound` value and set
+  error INIPARSER_STALE_KEY for stale keys. Resolve key again in this case.
+  If key not found, resolved key is invalid (INIPARSER_NOT_FOUND).
  */
 /*--------------------------------------------------------------------------*/
-static line_status iniparser_line(
-    const char * input_line,
-    char * section,
-    char * key,
-    char * value)
+iniparser_key_t iniparser_resolve(const dictionary * d, const char * key)
 {
-    line_status sta ;
-    char * line = NULL;
-    size_t      len ;
+    iniparser_key_t h;
+    iniparser_getkv(d, key, &h);
+    return h;
+}
 
-    line = strdup(input_line);
-    len = strstrip(line);
+/** Check if resolved key is valid */
+int iniparser_key_valid(const dictionary * d, iniparser_key_t h)
+{
+    return dictionary_keyval(d, h) != NULL;
+}
 
-    sta = LINE_UNPROCESSED ;
-    if (len<1) {
-        /* Empty line */
-        sta = LINE_EMPTY ;
-    } else if (line[0]=='#' || line[0]==';') {
-        /* Comment line */
-        sta = LINE_COMMENT ;
-    } else if (line[0]=='[' && line[len-1]==']') {
-        /* Section name */
-        sscanf(line, "[%[^]]", section);
-        strstrip(section);
-        strlwc(section, section, len);
-        sta = LINE_SECTION ;
-    } else if (sscanf (line, "%[^=] = \"%[^\"]\"", key, value) == 2
-           ||  sscanf (line, "%[^=] = '%[^\']'",   key, value) == 2) {
-        /* Usual key=value with quotes, with or without comments */
-        strstrip(key);
-        strlwc(key, key, len);
-        /* Don't strip spaces from values surrounded with quotes */
-        sta = LINE_VALUE ;
-    } else if (sscanf (line, "%[^=] = %[^;#]", key, value) == 2) {
-        /* Usual key=value without quotes, with or without comments */
-        strstrip(key);
-        strlwc(key, key, len);
-        strstrip(value);
-        /*
-         * sscanf cannot handle '' or "" as empty values
-         * this is done here
-         */
-        if (!strcmp(value, "\"\"") || (!strcmp(value, "''"))) {
-            value[0]=0 ;
-        }
-        sta = LINE_VALUE ;
-    } else if (sscanf(line, "%[^=] = %[;#]", key, value)==2
-           ||  sscanf(line, "%[^=] %[=]", key, value) == 2) {
-        /*
-         * Special cases:
-         * key=
-         * key=;
-         * key=#
-         */
-        strstrip(key);
-        strlwc(key, key, len);
-        value[0]=0 ;
-        sta = LINE_VALUE ;
-    } else {
-        /* Generate syntax error */
-        sta = LINE_ERROR ;
-    }
+/** Get string associated to resolved key */
+const char * iniparser_getstring_h(const dictionary * d, iniparser_key_t h, const char * def)
+{
+    const keyval * kv = iniparser_getkv_h(d, h);
+    return kv ? kv->val : def;
+}
 
-    free(line);
-    return sta ;
+/** Get value of resolved key converted to long int */
+long int iniparser_getlongint_h(const dictionary * d, iniparser_key_t h, long int notfound)
+{
+    return kv_getlongint(iniparser_getkv_h(d, h), notfound);
+}
+
+/** Get value of resolved key converted to int */
+int iniparser_getint_h(const dictionary * d, iniparser_key_t h, int notfound)
+{
+    return (int)iniparser_getlongint_h(d, h, notfound);
+}
+
+/** Get value of resolved key converted to double */
+double iniparser_getdouble_h(const dictionary * d, iniparser_key_t h, double notfound)
+{
+    return kv_getdouble(iniparser_getkv_h(d, h), notfound);
+}
+
+/** Get value of resolved key converted to boolean */
+int iniparser_getboolean_h(const dictionary * d, iniparser_key_t h, int notfound)
+{
+    return kv_getboolean(iniparser_getkv_h(d, h), notfound);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Parse an ini file and return an allocated dictionary object
-  @param    ininame Name of the ini file to read.
-  @return   Pointer to newly allocated dictionary
+  @brief    Get handle of a section
+  @param    d       Dictionary to search
+  @param    name    Section name (NULL or "" for keys outside of sections)
+  @return   section handle
+
+  Section is searched once, getters iniparser_sec_get*() search keys only
+  inside it, so there's no need to build "section:key" strings. Handle
+  keeps position of section and generation of dictionary: section is read
+  from dictionary on each access, because changing of section shared with
+  clone replaces it by copy. Handle becomes stale after the section deleted
+  and after sorting of dictionary (INIPARSER_STALE_KEY). If section not
+  found, getters return `notfound` value with INIPARSER_NOT_FOUND.
+ */
+/*--------------------------------------------------------------------------*/
+iniparser_sec_t iniparser_section(const dictionary * d, const char * name)
+{
+    iniparser_sec_t sec;
+    char tmp_str[ASCIILINESZ+1];
+
+    memset(&sec, 0, sizeof(sec));
+    sec.d = d;
+    sec.pos = DICT_NOPOS;
+    if(d==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return sec;
+    }
+    sec.gen = d->gen;
+    if(name==NULL || *name==0) sec.found = 1;
+    else if((sec.pos = dictentry_pos(d, strlwc(name, tmp_str, sizeof(tmp_str)))) != DICT_NOPOS){
+        sec.hash = d->entries[sec.pos]->hash;
+        sec.found = 1;
+    }
+    last_error = sec.found ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+    return sec;
+}
+
+/** Section of handle (NULL if section not found, deleted or dictionary was sorted) */
+static const dictentry * iniparser_sec_entry(iniparser_sec_t sec)
+{
+    const dictentry *de;
+    if(!sec.d || !sec.found || sec.gen != sec.d->gen) return NULL;
+    if(sec.pos == DICT_NOPOS) return sec.d->noname;
+    if(sec.pos >= sec.d->n) return NULL;
+    de = sec.d->entries[sec.pos];
+    return (de->name && de->hash == sec.hash) ? de : NULL; // name is NULL for deleted section
+}
+
+/** Check if section handle is valid (returns 1) or section not found/stale (returns 0) */
+int iniparser_sec_valid(iniparser_sec_t sec)
+{
+    return iniparser_sec_entry(sec) != NULL;
+}
+
+/** Get number of keys in a section */
+int iniparser_sec_nkeys(iniparser_sec_t sec)
+{
+    const dictentry *de = iniparser_sec_entry(sec);
+    size_t i, n = 0;
+    if(!de) return 0;
+    for(i = 0; i < de->n; ++i)
+        if(de->kvlist[i].key) ++n;
+    return (int)n;
+}
+
+/** Find key/value pair in a section (key is case insensitive) */
+static const keyval * iniparser_getkv_sec(iniparser_sec_t sec, const char * key)
+{
+    const dictentry * de ;
+    const keyval * kv ;
+    char tmp_str[ASCIILINESZ+1];
+
+    if(!sec.d || key==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    if(!(de = iniparser_sec_entry(sec))){
+        last_error = sec.found ? INIPARSER_STALE_KEY : INIPARSER_NOT_FOUND;
+        return NULL;
+    }
+    kv = dictentry_getkv(sec.d, de, strlwc(key, tmp_str, sizeof(tmp_str)));
+    last_error = kv ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+    return kv;
+}
+
+/** Get string associated to a key in a section */
+const char * iniparser_sec_getstring(iniparser_sec_t sec, const char * key, const char * def)
+{
+    const keyval * kv = iniparser_getkv_sec(sec, key);
+    return kv ? kv->val : def;
+}
+
+/** Get value of a key in a section converted to long int */
+long int iniparser_sec_getlongint(iniparser_sec_t sec, const char * key, long int notfound)
+{
+    return kv_getlongint(iniparser_getkv_sec(sec, key), notfound);
+}
+
+/** Get value of a key in a section converted to int */
+int iniparser_sec_getint(iniparser_sec_t sec, const char * key, int notfound)
+{
+    return (int)iniparser_sec_getlongint(sec, key, notfound);
+}
+
+/** Get value of a key in a section converted to double */
+double iniparser_sec_getdouble(iniparser_sec_t sec, const char * key, double notfound)
+{
+    return kv_getdouble(iniparser_getkv_sec(sec, key), notfound);
+}
+
+/** Get value of a key in a section converted to boolean */
+int iniparser_sec_getboolean(iniparser_sec_t sec, const char * key, int notfound)
+{
+    return kv_getboolean(iniparser_getkv_sec(sec, key), notfound);
+}
+
+/** Find key/value pair in overlay (key is case insensitive), sets last_error */
+static const keyval * iniparser_getkv_ov(const dictoverlay * o, const char * key)
+{
+    const keyval * kv ;
+
+    if(o==NULL || key==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    kv = dictoverlay_getkv_n(o, key, strlen(key), 1, NULL);
+    last_error = kv ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+    return kv;
+}
+
+/** Get string associated to a key in overlay */
+const char * iniparser_overlay_getstring(const dictoverlay * o, const char * key, const char * def)
+{
+    const keyval * kv = iniparser_getkv_ov(o, key);
+    return kv ? kv->val : def;
+}
+
+/** Get value of a key in overlay converted to long int */
+long int iniparser_overlay_getlongint(const dictoverlay * o, const char * key, long int notfound)
+{
+    return kv_getlongint(iniparser_getkv_ov(o, key), notfound);
+}
+
+/** Get value of a key in overlay converted to int */
+int iniparser_overlay_getint(const dictoverlay * o, const char * key, int notfound)
+{
+    return (int)iniparser_overlay_getlongint(o, key, notfound);
+}
+
+/** Get value of a key in overlay converted to double */
+double iniparser_overlay_getdouble(const dictoverlay * o, const char * key, double notfound)
+{
+    return kv_getdouble(iniparser_getkv_ov(o, key), notfound);
+}
+
+/** Get value of a key in overlay converted to boolean */
+int iniparser_overlay_getboolean(const dictoverlay * o, const char * key, int notfound)
+{
+    return kv_getboolean(iniparser_getkv_ov(o, key), notfound);
+}
+
+/** Find value in snapshot (key is case insensitive), sets last_error */
+static const char * iniparser_getval_snap(const dictsnap * s, const char * key)
+{
+    const char * val ;
+
+    if(s==NULL || key==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    val = dictsnap_get_n(s, key, strlen(key), 1, NULL);
+    last_error = val ? INIPARSER_NO_ERROR : INIPARSER_NOT_FOUND;
+    return val;
+}
+
+/** Write snapshot of dictionary into file `path` (0 if Ok) */
+int iniparser_snapshot_write(const dictionary * d, const char * path)
+{
+    if(d==NULL || path==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    if(dictsnap_write(d, path)){
+        last_error = INIPARSER_CANT_OPEN;
+        return -1;
+    }
+    last_error = INIPARSER_NO_ERROR;
+    return 0;
+}
+
+/** Map snapshot file written by iniparser_snapshot_write() (NULL if it's absent or broken) */
+const dictsnap * iniparser_snapshot_open(const char * path)
+{
+    const dictsnap * s = dictsnap_open(path);
+    last_error = s ? INIPARSER_NO_ERROR : INIPARSER_CANT_OPEN;
+    return s;
+}
+
+/** Put snapshot of dictionary into sealed shared memory, returns its descriptor or -1 */
+int iniparser_share(const dictionary * d)
+{
+    int fd;
+    if(d==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    fd = dictsnap_share(d);
+    last_error = (fd < 0) ? INIPARSER_NO_MEM : INIPARSER_NO_ERROR;
+    return fd;
+}
+
+/** Map snapshot shared by iniparser_share() read-only (NULL in case of error) */
+const dictsnap * iniparser_attach(int fd)
+{
+    const dictsnap * s = dictsnap_attach(fd);
+    last_error = s ? INIPARSER_NO_ERROR : INIPARSER_CANT_OPEN;
+    return s;
+}
+
+/** Unmap snapshot */
+void iniparser_snapshot_close(const dictsnap * s)
+{
+    dictsnap_close(s);
+}
+
+/** Get string associated to a key in snapshot */
+const char * iniparser_snapshot_getstring(const dictsnap * s, const char * key, const char * def)
+{
+    const char * val = iniparser_getval_snap(s, key);
+    return val ? val : def;
+}
+
+/** Get value of a key in snapshot converted to long int */
+long int iniparser_snapshot_getlongint(const dictsnap * s, const char * key, long int notfound)
+{
+    const char * val = iniparser_getval_snap(s, key);
+    long l;
+    if(!val) return notfound;
+    if(str_tolong(val, &l)) last_error = INIPARSER_BAD_NUMBER;
+    return l;
+}
+
+/** Get value of a key in snapshot converted to int */
+int iniparser_snapshot_getint(const dictsnap * s, const char * key, int notfound)
+{
+    return (int)iniparser_snapshot_getlongint(s, key, notfound);
+}
+
+/** Get value of a key in snapshot converted to double */
+double iniparser_snapshot_getdouble(const dictsnap * s, const char * key, double notfound)
+{
+    const char * val = iniparser_getval_snap(s, key);
+    double x;
+    if(!val) return notfound;
+    if(str_todouble(val, &x)) last_error = INIPARSER_BAD_NUMBER;
+    return x;
+}
+
+/** Get value of a key in snapshot converted to boolean */
+int iniparser_snapshot_getboolean(const dictsnap * s, const char * key, int notfound)
+{
+    const char * val = iniparser_getval_snap(s, key);
+    int b = notfound;
+    if(!val) return notfound;
+    if(str_tobool(val, &b)) last_error = INIPARSER_BAD_NUMBER;
+    return b;
+}
+
+/** Struct field to bind (internal use only) */
+typedef struct {
+    size_t          idx ;   /** Index in fields table */
+    const char   *  sec ;   /** Lowercased section name (NULL for keys outside of sections) */
+    const char   *  key ;   /** Lowercased key name */
+    hash_t          shash ; /** Hash of section name */
+    hash_t          khash ; /** Hash of key name */
+    const keyval *  kv ;    /** Key/value pair found */
+} bindfield;
+
+/** Check if fields are in the same section */
+static int bind_samesec(const bindfield * a, const bindfield * b)
+{
+    if(!a->sec || !b->sec) return a->sec == b->sec;
+    return a->shash == b->shash && !strcmp(a->sec, b->sec);
+}
+
+/** Compare fields by section (keys outside of sections first) */
+static int cmpbindsec(const void *p1, const void *p2)
+{
+    const bindfield *a = (const bindfield*)p1, *b = (const bindfield*)p2;
+    int r;
+    if(!a->sec || !b->sec) r = (a->sec != NULL) - (b->sec != NULL);
+    else if(a->shash != b->shash) r = (a->shash < b->shash) ? -1 : 1;
+    else r = strcmp(a->sec, b->sec);
+    if(r) return r;
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+/** Compare fields by key hash */
+static int cmpbindkey(const void *p1, const void *p2)
+{
+    const bindfield *a = (const bindfield*)p1, *b = (const bindfield*)p2;
+    if(a->khash != b->khash) return (a->khash < b->khash) ? -1 : 1;
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Convert value and store it into struct field
+  @param    f       Field description
+  @param    obj     Struct to fill
+  @param    kv      Key/value pair (if NULL, `str` is used)
+  @param    str     Value string (default)
+  @return   INIPARSER_NO_ERROR if field was filled or error code
+ */
+/*--------------------------------------------------------------------------*/
+static iniparser_err_t bind_store(const iniparser_field_t * f, void * obj,
+                                  const keyval * kv, const char * str)
+{
+    char *p = (char*)obj + f->offset;
+    const char *val = kv ? kv->val : str;
+    iniparser_err_t err = INIPARSER_NO_ERROR;
+    long l = 0;
+    double x = 0.;
+    int b = 0;
+
+    if(!val && f->type != INIPARSER_T_STRING) return INIPARSER_BAD_NUMBER;
+    switch(f->type){
+        case INIPARSER_T_INT:
+        case INIPARSER_T_LONG:
+            err = kv ? kv_tolong(kv, &l) : str_tolong(str, &l);
+            if(f->type == INIPARSER_T_INT && (l < INT_MIN || l > INT_MAX))
+                return err ? err : INIPARSER_OUT_OF_RANGE;
+            x = (double)l;
+        break;
+        case INIPARSER_T_DOUBLE:
+            err = kv ? kv_todouble(kv, &x) : str_todouble(str, &x);
+        break;
+        case INIPARSER_T_BOOL:
+            err = kv ? kv_tobool(kv, &b) : str_tobool(str, &b);
+        break;
+        case INIPARSER_T_STRING:
+        break;
+        case INIPARSER_T_STRBUF:
+            if(strlen(val) >= f->size) return INIPARSER_TOO_LONG;
+        break;
+        default:
+            return INIPARSER_NO_OBJECT;
+    }
+    if(err) return err;
+    if(f->max > f->min && (f->type == INIPARSER_T_INT || f->type == INIPARSER_T_LONG
+                            || f->type == INIPARSER_T_DOUBLE)){
+        if(x < f->min || x > f->max) return INIPARSER_OUT_OF_RANGE;
+    }
+    switch(f->type){
+        case INIPARSER_T_INT:
+            *(int*)p = (int)l;
+        break;
+        case INIPARSER_T_LONG:
+            *(long*)p = l;
+        break;
+        case INIPARSER_T_DOUBLE:
+            *(double*)p = x;
+        break;
+        case INIPARSER_T_BOOL:
+            *(int*)p = b;
+        break;
+        case INIPARSER_T_STRING:
+            *(const char**)p = val;
+        break;
+        case INIPARSER_T_STRBUF:
+            memcpy(p, val, strlen(val) + 1);
+        break;
+    }
+    return INIPARSER_NO_ERROR;
+}
+
+/** Add error to list, returns new amount of errors */
+static int bind_error(iniparser_binderr_t * errs, size_t nerrs, int nerr,
+                      size_t idx, iniparser_err_t err)
+{
+    if(errs && (size_t)nerr < nerrs){
+        errs[nerr].field = idx;
+        errs[nerr].err = err;
+    }
+    return nerr + 1;
+}
+
+/** Fill one field by value found (`kv`) or default, returns new amount of errors */
+static int bind_one(const iniparser_field_t * fields, const bindfield * b, void * obj,
+                    iniparser_binderr_t * errs, size_t nerrs, int nerr)
+{
+    const iniparser_field_t *f = &fields[b->idx];
+    iniparser_err_t err = INIPARSER_NOT_FOUND;
+
+    if(b->kv && (err = bind_store(f, obj, b->kv, NULL)) == INIPARSER_NO_ERROR) return nerr;
+    if(b->kv || !f->def) nerr = bind_error(errs, nerrs, nerr, b->idx, err);
+    if(f->def && (err = bind_store(f, obj, NULL, f->def)) != INIPARSER_NO_ERROR)
+        nerr = bind_error(errs, nerrs, nerr, b->idx, err);
+    return nerr;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Fill fields of one section
+  @param    d       Dictionary
+  @param    de      Section (NULL if not found)
+  @param    fields  Table of fields descriptions
+  @param    b       Fields of this section
+  @param    n       Amount of fields in `b`
+  @return   new amount of errors
+ */
+/*--------------------------------------------------------------------------*/
+static int bind_section(const dictionary * d, const dictentry * de,
+                        const iniparser_field_t * fields, bindfield * b, size_t n,
+                        void * obj, iniparser_binderr_t * errs, size_t nerrs, int nerr)
+{
+    size_t i, k;
+
+    if(de && n * BIND_RATIO < de->n){ // few fields in large section: search them
+        for(i = 0; i < n; ++i) b[i].kv = dictentry_getkv(d, de, b[i].key);
+    }else if(de){ // check each key of section once
+        qsort(b, n, sizeof(bindfield), cmpbindkey);
+        for(k = 0; k < de->n; ++k){
+            const keyval *kv = &de->kvlist[k];
+            size_t lo = 0, hi = n;
+            if(!kv->key) continue; // deleted
+            while(lo < hi){
+                size_t mid = (lo + hi) / 2;
+                if(b[mid].khash < kv->hash) lo = mid + 1;
+                else hi = mid;
+            }
+            for(; lo < n && b[lo].khash == kv->hash; ++lo)
+                if(!b[lo].kv && !strcmp(b[lo].key, kv->key)) b[lo].kv = kv;
+        }
+    }
+    for(i = 0; i < n; ++i)
+        nerr = bind_one(fields, &b[i], obj, errs, nerrs, nerr);
+    return nerr;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Fill a struct by values from dictionary
+  @param    d       Dictionary to read
+  @param    fields  Table of struct fields descriptions
+  @param    n       Amount of fields
+  @param    obj     Struct to fill
+  @param    errs    Array for errors (could be NULL)
+  @param    nerrs   Size of `errs`
+  @return   amount of errors found (could be more than `nerrs`) or -1 in case of error
+
+  Fields are sorted by section, so each section is searched once, then
+  values of its fields are found and converted.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_bind(const dictionary * d, const iniparser_field_t * fields, size_t n,
+                   void * obj, iniparser_binderr_t * errs, size_t nerrs)
+{
+    bindfield *b;
+    char *names, *delim;
+    size_t i, j, len = 0;
+    int nerr = 0;
+
+    if(d==NULL || obj==NULL || (fields==NULL && n)){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    for(i = 0; i < n; ++i){
+        if(fields[i].key==NULL){
+            last_error = INIPARSER_NO_OBJECT;
+            return -1;
+        }
+        len += strlen(fields[i].key) + 1;
+    }
+    last_error = INIPARSER_NO_ERROR;
+    if(n == 0) return 0;
+    // one block: fields and their lowercased names
+    b = malloc(n * sizeof(bindfield) + len);
+    if(!b){
+        last_error = INIPARSER_NO_MEM;
+        return -1;
+    }
+    names = (char*)(b + n);
+    for(i = 0; i < n; ++i){
+        len = strlen(fields[i].key) + 1;
+        strlwc(fields[i].key, names, len);
+        b[i].idx = i;
+        b[i].kv = NULL;
+        delim = strchr(names, ':');
+        if(delim){
+            *delim = 0;
+            b[i].sec = names;
+            b[i].shash = dictionary_hash(names);
+            b[i].key = delim + 1;
+        }else{
+            b[i].sec = NULL;
+            b[i].shash = 0;
+            b[i].key = names;
+        }
+        b[i].khash = dictionary_hash(b[i].key);
+        names += len;
+    }
+    qsort(b, n, sizeof(bindfield), cmpbindsec);
+    for(i = 0; i < n; i = j){
+        const dictentry *de = b[i].sec ? dictentry_find(d, b[i].sec) : d->noname;
+        for(j = i + 1; j < n && bind_samesec(&b[i], &b[j]); ++j);
+        nerr = bind_section(d, de, fields, b + i, j - i, obj, errs, nerrs, nerr);
+    }
+    free(b);
+    return nerr;
+}
+
+/** Start walking over sections */
+int iniparser_iter_sections(const dictionary * d, iniparser_order_t order, iniparser_iter_t * it)
+{
+    if(it==NULL) return -1;
+    memset(&it->sec, 0, sizeof(it->sec));
+    it->sec.d = d;
+    return dictionary_iter(d, NULL, (dictorder_t)order, &it->it);
+}
+
+/** Start walking over keys of section */
+int iniparser_iter_keys(iniparser_sec_t sec, iniparser_order_t order, iniparser_iter_t * it)
+{
+    const dictentry *de = iniparser_sec_entry(sec);
+    if(it==NULL) return -1;
+    it->sec = sec;
+    if(!de){ // nothing to walk
+        dictionary_iter(NULL, NULL, DICT_BYPOS, &it->it);
+        return sec.d ? 0 : -1;
+    }
+    return dictionary_iter(sec.d, de, (dictorder_t)order, &it->it);
+}
+
+/** Get next section or key */
+int iniparser_iter_next(iniparser_iter_t * it, iniparser_item_t * item)
+{
+    size_t pos;
+    if(it==NULL || item==NULL) return 0;
+    if((pos = dictiter_next(&it->it)) == DICT_NOPOS) return 0;
+    if(it->it.de){ // key
+        const keyval *kv = &it->it.de->kvlist[pos];
+        item->name = kv->key;
+        item->nlen = kv->klen;
+        item->val = kv->val;
+        item->vlen = kv->vlen;
+        item->sec = it->sec;
+    }else{ // section
+        const dictentry *de = it->it.d->entries[pos];
+        item->name = de->name;
+        item->nlen = de->nlen;
+        item->val = NULL;
+        item->vlen = 0;
+        item->sec.d = it->it.d;
+        item->sec.pos = pos;
+        item->sec.gen = it->it.d->gen;
+        item->sec.hash = de->hash;
+        item->sec.found = 1;
+    }
+    return 1;
+}
+
+/** Start query with given flags, sets last_error */
+static int iniparser_query(const dictionary * d, const char * pattern, int flags, iniparser_query_t * q)
+{
+    if(d==NULL || pattern==NULL || q==NULL){
+        if(q) memset(q, 0, sizeof(iniparser_query_t));
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    if(dictionary_query(d, pattern, flags | DICTQ_LWC, q)){
+        last_error = INIPARSER_NO_MEM;
+        return -1;
+    }
+    last_error = INIPARSER_NO_ERROR;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find all keys or sections which names start with given prefix
+  @param    d       Dictionary to search
+  @param    prefix  "section:prefix" for keys or "prefix" for sections
+  @param    q       Query to initialize
+  @return   0 if Ok, -1 in case of error
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_query_prefix(const dictionary * d, const char * prefix, iniparser_query_t * q)
+{
+    return iniparser_query(d, prefix, 0, q);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find all keys or sections which names match glob pattern
+  @param    d       Dictionary to search
+  @param    pattern "section:pattern" for keys or "pattern" for sections
+  @param    q       Query to initialize
+  @return   0 if Ok, -1 in case of error
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_query_glob(const dictionary * d, const char * pattern, iniparser_query_t * q)
+{
+    return iniparser_query(d, pattern, DICTQ_GLOB, q);
+}
+
+/** Get next item found by query */
+int iniparser_query_next(iniparser_query_t * q, const char ** name, const char ** val)
+{
+    return dictquery_next(q, name, val);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Finds out if a given entry exists in a dictionary
+  @param    ini     Dictionary to search
+  @param    entry   Name of the entry to look for
+  @return   integer 1 if entry exists, 0 otherwise
+
+  Finds out if a given entry exists in the dictionary. Since sections
+  are stored as keys with NULL associated values, this is the only way
+  of querying for the presence of sections in a dictionary.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_find_entry(const dictionary * ini, const char * entry)
+{
+    return iniparser_getkv(ini, entry, NULL) != NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set an entry in a dictionary.
+  @param    ini     Dictionary to modify.
+  @param    entry   Entry to modify (entry name)
+  @param    val     New value to associate to the entry.
+  @return   int 0 if Ok, -1 otherwise.
+
+  If the given entry can be found in the dictionary, it is modified to
+  contain the provided value. If it cannot be found, the entry is created.
+  It is Ok to set val to NULL.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_set(dictionary * ini, const char * entry, const char * val)
+{
+    char tmp_str[ASCIILINESZ+1];
+    return dictionary_set(ini, strlwc(entry, tmp_str, sizeof(tmp_str)), val) ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set an entry of given length in a dictionary.
+  @param    ini     Dictionary to modify.
+  @param    entry   Entry to modify (not necessary zero-terminated)
+  @param    len     Length of `entry` (not more than 1024)
+  @param    val     New value (not necessary zero-terminated) or NULL to erase.
+  @param    vlen    Length of `val`
+  @return   int 0 if Ok, -1 otherwise.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_set_n(dictionary * ini, const char * entry, size_t len, const char * val, size_t vlen)
+{
+    char tmp_str[ASCIILINESZ+1];
+    size_t i;
+    if(entry==NULL || len > ASCIILINESZ) return -1;
+    for(i = 0; i < len; ++i) tmp_str[i] = (char)tolower((int)entry[i]);
+    return dictionary_set_n(ini, tmp_str, len, val, vlen);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load a single line from an INI file
+  @param    input_line  Input line, may be concatenated multi-line input
+  @param    section     Output space to store section
+  @param    key         Output space to store key
+  @param    value       Output space to store value
+  @return   line_status value
+ */
+/*--------------------------------------------------------------------------*/
+static line_status iniparser_line(
+    const char * input_line,
+    char * section,
+    char * key,
+    char * value)
+{
+    line_status sta ;
+    char * line = NULL;
+    size_t      len ;
+
+    line = strdup(input_line);
+    len = strstrip(line);
+
+    sta = LINE_UNPROCESSED ;
+    if (len<1) {
+        /* Empty line */
+        sta = LINE_EMPTY ;
+    } else if (line[0]=='#' || line[0]==';') {
+        /* Comment line */
+        sta = LINE_COMMENT ;
+    } else if (line[0]=='[' && line[len-1]==']') {
+        /* Section name */
+        sscanf(line, "[%[^]]", section);
+        strstrip(section);
+        strlwc(section, section, len);
+        sta = LINE_SECTION ;
+    } else if (sscanf (line, "%[^=] = \"%[^\"]\"", key, value) == 2
+           ||  sscanf (line, "%[^=] = '%[^\']'",   key, value) == 2) {
+        /* Usual key=value with quotes, with or without comments */
+        strstrip(key);
+        strlwc(key, key, len);
+        /* Don't strip spaces from values surrounded with quotes */
+        sta = LINE_VALUE ;
+    } else if (sscanf (line, "%[^=] = %[^;#]", key, value) == 2) {
+        /* Usual key=value without quotes, with or without comments */
+        strstrip(key);
+        strlwc(key, key, len);
+        strstrip(value);
+        /*
+         * sscanf cannot handle '' or "" as empty values
+         * this is done here
+         */
+        if (!strcmp(value, "\"\"") || (!strcmp(value, "''"))) {
+            value[0]=0 ;
+        }
+        sta = LINE_VALUE ;
+    } else if (sscanf(line, "%[^=] = %[;#]", key, value)==2
+           ||  sscanf(line, "%[^=] %[=]", key, value) == 2) {
+        /*
+         * Special cases:
+         * key=
+         * key=;
+         * key=#
+         */
+        strstrip(key);
+        strlwc(key, key, len);
+        value[0]=0 ;
+        sta = LINE_VALUE ;
+    } else {
+        /* Generate syntax error */
+        sta = LINE_ERROR ;
+    }
+
+    free(line);
+    return sta ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse ini text from stream
+  @param    in      Stream to read.
+  @param    ininame Name of the ini file (for error messages).
+  @param    lineno  Number of lines before start of stream.
+  @return   Pointer to newly allocated dictionary or NULL
+ */
+/*--------------------------------------------------------------------------*/
+static dictionary * iniparser_load_file(FILE * in, const char * ininame, int lineno)
+{
+    char line    [ASCIILINESZ+1] ;
+    char section [ASCIILINESZ+1] ;
+    char key     [ASCIILINESZ+1] ;
+    char tmp     [(ASCIILINESZ * 2) + 1] ;
+    char val     [ASCIILINESZ+1] ;
+
+    int  last=0 ;
+    int  len ;
+    int  errs=0;
+    int  mem_err=0;
+
+    dictionary * dict ;
+
+    dict = dictionary_new(0) ;
+    if (!dict) {
+        last_error = INIPARSER_NO_MEM;
+        return NULL ;
+    }
+
+    memset(line,    0, ASCIILINESZ);
+    memset(section, 0, ASCIILINESZ);
+    memset(key,     0, ASCIILINESZ);
+    memset(val,     0, ASCIILINESZ);
+    last=0 ;
+
+    while (fgets(line+last, ASCIILINESZ-last, in)!=NULL) {
+        lineno++ ;
+        len = (int)strlen(line)-1;
+        if (len<=0)
+            continue;
+        /* Safety check against buffer overflows */
+        if (line[len]!='\n' && !feof(in)) {
+            last_error = INIPARSER_TOO_LONG;
+            snprintf(last_errmsg, ASCIILINESZ,
+              "input line too long in %s (%d)",
+              ininame,
+              lineno);
+            dictionary_del(dict);
+            return NULL ;
+        }
+        /* Get rid of \n and spaces at end of line */
+        while ((len>=0) &&
+                ((line[len]=='\n') || (isspace(line[len])))) {
+            line[len]=0 ;
+            len-- ;
+        }
+        if (len < 0) { /* Line was entirely \n and/or spaces */
+            len = 0;
+        }
+        /* Detect multi-line */
+        if (line[len]=='\\') {
+            /* Multi-line value */
+            last=len ;
+            continue ;
+        } else {
+            last=0 ;
+        }
+        switch (iniparser_line(line, section, key, val)) {
+            case LINE_EMPTY:
+            case LINE_COMMENT:
+            case LINE_SECTION:
+            break ;
+
+            case LINE_VALUE:
+            if(!section || !*section) // unnamed section
+                len = sprintf(tmp, "%s", key);
+            else
+                len = sprintf(tmp, "%s:%s", section, key);
+            mem_err = dictionary_set_n(dict, tmp, (size_t)len, val, strlen(val));
+            break ;
+
+            case LINE_ERROR:
+            last_error = INIPARSER_SYNTAX_ERR;
+            snprintf(last_errmsg, ASCIILINESZ,
+              "syntax error in %s (%d):\n-> %s",
+              ininame,
+              lineno,
+              line);
+            errs++ ;
+            break;
+
+            default:
+            break ;
+        }
+        memset(line, 0, ASCIILINESZ);
+        last=0;
+        if (mem_err < 0) {
+            last_error = INIPARSER_NO_MEM;
+            snprintf(last_errmsg, ASCIILINESZ,("memory allocation failure"));
+            break ;
+        }
+    }
+    if (errs) {
+        dictionary_del(dict);
+        dict = NULL ;
+    }
+    return dict ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file and return an allocated dictionary object
+  @param    ininame Name of the ini file to read.
+  @return   Pointer to newly allocated dictionary
+
+  This is the parser for ini files. This function is called, providing
+  the name of the file to be read. It returns a dictionary object that
+  should not be accessed directly, but through accessor functions
+  instead.
+
+  The returned dictionary must be freed using iniparser_freedict().
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * iniparser_load(const char * ininame)
+{
+    FILE * in ;
+    dictionary * dict ;
+
+    if ((in=fopen(ininame, "r"))==NULL) {
+        last_error = INIPARSER_CANT_OPEN;
+        return NULL ;
+    }
+    dict = iniparser_load_file(in, ininame, 0);
+    fclose(in);
+    return dict ;
+}
+
+/** 64-bit FNV-1a hash of text of section: 32-bit hash of dictionary is too short to trust equal texts */
+static uint64_t ini_texthash(const char * text, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    size_t i;
+    for(i = 0; i < len; ++i){
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Put section of reloaded file into new dictionary
+  @param    d       New dictionary.
+  @param    old     Previous version (could be NULL).
+  @param    text    Text of section (from its header up to the next one).
+  @param    len     Length of `text`.
+  @param    name    Lowercased name of section (NULL for keys before sections).
+  @param    lineno  Number of lines before `text` (for error messages).
+  @param    ininame Name of file.
+  @return   0 if Ok, -1 if text can't be parsed (last_error is set), 1 if
+            section was met before (the whole file should be parsed)
+
+  If old section has the same 64-bit hash and length of text, it is shared
+  by dictionary_adopt(), otherwise only `text` is parsed.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_reload_section(dictionary * d, const dictionary * old, const char * text,
+                                    size_t len, const char * name, int lineno, const char * ininame)
+{
+    const dictentry *o = NULL;
+    dictionary *tmp;
+    dictentry *de;
+    uint64_t h;
+    FILE *in;
+    int ret = 0;
+    if(!len) return 0;
+    h = ini_texthash(text, len);
+    if(old) o = name ? dictentry_find(old, name) : old->noname;
+    if(o && o->tlen == len && o->text == h) return dictionary_adopt(d, o) ? 1 : 0;
+    if(!(in = fmemopen((void*)text, len, "r"))){
+        last_error = INIPARSER_NO_MEM;
+        return -1;
+    }
+    tmp = iniparser_load_file(in, ininame, lineno);
+    fclose(in);
+    if(!tmp) return -1;
+    de = name ? dictentry_find(tmp, name) : tmp->noname;
+    if(de && de->n){
+        de->text = h;
+        de->tlen = len;
+        if(dictionary_adopt(d, de)) ret = 1;
+    }
+    dictionary_del(tmp);
+    return ret;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file again, reusing unchanged sections
+  @param    old     Dictionary of previous version of file (could be NULL).
+  @param    ininame Name of the ini file to read.
+  @return   Pointer to newly allocated dictionary or NULL
+
+  File is mapped and cut into sections by their headers (with multi-line
+  values and headers of empty names taken into account as by parser).
+  Text of each section is hashed: section of `old` with the same text is
+  shared with new dictionary (as by dictionary_clone()), other sections are
+  parsed. So reloading costs hashing of file plus parsing of changed
+  sections. Hashes are kept in sections of result for the next reload;
+  sections changed by dictionary_set() are always parsed.
+
+  If section is met twice in file, it is parsed as whole by
+  iniparser_load(). `old` isn't changed and could be freed after this call
+  (or later: e.g. when readers of dictrcu leave it).
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * iniparser_reload(const dictionary * old, const char * ininame)
+{
+    char line    [ASCIILINESZ+1] ;
+    char section [ASCIILINESZ+1] ;
+    char cur     [ASCIILINESZ+1] ;
+    char key     [ASCIILINESZ+1] ;
+    char val     [ASCIILINESZ+1] ;
+    const char *buf = NULL, *p, *e, *b;
+    size_t size, start = 0, l;
+    int fd, cont = 0, lineno = 0, startline = 0, named = 0, ret = 0;
+    struct stat st;
+    dictionary *d;
+
+    if(ininame==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    if((fd = open(ininame, O_RDONLY)) < 0){
+        last_error = INIPARSER_CANT_OPEN;
+        return NULL;
+    }
+    if(fstat(fd, &st)){
+        close(fd);
+        last_error = INIPARSER_CANT_OPEN;
+        return NULL;
+    }
+    size = (size_t)st.st_size;
+    if(size && (buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+        close(fd);
+        return iniparser_load(ininame);
+    }
+    close(fd);
+    if(!(d = dictionary_new(0))){
+        if(buf) munmap((void*)buf, size);
+        last_error = INIPARSER_NO_MEM;
+        return NULL;
+    }
+    for(p = buf; p < buf + size; p = e, ++lineno){
+        const char *end = memchr(p, '\n', (size_t)(buf + size - p));
+        e = end ? end + 1 : buf + size;
+        for(l = (size_t)(e - p); l && isspace((unsigned char)p[l-1]); --l);
+        for(b = p; b < p + l && isspace((unsigned char)*b); ++b);
+        if(!cont && b < p + l && *b == '['){ // could be header of section
+            if((size_t)(e - p) >= ASCIILINESZ){ret = 1; break;} // let parser complain
+            memcpy(line, p, (size_t)(e - p));
+            line[e - p] = 0;
+            section[0] = 0;
+            if(iniparser_line(line, section, key, val) == LINE_SECTION){
+                if(!*section){ret = 1; break;} // "[]" or "[ ]": keys stay in the previous section
+                if((ret = iniparser_reload_section(d, old, buf + start, (size_t)(p - buf) - start,
+                                                   named ? cur : NULL, startline, ininame))) break;
+                strcpy(cur, section);
+                named = 1;
+                start = (size_t)(p - buf);
+                startline = lineno;
+            }
+        }
+        cont = (l && p[l-1] == '\\');
+    }
+    if(!ret) ret = iniparser_reload_section(d, old, buf + start, size - start,
+                                            named ? cur : NULL, startline, ininame);
+    if(buf) munmap((void*)buf, size);
+    if(ret){
+        dictionary_del(d);
+        if(ret < 0) return NULL;
+        return iniparser_load(ininame);
+    }
+    last_error = INIPARSER_NO_ERROR;
+    return d;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find positions of keys and sections of dictionary in its ini file
+  @param    d       Dictionary loaded from file.
+  @param    ininame Name of the ini file.
+  @return   0 if Ok, -1 otherwise (with last_error set)
+
+  File is read the same way as by iniparser_load(). For each key span of its
+  line and value is stored, for each section span of its header and end of
+  its last key: new keys of section are inserted there.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_track(dictionary * d, const char * ininame)
+{
+    FILE * in ;
+
+    char line    [ASCIILINESZ+1] ;
+    char section [ASCIILINESZ+1] ;
+    char key     [ASCIILINESZ+1] ;
+    char tmp     [(ASCIILINESZ * 2) + 1] ;
+    char val     [ASCIILINESZ+1] ;
+
+    int  last=0, len, nl=1, nlines=0;
+    size_t l;
+    off_t off=0, start=0, lastend=0; // end of file read, start of current line, end of last key
+    dictspan sp;
+    dictsrc *s;
+    dictentry *de = NULL; // current section
+    keyval *kv;
+
+    if(dictionary_track(d, ininame)){
+        last_error = INIPARSER_NO_MEM;
+        return -1;
+    }
+    s = d->src;
+    ininame = s->file; // could be name of previous source freed
+    if ((in=fopen(ininame, "r"))==NULL) {
+        dictionary_track(d, NULL);
+        last_error = INIPARSER_CANT_OPEN;
+        return -1 ;
+    }
+    s->noname_end = -1;
+    memset(section, 0, ASCIILINESZ);
+    memset(line, 0, ASCIILINESZ);
+    while (fgets(line+last, ASCIILINESZ-last, in)!=NULL) {
+        l = strlen(line+last);
+        if(!last){
+            start = off;
+            nlines = 0;
+        }
+        ++nlines;
+        off += (off_t)l;
+        nl = (l && line[last+l-1] == '\n');
+        len = (int)strlen(line)-1;
+        if (len<=0)
+            continue;
+        while ((len>=0) &&
+                ((line[len]=='\n') || (isspace(line[len])))) {
+            line[len]=0 ;
+            len-- ;
+        }
+        if (len < 0) len = 0;
+        if (line[len]=='\\') { // multi-line value
+            last=len ;
+            continue ;
+        }
+        last=0 ;
+        memset(&sp, 0, sizeof(sp));
+        sp.line = start;
+        sp.llen = (size_t)(off - start);
+        switch (iniparser_line(line, section, key, val)) {
+            case LINE_SECTION:
+            if(de) s->spans[de->src - 1].val = lastend;
+            else if(s->noname_end < 0) s->noname_end = lastend;
+            lastend = off;
+            sp.val = off;
+            sp.section = 1;
+            if((de = dictentry_find(d, section)) && !(de->src = dictsrc_addspan(s, &sp)))
+                goto nomem;
+            break ;
+
+            case LINE_VALUE:
+            if(*section) len = snprintf(tmp, sizeof(tmp), "%s:%s", section, key);
+            else len = snprintf(tmp, sizeof(tmp), "%s", key);
+            kv = (keyval*)dictionary_getkv_n(d, tmp, (size_t)len, 0, NULL);
+            if(!kv) break; // could be section name without keys
+            lastend = off;
+            if(nlines > 1){ // multi-line value: replace all its lines
+                sp.whole = 1;
+                sp.val = start;
+                sp.vlen = sp.llen - (nl ? 1 : 0);
+            }else{
+                const char *v = strchr(line, '='), *e;
+                for(++v; *v == ' ' || *v == '\t'; ++v);
+                if((*v == '"' || *v == '\'') && v[1] != *v && (e = strchr(v + 1, *v)))
+                    e++; // quoted value
+                else{
+                    e = v + strcspn(v, ";#");
+                    while(e > v && isspace((unsigned char)e[-1])) --e;
+                }
+                sp.val = start + (off_t)(v - line);
+                sp.vlen = (size_t)(e - v);
+            }
+            if(!(kv->src = dictsrc_addspan(s, &sp))) goto nomem;
+            break ;
+
+            default:
+            break ;
+        }
+        memset(line, 0, ASCIILINESZ);
+    }
+    fclose(in);
+    if(de) s->spans[de->src - 1].val = lastend;
+    else if(s->noname_end < 0) s->noname_end = lastend;
+    s->size = off;
+    s->nlend = nl;
+    return 0;
+nomem:
+    fclose(in);
+    dictionary_track(d, NULL);
+    last_error = INIPARSER_NO_MEM;
+    return -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file keeping positions of its items
+  @param    ininame Name of the ini file to read.
+  @return   Pointer to newly allocated dictionary
+
+  The same as iniparser_load(), but dictionary remembers where each key,
+  value and section is in file and which keys were changed after loading,
+  so it could be saved by iniparser_save_incremental().
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * iniparser_load_tracked(const char * ininame)
+{
+    dictionary *d = iniparser_load(ininame);
+    if(d && iniparser_track(d, ininame)){
+        dictionary_del(d);
+        return NULL;
+    }
+    return d;
+}
+
+/** Prefix of names of cached snapshots of file `path`: "<hash of path>-" */
+static void inicache_prefix(const char * path, char * prefix, size_t size)
+{
+    snprintf(prefix, size, "%08x-", (unsigned)dictionary_hash_n(path, strlen(path)));
+}
+
+/** Name of cached snapshot: prefix, identity of file and versions of library and format */
+static char * inicache_name(const char * cachedir, const char * prefix, const struct stat * st)
+{
+    char id[128], *name;
+    size_t l;
+    snprintf(id, sizeof(id), "%llx-%llx-%llx-%lld.%09ld-%s.%d.snap",
+             (unsigned long long)st->st_dev, (unsigned long long)st->st_ino,
+             (unsigned long long)st->st_size, (long long)st->st_mtim.tv_sec,
+             (long)st->st_mtim.tv_nsec, INIPARSER_VERSION, DICTSNAP_VERSION);
+    l = strlen(cachedir) + strlen(prefix) + strlen(id) + 2;
+    if(!(name = malloc(l))) return NULL;
+    snprintf(name, l, "%s/%s%s", cachedir, prefix, id);
+    return name;
+}
+
+/** Remove other snapshots of the same file from cache (they are of older versions of file) */
+static void inicache_purge(const char * cachedir, const char * prefix, const char * name)
+{
+    const char *base = strrchr(name, '/') + 1;
+    size_t plen = strlen(prefix), l;
+    struct dirent *e;
+    DIR *dir = opendir(cachedir);
+    if(!dir) return;
+    while((e = readdir(dir))){
+        l = strlen(e->d_name);
+        // temporary files of other writers don't end with ".snap"
+        if(strncmp(e->d_name, prefix, plen) || l < 5 || strcmp(e->d_name + l - 5, ".snap")
+           || !strcmp(e->d_name, base)) continue;
+        unlinkat(dirfd(dir), e->d_name, 0);
+    }
+    closedir(dir);
+}
+
+/** ==1 if file wasn't changed */
+static int inicache_same(const struct stat * a, const struct stat * b)
+{
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size
+        && a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+/** Open snapshot from cache and check its checksum, broken snapshot is removed (NULL if there's no valid one) */
+static const dictsnap * inicache_open(const char * name)
+{
+    const dictsnap *s;
+    int fd = open(name, O_RDONLY);
+    if(fd < 0) return NULL;
+    s = dictsnap_attach(fd);
+    close(fd);
+    if(s && !dictsnap_verify(s)) return s;
+    dictsnap_close(s);
+    unlink(name); // truncated or damaged: file will be parsed and cached again
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load ini file using cache of its binary snapshots
+  @param    ininame     Name of the ini file to read.
+  @param    cachedir    Directory of cache (should exist).
+  @return   snapshot of file (free it by iniparser_snapshot_close()) or NULL
+
+  Snapshot is searched in cache by name made of real path, device, inode,
+  size and mtime of file and versions of library and snapshot format. If
+  it is found and its checksum is right, it is mapped without parsing
+  (broken snapshot is removed from cache). Otherwise file is parsed and
+  its snapshot is written into cache (temporary file renamed, so several
+  processes could populate cache at once: each of them renames complete
+  snapshot), older snapshots of the same file are removed. If cache can't
+  be written or file was changed while parsing, snapshot is built in
+  memory.
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * iniparser_load_cached(const char * ininame, const char * cachedir)
+{
+    struct stat st, st2;
+    const dictsnap *s = NULL;
+    char *real, *name = NULL, prefix[16];
+    dictionary *d;
+
+    if(ininame==NULL || cachedir==NULL){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    if(stat(ininame, &st)){
+        last_error = INIPARSER_CANT_OPEN;
+        return NULL;
+    }
+    real = realpath(ininame, NULL);
+    inicache_prefix(real ? real : ininame, prefix, sizeof(prefix));
+    free(real);
+    name = inicache_name(cachedir, prefix, &st);
+    if(name && (s = inicache_open(name))){
+        last_error = INIPARSER_NO_ERROR;
+        free(name);
+        return s;
+    }
+    if(!(d = iniparser_load(ininame))){ // last_error is set
+        free(name);
+        return NULL;
+    }
+    if(name && !stat(ininame, &st2) && inicache_same(&st, &st2) && !dictsnap_write(d, name)){
+        inicache_purge(cachedir, prefix, name);
+        s = dictsnap_open(name);
+    }
+    if(!s) s = dictsnap_new(d);
+    iniparser_freedict(d);
+    free(name);
+    last_error = s ? INIPARSER_NO_ERROR : INIPARSER_NO_MEM;
+    return s;
+}
+
+/** Change of ini file */
+typedef struct {
+    off_t       off ;   /** Offset of text replaced */
+    size_t      len ;   /** Length of text replaced (0 for insertion) */
+    char     *  text ;  /** New text */
+    size_t      tlen ;  /** Length of `text` */
+    size_t      seq ;   /** Number of edit: insertions at the same offset keep their order */
+    keyval   *  kv ;    /** Key written (to restore KV_DIRTY if saving fails) */
+    dictentry * de ;    /** New section written */
+    off_t       noff ;  /** Offset of `text` in file edited */
+    off_t       shift ; /** Change of file size by this and previous edits */
+} iniedit;
+
+/** List of changes of ini file */
+typedef struct {
+    iniedit  *  e ;
+    size_t      n ;
+    size_t      len ;
+    int         eofnl ; /** ==1 if newline should be added before text inserted at end of file */
+    int         nlend ; /** ==1 if file ends with newline after edits */
+    dictsrc  *  s ;
+} ininedits;
+
+static int iniedit_cmp(const void * a, const void * b)
+{
+    const iniedit *x = a, *y = b;
+    if(x->off != y->off) return (x->off < y->off) ? -1 : 1;
+    if(!x->de != !y->de) return x->de ? 1 : -1; // new sections after keys of last section
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/** Add edit to list, takes `text` (which is freed if no memory) */
+static int iniedit_add(ininedits * l, off_t off, size_t len, char * text, size_t tlen)
+{
+    iniedit *e;
+    if(!text) return -1;
+    if(l->n == l->len){
+        size_t nl = l->len ? 2 * l->len : 64;
+        if(!(e = realloc(l->e, nl * sizeof(iniedit)))){
+            free(text);
+            return -1;
+        }
+        l->e = e;
+        l->len = nl;
+    }
+    e = &l->e[l->n];
+    e->off = off;
+    e->len = len;
+    e->text = text;
+    e->tlen = tlen;
+    e->seq = l->n++;
+    e->kv = NULL;
+    e->de = NULL;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Quote needed for value to be read back by parser
+  @param    val     Value.
+  @param    vlen    Length of value.
+  @return   quote symbol, 0 if value isn't quoted or -1 if it can't be written
+
+  Value is quoted if it has comment symbols, quotes or spaces at ends, or
+  backslash at end (it joins the next line). Quoted value can't contain
+  its quote symbol, newline can't be in any value.
+ */
+/*--------------------------------------------------------------------------*/
+static int ini_quote(const char * val, size_t vlen)
+{
+    size_t i;
+    int dq = 0, sq = 0, q = 0;
+    if(!vlen) return 0;
+    if(*val == '"' || *val == '\'' || isspace((unsigned char)*val) || isspace((unsigned char)val[vlen - 1])
+        || val[vlen - 1] == '\\')
+        q = 1;
+    for(i = 0; i < vlen; ++i){
+        if(val[i] == ';' || val[i] == '#') q = 1;
+        else if(val[i] == '"') dq = 1;
+        else if(val[i] == '\'') sq = 1;
+        else if(val[i] == '\n' || !val[i]) return -1;
+    }
+    if(!q) return 0;
+    if(dq && sq) return -1;
+    return dq ? '\'' : '"';
+}
 
-  This is the parser for ini files. This function is called, providing
-  the name of the file to be read. It returns a dictionary object that
-  should not be accessed directly, but through accessor functions
-  instead.
+/** Put value (quoted if needed) into `p` or only count its length if `p` is NULL */
+static size_t ini_putvalue(char * p, const char * val, size_t vlen)
+{
+    int q = ini_quote(val, vlen);
+    if(q < 0) q = 0; // checked by ini_checkline()
+    if(p){
+        if(q) p[0] = p[vlen + 1] = (char)q;
+        memcpy(p + (q ? 1 : 0), val, vlen);
+    }
+    return vlen + (q ? 2 : 0);
+}
 
-  The returned dictionary must be freed using iniparser_freedict().
+/** Put line "key = value" in format of iniparser_dump() (with newline if `nl` is 1) into `p` or count its length */
+static size_t ini_putline(char * p, const char * key, size_t klen, const char * val, size_t vlen, int nl)
+{
+    size_t kl = (klen > 30) ? klen : 30, l;
+    if(p){
+        memcpy(p, key, klen);
+        memset(p + klen, ' ', kl - klen);
+        memcpy(p + kl, " = ", 3);
+    }
+    l = kl + 3 + ini_putvalue(p ? p + kl + 3 : NULL, val, vlen);
+    if(nl && p) p[l] = '\n';
+    return l + (nl ? 1 : 0);
+}
+
+/** Check that parser reads line of key back (0) or not (-1, last_error is set) */
+static int ini_checkline(const char * key, size_t klen, const char * val, size_t vlen)
+{
+    size_t i;
+    int bad = !klen || ini_quote(val, vlen) < 0 || ini_putline(NULL, key, klen, val, vlen, 1) >= ASCIILINESZ;
+    if(!bad) bad = (*key == '[' || *key == ';' || *key == '#' || isspace((unsigned char)*key)
+                    || isspace((unsigned char)key[klen - 1]));
+    for(i = 0; i < klen && !bad; ++i)
+        if(key[i] == '=' || key[i] == ':' || key[i] == '\n' || !key[i]) bad = 1;
+    if(!bad) return 0;
+    last_error = INIPARSER_BAD_VALUE;
+    snprintf(last_errmsg, ASCIILINESZ, "key \"%.*s\" or its value can't be written into ini file",
+             (int)(klen > 64 ? 64 : klen), key);
+    return -1;
+}
+
+/** Check that parser reads section header back (0) or not (-1, last_error is set) */
+static int ini_checksection(const char * name, size_t len)
+{
+    size_t i;
+    int bad = !len || len + 3 >= ASCIILINESZ || isspace((unsigned char)*name) || isspace((unsigned char)name[len - 1]);
+    for(i = 0; i < len && !bad; ++i)
+        if(name[i] == ']' || name[i] == ':' || name[i] == '\n' || !name[i]) bad = 1;
+    if(!bad) return 0;
+    last_error = INIPARSER_BAD_VALUE;
+    snprintf(last_errmsg, ASCIILINESZ, "section \"%.*s\" can't be written into ini file",
+             (int)(len > 64 ? 64 : len), name);
+    return -1;
+}
+
+/** The same as ini_putline() for key of dictionary */
+static size_t ini_putkv(char * p, const keyval * kv, int nl)
+{
+    return ini_putline(p, kv->key, kv->klen, kv->val, kv->vlen, nl);
+}
+
+/** Text of value or line of key for edit (`whole` as in dictspan) */
+static char * ini_kvtext(const keyval * kv, int whole, int nl, size_t * len)
+{
+    char *t;
+    *len = whole ? ini_putkv(NULL, kv, nl) : ini_putvalue(NULL, kv->val, kv->vlen);
+    if(!(t = malloc(*len + 1))) return NULL;
+    if(whole) ini_putkv(t, kv, nl);
+    else ini_putvalue(t, kv->val, kv->vlen);
+    t[*len] = 0;
+    return t;
+}
+
+/** Text inserted at offset `off`: newline is added at end of file without newline before first insertion there */
+static int iniedit_insert(ininedits * l, off_t off, char * text, size_t tlen)
+{
+    if(text && off == l->s->size && l->eofnl){
+        char *nl = malloc(2);
+        if(nl) memcpy(nl, "\n", 2);
+        if(iniedit_add(l, off, 0, nl, 1)){
+            free(text);
+            return -1;
+        }
+        l->eofnl = 0;
+    }
+    return iniedit_add(l, off, 0, text, tlen);
+}
+
+/** Flags of key could be changed by readers filling cache of values */
+#define KV_SETDIRTY(kv, on) do{ if(on) __atomic_or_fetch(&(kv)->vtype, KV_DIRTY, __ATOMIC_RELAXED); \
+    else __atomic_and_fetch(&(kv)->vtype, ~KV_DIRTY, __ATOMIC_RELAXED); }while(0)
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Make edit of file for key changed or added
+  @param    l   List of edits.
+  @param    de  Section of key (unnamed one for keys outside of sections).
+  @param    kv  Key changed (marked by KV_DIRTY).
+  @param    nonamed ==1 if `de` is unnamed section.
+  @return   0 if Ok, -1 if no memory, -2 if key can't be read back (last_error is set)
+
+  Value of key found in file is replaced, new key is inserted after last
+  key of its section. New section is written at end of file with all its
+  keys at once. KV_DIRTY is cleared, so key is written once.
  */
 /*--------------------------------------------------------------------------*/
-dictionary * iniparser_load(const char * ininame)
+static int iniedit_key(ininedits * l, dictentry * de, keyval * kv, int nonamed)
 {
-    FILE * in ;
+    dictsrc *s = l->s;
+    size_t tlen, i, n;
+    char *t, *p;
+    if(!(kv->vtype & KV_DIRTY)) return 0; // already written
+    if(ini_checkline(kv->key, kv->klen, kv->val, kv->vlen)) return -2;
+    if(kv->src){
+        dictspan *sp = &s->spans[kv->src - 1];
+        t = ini_kvtext(kv, sp->whole, 0, &tlen);
+        if(iniedit_add(l, sp->val, sp->vlen, t, tlen)) return -1;
+    }else if(nonamed || de->src){
+        off_t off = nonamed ? s->noname_end : s->spans[de->src - 1].val;
+        t = ini_kvtext(kv, 1, 1, &tlen);
+        if(iniedit_insert(l, off, t, tlen)) return -1;
+    }else{ // new section: header and all its keys
+        if(ini_checksection(de->name, de->nlen)) return -2;
+        n = de->nlen + 4;
+        for(i = 0; i < de->n; ++i){
+            keyval *k = &de->kvlist[i];
+            if(!k->key) continue;
+            if(ini_checkline(k->key, k->klen, k->val, k->vlen)) return -2;
+            n += ini_putkv(NULL, k, 1);
+        }
+        if(!(t = p = malloc(n + 1))) return -1;
+        *p++ = '\n';
+        *p++ = '[';
+        memcpy(p, de->name, de->nlen);
+        p += de->nlen;
+        *p++ = ']';
+        *p++ = '\n';
+        for(i = 0; i < de->n; ++i)
+            if(de->kvlist[i].key) p += ini_putkv(p, &de->kvlist[i], 1);
+        *p = 0;
+        if(iniedit_insert(l, s->size, t, n)) return -1;
+        l->e[l->n - 1].de = de;
+        for(i = 0; i < de->n; ++i)
+            if(de->kvlist[i].key) KV_SETDIRTY(&de->kvlist[i], 0);
+        return 0;
+    }
+    l->e[l->n - 1].kv = kv;
+    KV_SETDIRTY(kv, 0);
+    return 0;
+}
 
-    char line    [ASCIILINESZ+1] ;
-    char section [ASCIILINESZ+1] ;
-    char key     [ASCIILINESZ+1] ;
-    char tmp     [(ASCIILINESZ * 2) + 1] ;
-    char val     [ASCIILINESZ+1] ;
+/** Make edit of file removing key line or whole section */
+static int iniedit_remove(ininedits * l, const dictspan * sp)
+{
+    char *t = calloc(1, 1); // empty text
+    if(sp->section) return iniedit_add(l, sp->line, (size_t)(sp->val - sp->line), t, 0);
+    return iniedit_add(l, sp->line, sp->llen, t, 0);
+}
 
-    int  last=0 ;
-    int  len ;
-    int  lineno=0 ;
-    int  errs=0;
-    int  mem_err=0;
+/** Write all `len` bytes of `buf` at offset `off` of file, returns 0 if Ok */
+static int ini_pwrite(int fd, const char * buf, size_t len, off_t off)
+{
+    ssize_t w;
+    while(len){
+        if((w = pwrite(fd, buf, len, off)) < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        len -= (size_t)w;
+        off += w;
+    }
+    return 0;
+}
 
-    dictionary * dict ;
+/** Read `len` bytes at offset `off` of file, returns 0 if Ok */
+static int ini_pread(int fd, char * buf, size_t len, off_t off)
+{
+    ssize_t r;
+    while(len){
+        if((r = pread(fd, buf, len, off)) <= 0){
+            if(r < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        buf += r;
+        len -= (size_t)r;
+        off += r;
+    }
+    return 0;
+}
 
-    if ((in=fopen(ininame, "r"))==NULL) {
-        last_error = INIPARSER_CANT_OPEN;
-        return NULL ;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Apply edits to file
+  @param    l   List of edits sorted by offset.
+  @param    fd  File opened for reading and writing.
+  @param    inplace ==1 if all edits replace not shorter text.
+  @return   0 if Ok, -1 otherwise
+
+  In place edits are padded with spaces (which are skipped by parser after
+  values), so only changed values are written. Otherwise tail of file from
+  first edit is read, edited in memory and written back.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniedit_apply(ininedits * l, int fd, int inplace)
+{
+    off_t first = l->e[0].off, cur;
+    size_t i, tlen = (size_t)(l->s->size - first), nlen = tlen;
+    char *tail, *out, *p;
+    int ret = -1;
+    if(inplace){
+        for(i = 0; i < l->n; ++i){
+            iniedit *e = &l->e[i];
+            if(e->tlen < e->len){
+                if(!(p = realloc(e->text, e->len))) return -1;
+                memset(p + e->tlen, ' ', e->len - e->tlen);
+                e->text = p;
+                e->tlen = e->len;
+            }
+            if(ini_pwrite(fd, e->text, e->tlen, e->off)) return -1;
+        }
+        return 0;
     }
+    for(i = 0; i < l->n; ++i) nlen += l->e[i].tlen - l->e[i].len;
+    tail = malloc(tlen + 1);
+    out = malloc(nlen + 1);
+    if(!tail || !out) goto ret;
+    if(ini_pread(fd, tail, tlen, first)) goto ret;
+    for(i = 0, p = out, cur = first; i < l->n; ++i){
+        iniedit *e = &l->e[i];
+        memcpy(p, tail + (cur - first), (size_t)(e->off - cur));
+        p += e->off - cur;
+        memcpy(p, e->text, e->tlen);
+        p += e->tlen;
+        cur = e->off + (off_t)e->len;
+    }
+    memcpy(p, tail + (cur - first), (size_t)(l->s->size - cur));
+    if(ini_pwrite(fd, out, nlen, first) || ftruncate(fd, first + (off_t)nlen)) goto ret;
+    l->nlend = nlen ? (out[nlen - 1] == '\n') : 1; // else the first edit removed lines up to end
+    ret = 0;
+ret:
+    free(tail);
+    free(out);
+    return ret;
+}
 
-    dict = dictionary_new(0) ;
-    if (!dict) {
-        fclose(in);
-        last_error = INIPARSER_NO_MEM;
-        return NULL ;
+/** Change of offset `off` of file by edits before it (edits are sorted and don't overlap) */
+static off_t iniedit_shift(const ininedits * l, off_t off)
+{
+    size_t lo = 0, hi = l->n;
+    while(lo < hi){ // number of edits ending not after `off`
+        size_t mid = (lo + hi) / 2;
+        if(l->e[mid].off + (off_t)l->e[mid].len <= off) lo = mid + 1;
+        else hi = mid;
     }
+    while(lo && l->e[lo - 1].de) --lo; // new sections are after end of file (and of last section)
+    return lo ? l->e[lo - 1].shift : 0;
+}
 
-    memset(line,    0, ASCIILINESZ);
-    memset(section, 0, ASCIILINESZ);
-    memset(key,     0, ASCIILINESZ);
-    memset(val,     0, ASCIILINESZ);
-    last=0 ;
+/** Span of line "key = value\n" written at `off` (value replaced with whole line) */
+static size_t iniedit_addspan(dictsrc * s, off_t off, size_t llen)
+{
+    dictspan sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.line = sp.val = off;
+    sp.llen = llen;
+    sp.vlen = llen - 1;
+    sp.whole = 1;
+    return dictsrc_addspan(s, &sp);
+}
 
-    while (fgets(line+last, ASCIILINESZ-last, in)!=NULL) {
-        lineno++ ;
-        len = (int)strlen(line)-1;
-        if (len<=0)
-            continue;
-        /* Safety check against buffer overflows */
-        if (line[len]!='\n' && !feof(in)) {
-            last_error = INIPARSER_TOO_LONG;
-            snprintf(last_errmsg, ASCIILINESZ,
-              "input line too long in %s (%d)",
-              ininame,
-              lineno);
-            dictionary_del(dict);
-            fclose(in);
-            return NULL ;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Move positions of items after edits were written
+  @param    l   List of edits applied (sorted by offset).
+  @return   0 if Ok, -1 if no memory
+
+  Each position is moved by size change of edits before it, values
+  replaced get their new length, keys and sections inserted get new spans,
+  so file isn't read again after saving. Spans removed aren't used by any
+  item now.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniedit_moved(ininedits * l)
+{
+    dictsrc *s = l->s;
+    size_t i, j;
+    off_t shift = 0, off;
+    for(i = 0; i < l->n; ++i){
+        iniedit *e = &l->e[i];
+        e->noff = e->off + shift;
+        shift += (off_t)e->tlen - (off_t)e->len;
+        e->shift = shift;
+    }
+    for(i = 0; i < s->nspans; ++i){
+        dictspan *sp = &s->spans[i];
+        sp->removed = 0;
+        sp->line += iniedit_shift(l, sp->line);
+        sp->val += iniedit_shift(l, sp->val);
+    }
+    if(s->noname_end > -1) s->noname_end += iniedit_shift(l, s->noname_end);
+    s->size += shift;
+    s->nlend = l->nlend;
+    for(i = 0; i < l->n; ++i){
+        iniedit *e = &l->e[i];
+        keyval *kv = e->kv;
+        dictentry *de = e->de;
+        if(kv && kv->src){ // value replaced
+            dictspan *sp = &s->spans[kv->src - 1];
+            sp->val = e->noff;
+            sp->vlen = e->tlen;
+            sp->llen += e->tlen - e->len;
+        }else if(kv){ // line inserted
+            if(!(kv->src = iniedit_addspan(s, e->noff, e->tlen))) return -1;
+        }else if(de){ // "\n[name]\n" and keys
+            dictspan sp;
+            memset(&sp, 0, sizeof(sp));
+            sp.line = e->noff + 1;
+            sp.llen = de->nlen + 3;
+            sp.val = e->noff + (off_t)e->tlen;
+            sp.section = 1;
+            if(!(de->src = dictsrc_addspan(s, &sp))) return -1;
+            off = sp.line + (off_t)sp.llen;
+            for(j = 0; j < de->n; ++j){
+                if(!(kv = &de->kvlist[j])->key) continue;
+                if(!(kv->src = iniedit_addspan(s, off, ini_putkv(NULL, kv, 1)))) return -1;
+                off += (off_t)ini_putkv(NULL, kv, 1);
+            }
         }
-        /* Get rid of \n and spaces at end of line */
-        while ((len>=0) &&
-                ((line[len]=='\n') || (isspace(line[len])))) {
-            line[len]=0 ;
-            len-- ;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Save changes of dictionary into its ini file
+  @param    d   Dictionary loaded by iniparser_load_tracked().
+  @return   0 if Ok, -1 otherwise (see get_error())
+
+  Only spans of changed items are rewritten:
+  - new value replaces old one; if it isn't longer, file is changed in place;
+  - new keys are inserted after last key of their section, new sections are
+    appended to end of file;
+  - lines of keys deleted and whole sections deleted are removed.
+  If something should be inserted or removed, file is rewritten from the
+  first change. Comments and formatting of other lines are kept.
+
+  File shouldn't be changed by others after loading (its size is checked).
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_save_incremental(dictionary * d)
+{
+    ininedits l;
+    dictsrc *s;
+    dictentry *de;
+    struct stat st;
+    size_t i, j;
+    off_t end;
+    int fd, inplace = 1, ret = -1, r;
+
+    if(!d || !(s = d->src)){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    memset(&l, 0, sizeof(l));
+    l.s = s;
+    l.eofnl = (s->size && !s->nlend);
+    if(!s->lost){
+        for(i = 0; i < s->nchanges; ++i){
+            dictchange *c = &s->changes[i];
+            if(c->span) continue;
+            de = (c->sec == DICT_NOPOS) ? d->noname : d->entries[c->sec];
+            if(!de->kvlist || c->pos >= de->n || !de->kvlist[c->pos].key) continue; // deleted
+            if((r = iniedit_key(&l, de, &de->kvlist[c->pos], c->sec == DICT_NOPOS)) < -1) goto bad;
+            else if(r) goto nomem;
         }
-        if (len < 0) { /* Line was entirely \n and/or spaces */
-            len = 0;
+        for(i = 0; i < s->nchanges; ++i)
+            if(s->changes[i].span && iniedit_remove(&l, &s->spans[s->changes[i].span - 1])) goto nomem;
+    }else{ // check all
+        for(i = 0; i <= d->n; ++i){
+            de = (i == d->n) ? d->noname : d->entries[i];
+            for(j = 0; j < de->n; ++j){
+                if(!de->kvlist[j].key) continue;
+                if((r = iniedit_key(&l, de, &de->kvlist[j], i == d->n)) < -1) goto bad;
+                else if(r) goto nomem;
+            }
         }
-        /* Detect multi-line */
-        if (line[len]=='\\') {
-            /* Multi-line value */
-            last=len ;
-            continue ;
-        } else {
-            last=0 ;
+        for(i = 0; i < s->nspans; ++i)
+            if(s->spans[i].removed && iniedit_remove(&l, &s->spans[i])) goto nomem;
+    }
+    if(!l.n){
+        dictsrc_clean(d);
+        return 0;
+    }
+    qsort(l.e, l.n, sizeof(iniedit), iniedit_cmp);
+    for(i = j = 0, end = 0; i < l.n; ++i){
+        iniedit *e = &l.e[i];
+        if(j && e->off < end){ // inside of section removed
+            free(e->text);
+            continue;
         }
-        switch (iniparser_line(line, section, key, val)) {
-            case LINE_EMPTY:
-            case LINE_COMMENT:
-            case LINE_SECTION:
-            break ;
+        if(!e->kv || e->tlen > e->len) inplace = 0;
+        end = e->off + (off_t)e->len;
+        l.e[j++] = *e;
+    }
+    l.n = j;
+    if((fd = open(s->file, O_RDWR)) < 0){
+        last_error = INIPARSER_CANT_OPEN;
+        goto bad;
+    }
+    if(fstat(fd, &st) || st.st_size != s->size){
+        close(fd);
+        last_error = INIPARSER_CHANGED;
+        snprintf(last_errmsg, ASCIILINESZ, "file %s was changed after loading", s->file);
+        goto bad;
+    }
+    if(iniedit_apply(&l, fd, inplace) | close(fd)){
+        last_error = INIPARSER_CANT_OPEN;
+        snprintf(last_errmsg, ASCIILINESZ, "can't write %s", s->file);
+        goto bad;
+    }
+    if(!inplace && iniedit_moved(&l) && iniparser_track(d, s->file)) goto ret; // no memory: find positions again
+    dictsrc_clean(d);
+    ret = 0;
+    goto ret;
+nomem:
+    last_error = INIPARSER_NO_MEM;
+bad: // keys wasn't saved: mark them again
+    for(i = 0; i < l.n; ++i){
+        if(l.e[i].kv) KV_SETDIRTY(l.e[i].kv, 1);
+        if((de = l.e[i].de)) for(j = 0; j < de->n; ++j)
+            if(de->kvlist[j].key) KV_SETDIRTY(&de->kvlist[j], 1);
+    }
+ret:
+    for(i = 0; i < l.n; ++i) free(l.e[i].text);
+    free(l.e);
+    return ret;
+}
 
-            case LINE_VALUE:
-            if(!section || !*section) // unnamed section
-                sprintf(tmp, "%s", key);
-            else
-                sprintf(tmp, "%s:%s", section, key);
-            mem_err = dictionary_set(dict, tmp, val);
-            break ;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Open streaming writer of ini file
+  @param    ininame Name of file to write (created or truncated).
+  @return   writer or NULL in case of error (see get_error())
+
+  Writer emits the same format as iniparser_dump() without building a
+  dictionary: keys written before first section are unnamed ones. Values
+  with comment symbols, quotes, spaces at ends or backslash at end are
+  quoted, so file is read back by iniparser_load() with the same values;
+  keys and sections which can't be read back aren't written (-1 is
+  returned with INIPARSER_BAD_VALUE). Output is collected
+  in buffer of INIWRITER_BUFSZ bytes, so memory used doesn't depend on size
+  of file.
+ */
+/*--------------------------------------------------------------------------*/
+iniwriter * iniwriter_open(const char * ininame)
+{
+    iniwriter *w;
+    int fd;
+    if(!ininame){
+        last_error = INIPARSER_NO_OBJECT;
+        return NULL;
+    }
+    if((fd = open(ininame, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0){
+        last_error = INIPARSER_CANT_OPEN;
+        snprintf(last_errmsg, ASCIILINESZ, "can't open %s", ininame);
+        return NULL;
+    }
+    if(!(w = iniwriter_open_fd(fd))){
+        close(fd);
+        return NULL;
+    }
+    w->own = 1;
+    return w;
+}
 
-            case LINE_ERROR:
-            last_error = INIPARSER_SYNTAX_ERR;
-            snprintf(last_errmsg, ASCIILINESZ,
-              "syntax error in %s (%d):\n-> %s",
-              ininame,
-              lineno,
-              line);
-            errs++ ;
-            break;
+/** Open streaming writer into descriptor `fd` (it isn't closed by iniwriter_close()) */
+iniwriter * iniwriter_open_fd(int fd)
+{
+    iniwriter *w = calloc(1, sizeof(iniwriter));
+    if(w && !(w->buf = malloc(INIWRITER_BUFSZ))){
+        free(w);
+        w = NULL;
+    }
+    if(!w){
+        last_error = INIPARSER_NO_MEM;
+        return NULL;
+    }
+    w->size = INIWRITER_BUFSZ;
+    w->fd = fd;
+    return w;
+}
 
-            default:
-            break ;
-        }
-        memset(line, 0, ASCIILINESZ);
-        last=0;
-        if (mem_err < 0) {
-            last_error = INIPARSER_NO_MEM;
-            snprintf(last_errmsg, ASCIILINESZ,("memory allocation failure"));
-            break ;
+/** Write `len` bytes of `buf` into output of writer, returns 0 if Ok */
+static int iniwriter_write(iniwriter * w, const char * buf, size_t len)
+{
+    ssize_t r;
+    while(len && !w->err){
+        if((r = write(w->fd, buf, len)) < 0){
+            if(errno == EINTR) continue;
+            w->err = 1;
+            last_error = INIPARSER_CANT_OPEN;
+            snprintf(last_errmsg, ASCIILINESZ, "write error: %s", strerror(errno));
+        }else{
+            buf += r;
+            len -= (size_t)r;
         }
     }
-    if (errs) {
-        dictionary_del(dict);
-        dict = NULL ;
+    return w->err ? -1 : 0;
+}
+
+/** Write content of writer buffer, returns 0 if Ok */
+static int iniwriter_flush(iniwriter * w)
+{
+    int ret = iniwriter_write(w, w->buf, w->len);
+    w->len = 0;
+    return ret;
+}
+
+/** Get place for `len` bytes in writer buffer (NULL if line is larger than buffer) */
+static char * iniwriter_reserve(iniwriter * w, size_t len)
+{
+    char *p;
+    if(w->size - w->len < len && iniwriter_flush(w)) return NULL;
+    if(w->size < len) return NULL;
+    p = w->buf + w->len;
+    w->len += len;
+    return p;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start new section of ini file
+  @param    w       Writer.
+  @param    name    Name of section.
+  @return   0 if Ok, -1 otherwise
+
+  All keys written after this call and before next section belong to it.
+ */
+/*--------------------------------------------------------------------------*/
+int iniwriter_section(iniwriter * w, const char * name)
+{
+    size_t len;
+    char *p;
+    if(!w || !name){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
     }
-    fclose(in);
-    return dict ;
+    len = strlen(name);
+    if(w->err || ini_checksection(name, len)) return -1;
+    if(!(p = iniwriter_reserve(w, len + 4))) return -1;
+    p[0] = '\n';
+    p[1] = '[';
+    memcpy(p + 2, name, len);
+    p[len + 2] = ']';
+    p[len + 3] = '\n';
+    return 0;
+}
+
+/** Write key `key` with value `val` (NULL means empty) into current section of ini file */
+int iniwriter_kv(iniwriter * w, const char * key, const char * val)
+{
+    if(!key){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    return iniwriter_kv_n(w, key, strlen(key), val, val ? strlen(val) : 0);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Write key of ini file
+  @param    w       Writer.
+  @param    key     Key name (not necessary zero-terminated).
+  @param    klen    Length of `key`.
+  @param    val     Value (not necessary zero-terminated, NULL means empty).
+  @param    vlen    Length of `val`.
+  @return   0 if Ok, -1 otherwise
+
+  Line is formatted right in buffer of writer. Key which parser can't read
+  back isn't written (see iniwriter_open()).
+ */
+/*--------------------------------------------------------------------------*/
+int iniwriter_kv_n(iniwriter * w, const char * key, size_t klen, const char * val, size_t vlen)
+{
+    size_t len;
+    char *p;
+    if(!w || !key){
+        last_error = INIPARSER_NO_OBJECT;
+        return -1;
+    }
+    if(w->err) return -1;
+    if(!val){
+        val = "";
+        vlen = 0;
+    }
+    if(ini_checkline(key, klen, val, vlen)) return -1;
+    len = ini_putline(NULL, key, klen, val, vlen, 1); // less than ASCIILINESZ
+    if(!(p = iniwriter_reserve(w, len))) return -1;
+    ini_putline(p, key, klen, val, vlen, 1);
+    return 0;
+}
+
+/** Flush buffer and close writer, returns 0 if all data was written */
+int iniwriter_close(iniwriter * w)
+{
+    int ret;
+    if(!w) return -1;
+    ret = iniwriter_flush(w);
+    if(w->own && close(w->fd) && !ret){
+        last_error = INIPARSER_CANT_OPEN;
+        ret = -1;
+    }
+    free(w->buf);
+    free(w);
+    return ret;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -639,7 +2711,7 @@ void iniparser_sort(dictionary *d){
     dictionary_sort(d);
 }
 
-/** Last error code & last message */
+/** Last error code & last message (of calling thread) */
 iniparser_err_t get_error(){
     return last_error;
 }
@@ -647,3 +2719,59 @@ iniparser_err_t get_error(){
 char *get_errmsg(){
     return last_errmsg;
 }
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters returning status
+  @param    d           Dictionary to search
+  @param    key         Key string to look for
+  @param    notfound    Value to return in case of error
+  @param    err         If not NULL, status code
+  @return   value found or `notfound`
+
+  The same as iniparser_get*(), but status is stored in `err`: no global or
+  thread-local state is changed.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_getstring_ex(const dictionary * d, const char * key, const char * def, iniparser_err_t * err)
+{
+    const keyval * kv ;
+    iniparser_err_t e = iniparser_findkv(d, key, &kv);
+    if(err) *err = e;
+    return kv ? kv->val : def;
+}
+
+long int iniparser_getlongint_ex(const dictionary * d, const char * key, long int notfound, iniparser_err_t * err)
+{
+    const keyval * kv ;
+    long int l = notfound;
+    iniparser_err_t e = iniparser_findkv(d, key, &kv);
+    if(kv) e = kv_tolong(kv, &l);
+    if(err) *err = e;
+    return l;
+}
+
+int iniparser_getint_ex(const dictionary * d, const char * key, int notfound, iniparser_err_t * err)
+{
+    return (int)iniparser_getlongint_ex(d, key, notfound, err);
+}
+
+double iniparser_getdouble_ex(const dictionary * d, const char * key, double notfound, iniparser_err_t * err)
+{
+    const keyval * kv ;
+    double x = notfound;
+    iniparser_err_t e = iniparser_findkv(d, key, &kv);
+    if(kv) e = kv_todouble(kv, &x);
+    if(err) *err = e;
+    return x;
+}
+
+int iniparser_getboolean_ex(const dictionary * d, const char * key, int notfound, iniparser_err_t * err)
+{
+    const keyval * kv ;
+    int b = notfound;
+    iniparser_err_t e = iniparser_findkv(d, key, &kv);
+    if(kv) e = kv_tobool(kv, &b);
+    if(err) *err = e;
+    return b;
+}
@@ -14,6 +14,7 @@
                                 Includes
  ---------------------------------------------------------------------------*/
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,11 +27,15 @@
 /* #include <unistd.h> */
 
 #include "dictionary.h"
+#include "dictsnap.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Version of library (part of names of cached snapshots, see iniparser_load_cached()) */
+#define INIPARSER_VERSION   "5.0"
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get number of sections in a dictionary
@@ -85,6 +90,25 @@ const char * iniparser_getsecname(const dictionary * d, int n);
 /*--------------------------------------------------------------------------*/
 void iniparser_dump(const dictionary * d, FILE * f);
 
+/** The same as iniparser_dump() into file descriptor, returns 0 if Ok */
+int iniparser_dump_fd(const dictionary * d, int fd);
+
+/** The same as iniparser_dump_fd() by `nthreads` threads (see dictionary_dump_parallel()) */
+int iniparser_dump_parallel(const dictionary * d, int fd, int nthreads);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Dump a dictionary into newly allocated buffer.
+  @param    d   Dictionary to dump.
+  @param    len If not NULL, filled with length of dump.
+  @return   zero-terminated buffer (free() it after use) or NULL in case of error
+
+  Output is the same as of iniparser_dump(). Size of dump is computed first,
+  so buffer is allocated once.
+ */
+/*--------------------------------------------------------------------------*/
+char * iniparser_dump_to_buffer(const dictionary * d, size_t * len);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the number of keys in a section of a dictionary.
@@ -218,6 +242,310 @@ double iniparser_getdouble(const dictionary * d, const char * key, double notfou
 /*--------------------------------------------------------------------------*/
 int iniparser_getboolean(const dictionary * d, const char * key, int notfound);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters by key of given length
+  @param    d       Dictionary to search
+  @param    key     Key string to look for (not necessary zero-terminated)
+  @param    len     Length of `key`
+  @param    vlen    If not NULL, length of value returned
+
+  Same as iniparser_getstring(), iniparser_getint() etc, but key could be a
+  part of larger buffer (e.g. of network packet): it isn't copied and its
+  end isn't searched. Length of value returned by iniparser_getstring_n()
+  is also known without strlen().
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_getstring_n(const dictionary * d, const char * key, size_t len,
+                                   const char * def, size_t * vlen);
+int iniparser_getint_n(const dictionary * d, const char * key, size_t len, int notfound);
+long int iniparser_getlongint_n(const dictionary * d, const char * key, size_t len, long int notfound);
+double iniparser_getdouble_n(const dictionary * d, const char * key, size_t len, double notfound);
+int iniparser_getboolean_n(const dictionary * d, const char * key, size_t len, int notfound);
+
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get the strings associated to many keys
+  @param    d       Dictionary to search
+  @param    keys    Array of `n` keys ("section:key")
+  @param    n       Number of keys
+  @param    out     Array of `n` values
+  @return   number of keys found
+
+  Same as iniparser_getstring() for each key, but all keys are searched in
+  one pass (see dictionary_get_batch()), which is faster for many keys.
+  Values of keys not found aren't changed: fill `out` with defaults before
+  call. This function don't change last error.
+ */
+/*--------------------------------------------------------------------------*/
+size_t iniparser_get_batch(const dictionary * d, const char ** keys, size_t n, const char ** out);
+
+/** Key resolved for repeated access */
+typedef dictkey iniparser_key_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Resolve a key for repeated access
+  @param    d       Dictionary to search
+  @param    key     Key string to look for ("section:key")
+  @return   resolved key
+
+  The key is searched once; getters iniparser_get*_h() with resolved key
+  access its value directly. Resolved key stays valid while the key exists
+  in dictionary: value changes, additions and deletions of other keys don't
+  affect it. It becomes stale after the key or its section deleted and
+  after sorting of dictionary; getters return `notfound` value and set
+  error INIPARSER_STALE_KEY for stale keys. Resolve key again in this case.
+  If key not found, resolved key is invalid (INIPARSER_NOT_FOUND).
+ */
+/*--------------------------------------------------------------------------*/
+iniparser_key_t iniparser_resolve(const dictionary * d, const char * key);
+
+/** Check if resolved key is valid (returns 1) or stale/not found (returns 0) */
+int iniparser_key_valid(const dictionary * d, iniparser_key_t h);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters by resolved key
+  @param    d           Dictionary to search
+  @param    h           Key resolved by iniparser_resolve()
+  @param    notfound    Value to return in case of error
+
+  Same as iniparser_getstring(), iniparser_getint() etc, but key isn't
+  searched: value accessed directly.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_getstring_h(const dictionary * d, iniparser_key_t h, const char * def);
+int iniparser_getint_h(const dictionary * d, iniparser_key_t h, int notfound);
+long int iniparser_getlongint_h(const dictionary * d, iniparser_key_t h, long int notfound);
+double iniparser_getdouble_h(const dictionary * d, iniparser_key_t h, double notfound);
+int iniparser_getboolean_h(const dictionary * d, iniparser_key_t h, int notfound);
+
+/** Section handle (sections are shared with clones and copied when changed, so handle keeps position) */
+typedef struct {
+    const dictionary * d;   /** Dictionary containing section */
+    size_t          pos ;   /** Position of section (DICT_NOPOS for unnamed) */
+    unsigned long   gen ;   /** Generation of dictionary */
+    hash_t          hash ;  /** Hash of section name */
+    int             found ; /** ==1 if section was found */
+} iniparser_sec_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get handle of a section
+  @param    d       Dictionary to search
+  @param    name    Section name (NULL or "" for keys outside of sections)
+  @return   section handle
+
+  Section is searched once, getters iniparser_sec_get*() search keys only
+  inside it, so there's no need to build "section:key" strings. Handle
+  keeps position of section, so it stays valid while the section exists:
+  adding and deleting of other sections and of keys (even if section was
+  copied from clone) don't affect it. It becomes stale after the section
+  deleted and after sorting of dictionary: getters return `notfound` value
+  with INIPARSER_STALE_KEY, get handle again in this case. If section not
+  found, getters return `notfound` value with INIPARSER_NOT_FOUND.
+ */
+/*--------------------------------------------------------------------------*/
+iniparser_sec_t iniparser_section(const dictionary * d, const char * name);
+
+/** Check if section handle is valid (returns 1) or section not found/stale (returns 0) */
+int iniparser_sec_valid(iniparser_sec_t sec);
+
+/** Get number of keys in a section */
+int iniparser_sec_nkeys(iniparser_sec_t sec);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters of keys in a section
+  @param    sec         Section handle
+  @param    key         Key name inside section (without "section:")
+  @param    notfound    Value to return in case of error
+
+  Same as iniparser_getstring(), iniparser_getint() etc, but key is
+  searched only inside given section.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_sec_getstring(iniparser_sec_t sec, const char * key, const char * def);
+int iniparser_sec_getint(iniparser_sec_t sec, const char * key, int notfound);
+long int iniparser_sec_getlongint(iniparser_sec_t sec, const char * key, long int notfound);
+double iniparser_sec_getdouble(iniparser_sec_t sec, const char * key, double notfound);
+int iniparser_sec_getboolean(iniparser_sec_t sec, const char * key, int notfound);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters of keys in overlay of dictionaries
+  @param    o           Overlay: layers from defaults to overrides (see dictoverlay)
+  @param    key         Key string to look for ("section:key")
+  @param    notfound    Value to return in case of error
+
+  Same as iniparser_getstring(), iniparser_getint() etc, but value is taken
+  from the highest layer containing the key. Key is hashed once for all
+  layers, so lookup costs about as much as lookup in one dictionary.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_overlay_getstring(const dictoverlay * o, const char * key, const char * def);
+int iniparser_overlay_getint(const dictoverlay * o, const char * key, int notfound);
+long int iniparser_overlay_getlongint(const dictoverlay * o, const char * key, long int notfound);
+double iniparser_overlay_getdouble(const dictoverlay * o, const char * key, double notfound);
+int iniparser_overlay_getboolean(const dictoverlay * o, const char * key, int notfound);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Binary snapshot of dictionary
+  @param    d           Dictionary to write.
+  @param    path        Snapshot file name.
+  @param    s           Snapshot opened by iniparser_snapshot_open().
+  @param    key         Key string to look for ("section:key")
+  @param    notfound    Value to return in case of error
+
+  Snapshot is written once (iniparser_snapshot_write()) and then opened
+  by mmap() instead of parsing ini file: opening costs O(keys) checks of
+  offsets (broken file isn't opened), keys are searched by hash indexes
+  inside of file. Getters are the same as iniparser_getstring(),
+  iniparser_getint() etc, returned strings live until
+  iniparser_snapshot_close(). Checksum of file is checked only by
+  dictsnap_verify(s).
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_snapshot_write(const dictionary * d, const char * path);
+const dictsnap * iniparser_snapshot_open(const char * path);
+void iniparser_snapshot_close(const dictsnap * s);
+const char * iniparser_snapshot_getstring(const dictsnap * s, const char * key, const char * def);
+int iniparser_snapshot_getint(const dictsnap * s, const char * key, int notfound);
+long int iniparser_snapshot_getlongint(const dictsnap * s, const char * key, long int notfound);
+double iniparser_snapshot_getdouble(const dictsnap * s, const char * key, double notfound);
+int iniparser_snapshot_getboolean(const dictsnap * s, const char * key, int notfound);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Share dictionary with other processes
+  @param    d       Dictionary to share.
+  @param    fd      Descriptor returned by iniparser_share().
+  @return   iniparser_share(): descriptor of shared memory or -1;
+            iniparser_attach(): snapshot or NULL
+
+  Dictionary is written once as snapshot into sealed memfd. Workers which
+  got descriptor (forked after iniparser_share() or received it over unix
+  socket) map it read-only by iniparser_attach() and read keys by
+  iniparser_snapshot_get*(), so configuration exists once in memory.
+  Detach by iniparser_snapshot_close().
+
+  Example of pre-fork server:
+  @code
+    dictionary *d = iniparser_load("server.ini");
+    int fd = iniparser_share(d);
+    iniparser_freedict(d);
+    for(i = 0; i < nworkers; ++i) if(fork() == 0){
+        const dictsnap *cfg = iniparser_attach(fd);
+        port = iniparser_snapshot_getint(cfg, "server:port", 80);
+        ...
+    }
+  @endcode
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_share(const dictionary * d);
+const dictsnap * iniparser_attach(int fd);
+
+/** Order of iteration */
+typedef enum{
+    INIPARSER_ORDER_FILE = DICT_BYPOS   // order of reading (or adding)
+    ,INIPARSER_ORDER_NAME = DICT_BYNAME // sorted by name
+    ,INIPARSER_ORDER_HASH = DICT_BYHASH // sorted by hash
+} iniparser_order_t;
+
+/** Iterator over sections or keys of section */
+typedef struct {
+    dictiter            it ;    /** Cursor */
+    iniparser_sec_t     sec ;   /** Section of keys (section handle of sections) */
+} iniparser_iter_t;
+
+/** Section or key returned by iterator */
+typedef struct {
+    const char      *   name ;  /** Name of section or key (without section) */
+    size_t              nlen ;  /** Length of `name` */
+    const char      *   val ;   /** Value of key (NULL for sections) */
+    size_t              vlen ;  /** Length of `val` */
+    iniparser_sec_t     sec ;   /** Section handle (section found or section of key) */
+} iniparser_item_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Start walking over sections or keys of section
+  @param    d       Dictionary to walk
+  @param    sec     Section to walk over its keys
+  @param    order   Order of items
+  @param    it      Iterator to initialize
+  @return   0 if Ok, -1 in case of error
+
+  Items are got by iniparser_iter_next() with deleted ones skipped. Each
+  section item contains section handle, so its keys can be walked without
+  searching the section. Iterators don't allocate memory (name and hash
+  orders are built once per section and shared with queries) and don't
+  change last error. Don't change dictionary while iterating.
+  Keys outside of sections are walked by iniparser_iter_keys() with
+  iniparser_section(d, NULL).
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_iter_sections(const dictionary * d, iniparser_order_t order, iniparser_iter_t * it);
+int iniparser_iter_keys(iniparser_sec_t sec, iniparser_order_t order, iniparser_iter_t * it);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item of iterator
+  @param    it      Iterator
+  @param    item    Section or key found
+  @return   1 if item found, 0 at end
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_iter_next(iniparser_iter_t * it, iniparser_item_t * item);
+
+/** Query of keys or sections by name */
+typedef dictquery iniparser_query_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find all keys or sections which names start with given prefix
+  @param    d       Dictionary to search
+  @param    prefix  "section:prefix" to search keys in section (":prefix" for
+                    keys outside of sections) or "prefix" to search sections
+  @param    q       Query to initialize
+  @return   0 if Ok, -1 in case of error
+
+  Names are case-insensitive. Items found are got by iniparser_query_next()
+  in name order. Query is backed by name order of items, so it costs
+  O(log n + matches). Don't change dictionary while iterating.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_query_prefix(const dictionary * d, const char * prefix, iniparser_query_t * q);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find all keys or sections which names match glob pattern
+  @param    d       Dictionary to search
+  @param    pattern "section:pattern" to search keys in section or "pattern"
+                    to search sections; wildcards are `*`, `?` and `[...]`
+  @param    q       Query to initialize
+  @return   0 if Ok, -1 in case of error
+
+  Section name in "section:pattern" can't contain wildcards. Only names
+  starting with literal prefix of pattern (before first wildcard) are
+  checked, so patterns like "backend-*" are as quick as prefix queries.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_query_glob(const dictionary * d, const char * pattern, iniparser_query_t * q);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get next item found by query
+  @param    q       Query
+  @param    name    If not NULL, name of key (without section) or section
+  @param    val     If not NULL, value of key (NULL for sections)
+  @return   1 if item found, 0 if there's no more items
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_query_next(iniparser_query_t * q, const char ** name, const char ** val);
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -234,6 +562,9 @@ int iniparser_getboolean(const dictionary * d, const char * key, int notfound);
 /*--------------------------------------------------------------------------*/
 int iniparser_set(dictionary * ini, const char * entry, const char * val);
 
+/** The same as iniparser_set() for entry and value of given length (not necessary zero-terminated) */
+int iniparser_set_n(dictionary * ini, const char * entry, size_t len, const char * val, size_t vlen);
+
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -265,6 +596,124 @@ int iniparser_find_entry(const dictionary * ini, const char * entry) ;
 /*--------------------------------------------------------------------------*/
 dictionary * iniparser_load(const char * ininame);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file again, reusing unchanged sections
+  @param    old     Dictionary of previous version of file (could be NULL).
+  @param    ininame Name of the ini file to read.
+  @return   Pointer to newly allocated dictionary or NULL
+
+  Result is the same as of iniparser_load(), but only sections which text
+  differs from text of sections of `old` are parsed: unchanged sections
+  are shared with `old` (copy-on-write, as by dictionary_clone()). Hashes
+  of texts are kept in result, so pass previous result of
+  iniparser_reload() as `old` (the first reload parses whole file). `old`
+  isn't changed; free both dictionaries by iniparser_freedict().
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * iniparser_reload(const dictionary * old, const char * ininame);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file keeping positions of its items
+  @param    ininame Name of the ini file to read.
+  @return   Pointer to newly allocated dictionary
+
+  The same as iniparser_load(), but dictionary remembers where each key,
+  value and section is in file and which keys were changed after loading,
+  so it could be saved by iniparser_save_incremental().
+ */
+/*--------------------------------------------------------------------------*/
+dictionary * iniparser_load_tracked(const char * ininame);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load ini file using cache of its binary snapshots
+  @param    ininame     Name of the ini file to read.
+  @param    cachedir    Directory of cache (should exist).
+  @return   snapshot of file (free it by iniparser_snapshot_close()) or NULL
+
+  If snapshot of the same version of file (by its path, inode, size and
+  mtime) and library is in cache, it is mapped without parsing after its
+  checksum is checked (broken snapshot is removed). Otherwise file is
+  parsed and its snapshot is put into cache for the next time. Keys are
+  read by iniparser_snapshot_get*().
+ */
+/*--------------------------------------------------------------------------*/
+const dictsnap * iniparser_load_cached(const char * ininame, const char * cachedir);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Save changes of dictionary into its ini file
+  @param    d   Dictionary loaded by iniparser_load_tracked().
+  @return   0 if Ok, -1 otherwise (see get_error())
+
+  Only changed values are rewritten: in place if new value isn't longer
+  than old one. If keys or sections were added or deleted, or value became
+  longer, file is rewritten from the first change. Comments and formatting
+  of other lines are kept. Nothing is written if some key can't be read
+  back from file (see iniwriter_open()).
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_save_incremental(dictionary * d);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Streaming writer of ini file
+
+  Writes ini file key by key without building a dictionary (see
+  iniwriter_open()). Don't change fields directly.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    char     *  buf ;   /** Output buffer */
+    size_t      size ;  /** Size of buffer */
+    size_t      len ;   /** Bytes in buffer */
+    int         fd ;    /** Output descriptor */
+    int         own ;   /** ==1 if descriptor is closed by iniwriter_close() */
+    int         err ;   /** ==1 after output error */
+} iniwriter;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Open streaming writer of ini file
+  @param    ininame Name of file to write (created or truncated).
+  @return   writer or NULL in case of error (see get_error())
+
+  Writer emits the same format as iniparser_dump() without building a
+  dictionary: keys written before first section are unnamed ones. Values
+  which need it are quoted, so iniparser_load() reads the same values.
+  What parser can't read back isn't written (INIPARSER_BAD_VALUE): newline
+  in name or value, '=' or ':' in key, ']' or ':' in section name, value
+  to be quoted with both quote symbols, line longer than 1023 bytes.
+  Memory used doesn't depend on size of file. Example:
+
+  @code
+    iniwriter *w = iniwriter_open("out.ini");
+    iniwriter_kv(w, "version", "5");
+    iniwriter_section(w, "pool");
+    iniwriter_kv(w, "size", "16");
+    if(iniwriter_close(w)) fprintf(stderr, "%s\n", get_errmsg());
+  @endcode
+ */
+/*--------------------------------------------------------------------------*/
+iniwriter * iniwriter_open(const char * ininame);
+
+/** Open streaming writer into descriptor `fd` (it isn't closed by iniwriter_close()) */
+iniwriter * iniwriter_open_fd(int fd);
+
+/** Start new section: next keys belong to it. Returns 0 if Ok */
+int iniwriter_section(iniwriter * w, const char * name);
+
+/** Write key `key` with value `val` (NULL means empty) into current section. Returns 0 if Ok */
+int iniwriter_kv(iniwriter * w, const char * key, const char * val);
+
+/** The same as iniwriter_kv() for key and value of given length (not necessary zero-terminated) */
+int iniwriter_kv_n(iniwriter * w, const char * key, size_t klen, const char * val, size_t vlen);
+
+/** Flush buffer and close writer, returns 0 if all data was written */
+int iniwriter_close(iniwriter * w);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Free all memory associated to an ini dictionary
@@ -278,7 +727,7 @@ dictionary * iniparser_load(const char * ininame);
 /*--------------------------------------------------------------------------*/
 void iniparser_freedict(dictionary * d);
 
-/** Sort objects by their hash in large dictionary for quick access */
+/** Sort objects by their hash (lookup indexes are built automatically, so it isn't necessary) */
 void iniparser_sort_hash(dictionary *d);
 
 /** Sort objects by their names */
@@ -294,11 +743,106 @@ typedef enum{
     ,INIPARSER_NO_MEM          // can't allocate memory
     ,INIPARSER_TOO_LONG        // line too long
     ,INIPARSER_SYNTAX_ERR      // syntax error
+    ,INIPARSER_STALE_KEY       // resolved key became stale
+    ,INIPARSER_OUT_OF_RANGE    // number is outside of allowed range
+    ,INIPARSER_CHANGED         // file was changed by somebody else after loading
+    ,INIPARSER_BAD_VALUE       // key, value or section name can't be read back from ini file
 } iniparser_err_t;
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get last error code and message
+  @return   error code or message of last call of this thread
+
+  Error state is thread-local: each thread gets errors of its own calls.
+ */
+/*--------------------------------------------------------------------------*/
 iniparser_err_t get_error();
 char *get_errmsg();
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Getters returning status
+  @param    d           Dictionary to search
+  @param    key         Key string to look for
+  @param    notfound    Value to return in case of error
+  @param    err         If not NULL, status code (INIPARSER_NO_ERROR,
+                        INIPARSER_NO_OBJECT, INIPARSER_NOT_FOUND or
+                        INIPARSER_BAD_NUMBER)
+  @return   value found or `notfound`
+
+  The same as iniparser_getstring(), iniparser_getint() etc, but status is
+  returned in `err`: these functions don't change any global or
+  thread-local state, so get_error() isn't changed.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_getstring_ex(const dictionary * d, const char * key, const char * def, iniparser_err_t * err);
+int iniparser_getint_ex(const dictionary * d, const char * key, int notfound, iniparser_err_t * err);
+long int iniparser_getlongint_ex(const dictionary * d, const char * key, long int notfound, iniparser_err_t * err);
+double iniparser_getdouble_ex(const dictionary * d, const char * key, double notfound, iniparser_err_t * err);
+int iniparser_getboolean_ex(const dictionary * d, const char * key, int notfound, iniparser_err_t * err);
+
+/** Types of struct fields for iniparser_bind() */
+typedef enum{
+    INIPARSER_T_INT             // int
+    ,INIPARSER_T_LONG           // long int
+    ,INIPARSER_T_DOUBLE         // double
+    ,INIPARSER_T_BOOL           // int (0 or 1)
+    ,INIPARSER_T_STRING         // const char* (points to dictionary value or default)
+    ,INIPARSER_T_STRBUF         // char[size] (value copied)
+} iniparser_type_t;
+
+/** Description of one struct field for iniparser_bind() */
+typedef struct {
+    const char *        key ;   /** Key name ("section:key" or "key" outside of sections) */
+    iniparser_type_t    type ;  /** Type of field */
+    size_t              offset ;/** Offset of field in struct */
+    size_t              size ;  /** Size of field (buffer size for INIPARSER_T_STRBUF) */
+    const char *        def ;   /** Default value (NULL if key is required) */
+    double              min ;   /** Minimal allowed value of number */
+    double              max ;   /** Maximal allowed value of number (no check if max <= min) */
+} iniparser_field_t;
+
+/** Fill field description: `k` - key, `t` - type, `s` - struct, `m` - member, `def` - default */
+#define INIPARSER_FIELD(k, t, s, m, def) \
+    {(k), (t), offsetof(s, m), sizeof(((s*)0)->m), (def), 0., 0.}
+/** The same as INIPARSER_FIELD with range check of number */
+#define INIPARSER_FIELD_RANGE(k, t, s, m, def, lo, hi) \
+    {(k), (t), offsetof(s, m), sizeof(((s*)0)->m), (def), (lo), (hi)}
+
+/** Error of iniparser_bind() */
+typedef struct {
+    size_t              field ; /** Index of field in descriptions table */
+    iniparser_err_t     err ;   /** Error code */
+} iniparser_binderr_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Fill a struct by values from dictionary
+  @param    d       Dictionary to read
+  @param    fields  Table of struct fields descriptions
+  @param    n       Amount of fields
+  @param    obj     Struct to fill
+  @param    errs    Array for errors (could be NULL)
+  @param    nerrs   Size of `errs`
+  @return   amount of errors found (could be more than `nerrs`) or -1 in case of error
+
+  Fields are grouped by sections, so each section is searched once; if many
+  fields of a section are required, its keys are checked in one linear pass
+  instead of searching each key. Numbers are converted by the same cached
+  converters as the getters use.
+
+  Missing key gets default value; if there's no default, INIPARSER_NOT_FOUND
+  is reported and the field stays unchanged. Value that isn't a number
+  (INIPARSER_BAD_NUMBER), is outside of [min, max] (INIPARSER_OUT_OF_RANGE)
+  or doesn't fit in buffer (INIPARSER_TOO_LONG) is reported and replaced by
+  default (if any). Errors aren't stored in last error: all of them are
+  reported at once in `errs`.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_bind(const dictionary * d, const iniparser_field_t * fields, size_t n,
+                   void * obj, iniparser_binderr_t * errs, size_t nerrs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,165 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inireload.c
+   @author  E.V. Emelianov
+   @brief   Ini file reloaded when it changes.
+*/
+/*--------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+#include "inireload.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------
+                            Private functions
+ ---------------------------------------------------------------------------*/
+
+/** Background thread: reload file until pipe `stop` becomes readable */
+static void * inireload_thread(void * arg)
+{
+    inireload *r = (inireload*)arg;
+    struct pollfd fds[2];
+    fds[0].fd = r->ifd;
+    fds[1].fd = r->stop[0];
+    fds[0].events = fds[1].events = POLLIN;
+    for(;;){
+        if(poll(fds, 2, -1) < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        if(fds[1].revents) break;
+        if(fds[0].revents) inireload_process(r);
+    }
+    return NULL;
+}
+
+/** Watch directory of file: file could be replaced by rename() */
+static int inireload_watch(inireload * r)
+{
+    char *slash = strrchr(r->ininame, '/'), *dir;
+    if(!slash){
+        r->base = r->ininame;
+        dir = strdup(".");
+    }else{
+        r->base = slash + 1;
+        dir = strndup(r->ininame, (slash == r->ininame) ? 1 : (size_t)(slash - r->ininame));
+    }
+    if(!dir) return -1;
+    if((r->ifd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) > -1)
+        r->wd = inotify_add_watch(r->ifd, dir, IN_CLOSE_WRITE|IN_MOVED_TO);
+    free(dir);
+    return (r->ifd < 0 || r->wd < 0) ? -1 : 0;
+}
+
+/*---------------------------------------------------------------------------
+                            Function codes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load ini file and start watching it
+  @param    ininame Name of ini file.
+  @param    flags   INIRELOAD_THREAD to reparse file by background thread.
+  @return   reloader or NULL in case of error
+
+  Watch is added before file is loaded, so changes made while loading
+  aren't lost (file is just reloaded once more).
+ */
+/*--------------------------------------------------------------------------*/
+inireload * inireload_new(const char * ininame, int flags)
+{
+    inireload *r;
+    dictionary *d;
+    if(!ininame || !(r = calloc(1, sizeof(inireload)))) return NULL;
+    r->ifd = r->wd = r->stop[0] = r->stop[1] = -1;
+    if(!(r->ininame = strdup(ininame)) || inireload_watch(r)) goto bad;
+    if(!(d = iniparser_load(ininame))) goto bad;
+    if(!(r->rc = dictrcu_new(d))){
+        iniparser_freedict(d);
+        goto bad;
+    }
+    if(flags & INIRELOAD_THREAD){
+        if(pipe(r->stop)) goto bad;
+        if(pthread_create(&r->thread, NULL, inireload_thread, r)) goto bad;
+        r->threaded = 1;
+    }
+    return r;
+bad:
+    inireload_del(r);
+    return NULL;
+}
+
+/** Stop watching and free reloader with all versions of dictionary (there should be no readers) */
+void inireload_del(inireload * r)
+{
+    if(!r) return;
+    if(r->threaded){
+        char c = 0;
+        while(write(r->stop[1], &c, 1) < 0 && errno == EINTR);
+        pthread_join(r->thread, NULL);
+    }
+    if(r->stop[0] > -1) close(r->stop[0]);
+    if(r->stop[1] > -1) close(r->stop[1]);
+    if(r->ifd > -1) close(r->ifd);
+    dictrcu_del(r->rc);
+    free(r->ininame);
+    free(r);
+}
+
+/** Descriptor to wait for changes of file (readable when inireload_process() should be called) */
+int inireload_fd(const inireload * r)
+{
+    return r ? r->ifd : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Reload file if it was changed
+  @param    r   Reloader.
+  @return   1 if new version was published, 0 if file wasn't changed,
+            -1 if file can't be parsed (old version stays current)
+
+  All pending events are read first, so a burst of writes costs one parse.
+  Overflow of inotify queue is treated as change of file.
+ */
+/*--------------------------------------------------------------------------*/
+int inireload_process(inireload * r)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *e;
+    dictionary *d;
+    ssize_t l;
+    char *p;
+    int changed = 0;
+    if(!r) return -1;
+    while((l = read(r->ifd, buf, sizeof(buf))) > 0){
+        for(p = buf; p < buf + l; p += sizeof(struct inotify_event) + e->len){
+            e = (const struct inotify_event*)p;
+            if((e->mask & IN_Q_OVERFLOW) || (e->len && !strcmp(e->name, r->base))) changed = 1;
+        }
+    }
+    if(!changed) return 0;
+    if(!(d = iniparser_load(r->ininame))){
+        __atomic_store_n(&r->err, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    dictrcu_replace(r->rc, d);
+    __atomic_store_n(&r->err, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&r->gen, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/** Number of successful reloads (could be read by any thread) */
+unsigned long inireload_gen(const inireload * r)
+{
+    return r ? __atomic_load_n(&r->gen, __ATOMIC_ACQUIRE) : 0;
+}
@@ -0,0 +1,109 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inireload.h
+   @author  E.V. Emelianov
+   @brief   Ini file reloaded when it changes.
+
+   Reloader watches directory of ini file by inotify (so both editing in
+   place and replacing by rename() are seen), parses changed file and
+   publishes new dictionary by atomic pointer swap (see dictrcu.h). Old
+   dictionary is freed when all readers which could see it are gone, so
+   readers never take locks.
+
+   File could be reparsed by background thread of reloader or by caller:
+   put inireload_fd() into epoll/poll loop and call inireload_process()
+   when it is readable.
+
+   @code
+   inireload *r = inireload_new("app.ini", INIRELOAD_THREAD);
+   epoch_reader *rd = dictrcu_reader_new(r->rc); // once per thread
+   const dictionary *d = dictrcu_read_lock(r->rc, rd);
+   int n = iniparser_getint(d, "pool:size", 4);
+   dictrcu_read_unlock(rd);
+   @endcode
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INIRELOAD_H_
+#define _INIRELOAD_H_
+
+/*---------------------------------------------------------------------------
+                                Includes
+ ---------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "dictrcu.h"
+#include "iniparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*---------------------------------------------------------------------------
+                                New types
+ ---------------------------------------------------------------------------*/
+
+/** Flags of inireload_new() */
+#define INIRELOAD_THREAD    (1<<0)  // reload by background thread
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Reloaded ini file
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct {
+    dictrcu         *   rc ;        /** Current version of file (read by dictrcu_read_lock()) */
+    char            *   ininame ;   /** Name of ini file */
+    const char      *   base ;      /** Name of file in its directory (part of `ininame` or ".") */
+    int                 ifd ;       /** Inotify descriptor */
+    int                 wd ;        /** Watch of directory */
+    int                 stop[2] ;   /** Pipe waking up thread to stop it */
+    int                 threaded ;  /** ==1 if background thread runs */
+    pthread_t           thread ;    /** Background thread */
+    unsigned long       gen ;       /** Number of successful reloads */
+    int                 err ;       /** ==1 if last reload failed (old version is kept) */
+} inireload;
+
+/*---------------------------------------------------------------------------
+                            Function prototypes
+ ---------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load ini file and start watching it
+  @param    ininame Name of ini file.
+  @param    flags   INIRELOAD_THREAD to reparse file by background thread.
+  @return   reloader or NULL in case of error
+ */
+/*--------------------------------------------------------------------------*/
+inireload * inireload_new(const char * ininame, int flags);
+
+/** Stop watching and free reloader with all versions of dictionary (there should be no readers) */
+void inireload_del(inireload * r);
+
+/** Descriptor to wait for changes of file (readable when inireload_process() should be called) */
+int inireload_fd(const inireload * r);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Reload file if it was changed
+  @param    r   Reloader.
+  @return   1 if new version was published, 0 if file wasn't changed,
+            -1 if file can't be parsed (old version stays current)
+
+  Doesn't block: pending events of inotify are read and file is parsed
+  once for all of them. Called by background thread in INIRELOAD_THREAD
+  mode.
+ */
+/*--------------------------------------------------------------------------*/
+int inireload_process(inireload * r);
+
+/** Number of successful reloads (could be read by any thread) */
+unsigned long inireload_gen(const inireload * r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
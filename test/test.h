@@ -0,0 +1,105 @@
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    test.h
+   @brief   Minimal checks for tests of iniparser.
+
+   Each test is a program: failed checks are reported with their line,
+   TEST_END() prints result and returns non-zero status if something
+   failed. Temporary files are made in current directory with names
+   starting with "tmp_" (removed by `make clean`).
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_failed = 0;
+
+#define CHECK(x) do{ if(!(x)){ \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+        ++test_failed; } }while(0)
+
+#define CHECK_STR(a, b) do{ const char *a_ = (a), *b_ = (b); \
+        if(!a_ || !b_ || strcmp(a_, b_)){ \
+        fprintf(stderr, "%s:%d: \"%s\" != \"%s\"\n", __FILE__, __LINE__, a_ ? a_ : "(null)", b_ ? b_ : "(null)"); \
+        ++test_failed; } }while(0)
+
+#define TEST_END() do{ printf("%-24s %s\n", __FILE__, test_failed ? "FAILED" : "OK"); \
+        return test_failed ? 1 : 0; }while(0)
+
+/** Write `text` into file `name` */
+static inline void test_putfile(const char * name, const char * text)
+{
+    FILE *f = fopen(name, "w");
+    if(!f){ perror(name); exit(2); }
+    fputs(text, f);
+    fclose(f);
+}
+
+/** Read whole file into allocated string (NULL if can't) */
+static inline char * test_getfile(const char * name, size_t * len)
+{
+    FILE *f = fopen(name, "r");
+    char *buf;
+    long l;
+    if(!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    l = ftell(f);
+    rewind(f);
+    buf = malloc((size_t)l + 1);
+    if(buf && fread(buf, 1, (size_t)l, f) != (size_t)l){ free(buf); buf = NULL; }
+    if(buf) buf[l] = 0;
+    if(len) *len = (size_t)l;
+    fclose(f);
+    return buf;
+}
+
+/** Output of dictionary_dump() as allocated string */
+static inline char * test_dump(const dictionary * d, size_t * len)
+{
+    char *buf = NULL;
+    size_t l = 0;
+    FILE *f = open_memstream(&buf, &l);
+    if(!f) return NULL;
+    dictionary_dump(d, f);
+    fclose(f);
+    if(len) *len = l;
+    return buf;
+}
+
+/** Count keys of `a` which are in `b` with the same value, `n` gets number of keys of `a` */
+static inline size_t test_subset(const dictionary * a, const dictionary * b, size_t * n)
+{
+    char key[2048];
+    size_t i, j, same = 0;
+    *n = 0;
+    for(i = 0; i <= a->n; ++i){
+        const dictentry *de = (i == a->n) ? a->noname : a->entries[i];
+        if(!de->name && i < a->n) continue; // deleted
+        for(j = 0; j < de->n; ++j){
+            const keyval *kv = &de->kvlist[j];
+            const char *v;
+            if(!kv->key) continue;
+            ++*n;
+            if(de->name) snprintf(key, sizeof(key), "%s:%s", de->name, kv->key);
+            else snprintf(key, sizeof(key), "%s", kv->key);
+            if((v = dictionary_get(b, key, NULL)) && !strcmp(v, kv->val)) ++same;
+            else fprintf(stderr, "key %s: \"%s\" != \"%s\"\n", key, kv->val, v ? v : "(null)");
+        }
+    }
+    return same;
+}
+
+/** ==1 if dictionaries have the same keys with the same values */
+static inline int test_same(const dictionary * a, const dictionary * b)
+{
+    size_t na, nb;
+    return test_subset(a, b, &na) == na && test_subset(b, a, &nb) == nb;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/* Copy-on-write clone: changes of clone and of source don't see each other */
+#include "iniparser.h"
+#include "test.h"
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0), *c, *c2;
+    char *before, *after;
+    dictentry *a, *b;
+
+    CHECK(!dictionary_set(d, "top", "1"));
+    CHECK(!dictionary_set(d, "a:x", "ax"));
+    CHECK(!dictionary_set(d, "a:y", "ay"));
+    CHECK(!dictionary_set(d, "b:x", "bx"));
+    CHECK(!dictionary_set(d, "gone:z", "z"));
+    before = test_dump(d, NULL);
+
+    CHECK((c = dictionary_clone(d)) != NULL);
+    a = dictentry_find(d, "a");
+    b = dictentry_find(d, "b");
+    CHECK(dictentry_find(c, "a") == a); // sections are shared until changed
+    CHECK(dictentry_find(c, "b") == b);
+
+    // change clone: only touched sections are copied
+    CHECK(!dictionary_set(c, "a:x", "changed"));
+    CHECK(!dictionary_set(c, "a:y", NULL));
+    CHECK(!dictionary_set(c, "a:new", "n"));
+    CHECK(!dictionary_set(c, "top", "2"));
+    CHECK(!dictionary_set(c, "gone", NULL));
+    CHECK(!dictionary_set(c, "c:k", "ck"));
+    CHECK(dictentry_find(c, "a") != a);
+    CHECK(dictentry_find(c, "b") == b);
+    CHECK_STR(dictionary_get(c, "a:x", NULL), "changed");
+    CHECK(dictionary_get(c, "a:y", NULL) == NULL);
+    CHECK_STR(dictionary_get(c, "a:new", NULL), "n");
+    CHECK_STR(dictionary_get(c, "top", NULL), "2");
+    CHECK(dictentry_find(c, "gone") == NULL);
+    CHECK_STR(dictionary_get(c, "c:k", NULL), "ck");
+    CHECK_STR(dictionary_get(c, "b:x", NULL), "bx");
+
+    // source is the same as before
+    after = test_dump(d, NULL);
+    CHECK_STR(after, before);
+    free(after);
+    CHECK(dictentry_find(d, "a") == a);
+
+    // change source: clone doesn't see it
+    CHECK(!dictionary_set(d, "b:x", "source"));
+    CHECK_STR(dictionary_get(c, "b:x", NULL), "bx");
+    CHECK(dictentry_find(c, "b") == b); // source copied shared section
+    CHECK(dictentry_find(d, "b") != b);
+
+    // clone of clone, moving items copies all sections
+    CHECK((c2 = dictionary_clone(c)) != NULL);
+    free(before);
+    before = test_dump(c, NULL);
+    dictionary_sort(c2);
+    CHECK(!dictionary_optimize(c2));
+    CHECK_STR(dictionary_get(c2, "a:x", NULL), "changed");
+    after = test_dump(c, NULL);
+    CHECK_STR(after, before);
+    free(after);
+
+    // clones live after source is deleted
+    dictionary_del(d);
+    dictionary_del(c);
+    CHECK_STR(dictionary_get(c2, "b:x", NULL), "bx");
+    CHECK_STR(dictionary_get(c2, "c:k", NULL), "ck");
+    CHECK_STR(dictionary_get(c2, "top", NULL), "2");
+    dictionary_del(c2);
+    free(before);
+    TEST_END();
+}
@@ -0,0 +1,125 @@
+/* All kinds of dump give the same bytes as dictionary_dump() */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "iniparser.h"
+#include "test.h"
+
+/** Dictionary with short and long keys, huge value, deleted keys and sections */
+static dictionary * make(void)
+{
+    dictionary *d = dictionary_new(0);
+    char key[128], *big;
+    int i;
+    CHECK(!dictionary_set(d, "global", "value"));
+    CHECK(!dictionary_set(d, "a_key_longer_than_thirty_characters_total", "x"));
+    for(i = 0; i < 5000; ++i){
+        snprintf(key, sizeof(key), "sec%d:key%d", i % 50, i);
+        CHECK(!dictionary_set(d, key, key));
+    }
+    CHECK(!dictionary_set(d, "sec3:key3", NULL));
+    CHECK(!dictionary_set(d, "sec7", NULL));
+    CHECK(!dictionary_set(d, "sec8:exactly_thirty_chars_long_key", ""));
+    big = malloc(200000); // larger than buffer of dump
+    memset(big, 'v', 199999);
+    big[199999] = 0;
+    CHECK(!dictionary_set(d, "sec9:big", big));
+    free(big);
+    return d;
+}
+
+/** Parallel dump after "head" written to file opened with `flags` */
+static void check_parallel(const dictionary * d, const char * ref, size_t len, int flags, int nthreads)
+{
+    char *buf;
+    size_t l;
+    int fd = open("tmp_dump.ini", O_WRONLY|O_CREAT|O_TRUNC|flags, 0644);
+    CHECK(fd > -1);
+    CHECK(write(fd, "head", 4) == 4);
+    CHECK(dictionary_dump_parallel(d, fd, nthreads) == DERR_OK);
+    CHECK(write(fd, "tail", 4) == 4); // position is at the end of dump
+    close(fd);
+    buf = test_getfile("tmp_dump.ini", &l);
+    CHECK(buf && l == len + 8);
+    CHECK(buf && !memcmp(buf, "head", 4) && !memcmp(buf + 4, ref, len) && !memcmp(buf + 4 + len, "tail", 4));
+    free(buf);
+}
+
+/** Parallel dump of dictionary larger than 1M, unnamed section is the most part of it */
+static void test_parallel(void)
+{
+    dictionary *d = dictionary_new(0);
+    char key[64], *ref;
+    size_t len;
+    int i;
+    for(i = 0; i < 40000; ++i){
+        snprintf(key, sizeof(key), "global%d", i);
+        CHECK(!dictionary_set(d, key, "unnamed section value"));
+    }
+    for(i = 0; i < 20000; ++i){
+        snprintf(key, sizeof(key), "s%d:key%d", i % 7, i);
+        CHECK(!dictionary_set(d, key, key));
+    }
+    CHECK(!dictionary_set(d, "s3", NULL));
+    ref = test_dump(d, &len);
+    CHECK(len > (1<<20));
+    check_parallel(d, ref, len, 0, 2);
+    check_parallel(d, ref, len, 0, 4);
+    check_parallel(d, ref, len, 0, 16);
+    check_parallel(d, ref, len, O_APPEND, 4);
+    unlink("tmp_dump.ini");
+    free(ref);
+    dictionary_del(d);
+}
+
+int main(void)
+{
+    dictionary *d = make();
+    char *ref, *buf;
+    size_t len, l;
+    int fd;
+
+    ref = test_dump(d, &len);
+    CHECK(ref && len > 200000);
+    CHECK(dictionary_dump_size(d) == len);
+
+    // memory
+    buf = iniparser_dump_to_buffer(d, &l);
+    CHECK(l == len && !memcmp(buf, ref, len));
+    free(buf);
+    buf = malloc(len);
+    CHECK(dictionary_dump_mem(d, buf, len - 1) == len); // too small: nothing written
+    CHECK(dictionary_dump_mem(d, buf, len) == len);
+    CHECK(!memcmp(buf, ref, len));
+    free(buf);
+
+    // descriptor
+    fd = open("tmp_dump.ini", O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    CHECK(fd > -1);
+    CHECK(dictionary_dump_fd(d, fd) == DERR_OK);
+    close(fd);
+    buf = test_getfile("tmp_dump.ini", &l);
+    CHECK(buf && l == len && !memcmp(buf, ref, len));
+    free(buf);
+
+    // dump is parsed back into the same dictionary (without line longer than parser reads)
+    CHECK(!dictionary_set(d, "sec9:big", NULL));
+    free(ref);
+    ref = test_dump(d, &len);
+    fd = open("tmp_dump.ini", O_WRONLY|O_TRUNC);
+    CHECK(dictionary_dump_fd(d, fd) == DERR_OK);
+    close(fd);
+    dictionary_del(d);
+    d = iniparser_load("tmp_dump.ini");
+    CHECK(d != NULL);
+    buf = test_dump(d, &l);
+    CHECK(buf && l == len && !memcmp(buf, ref, len));
+    free(buf);
+
+    unlink("tmp_dump.ini");
+    dictionary_del(d);
+    free(ref);
+
+    test_parallel();
+    TEST_END();
+}
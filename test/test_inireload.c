@@ -0,0 +1,79 @@
+/* Reloader: file replaced by write or rename() is reloaded, broken one is not */
+#include <poll.h>
+#include <unistd.h>
+
+#include "inireload.h"
+#include "test.h"
+
+#define INI     "tmp_inireload.ini"
+
+/** Wait for event of file (up to 2 s) and process it */
+static int process(inireload * r)
+{
+    struct pollfd p;
+    p.fd = inireload_fd(r);
+    p.events = POLLIN;
+    if(poll(&p, 1, 2000) != 1) return -2;
+    return inireload_process(r);
+}
+
+/** Value of "s:v" in current version */
+static int value(inireload * r)
+{
+    epoch_reader *er = dictrcu_reader_new(r->rc);
+    int v;
+    if(!er) return -1;
+    v = iniparser_getint(dictrcu_read_lock(r->rc, er), "s:v", -1);
+    dictrcu_read_unlock(er);
+    dictrcu_reader_del(er);
+    return v;
+}
+
+int main(void)
+{
+    inireload *r;
+    int i;
+
+    test_putfile(INI, "[s]\nv = 1\n");
+    CHECK((r = inireload_new(INI, 0)) != NULL);
+    if(!r) TEST_END();
+    CHECK(value(r) == 1 && inireload_gen(r) == 0);
+    CHECK(inireload_process(r) == 0); // no events
+
+    // written in place
+    test_putfile(INI, "[s]\nv = 2\n");
+    CHECK(process(r) == 1);
+    CHECK(inireload_gen(r) == 1 && value(r) == 2);
+
+    // replaced by rename()
+    test_putfile("tmp_inireload.new", "[s]\nv = 3\n");
+    CHECK(!rename("tmp_inireload.new", INI));
+    CHECK(process(r) == 1);
+    CHECK(inireload_gen(r) == 2 && value(r) == 3);
+
+    // other file in the same directory
+    test_putfile("tmp_inireload.other", "[s]\nv = 4\n");
+    CHECK(process(r) == 0);
+    CHECK(inireload_gen(r) == 2 && value(r) == 3);
+
+    // broken file: old version stays
+    test_putfile(INI, "[s]\nv = 5\nsyntax error here\n");
+    CHECK(process(r) == -1);
+    CHECK(inireload_gen(r) == 2 && value(r) == 3 && r->err);
+    test_putfile(INI, "[s]\nv = 6\n");
+    CHECK(process(r) == 1);
+    CHECK(inireload_gen(r) == 3 && value(r) == 6 && !r->err);
+    inireload_del(r);
+
+    // background thread
+    CHECK((r = inireload_new(INI, INIRELOAD_THREAD)) != NULL);
+    if(!r) TEST_END();
+    test_putfile(INI, "[s]\nv = 7\n");
+    for(i = 0; i < 200 && inireload_gen(r) < 1; ++i) usleep(10000);
+    CHECK(inireload_gen(r) == 1 && value(r) == 7);
+    inireload_del(r);
+
+    unlink(INI);
+    unlink("tmp_inireload.other");
+    TEST_END();
+}
@@ -0,0 +1,122 @@
+/* Journal: changes survive crash, torn record is cut, compaction keeps values */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "inijournal.h"
+#include "test.h"
+
+#define INI     "tmp_journal.ini"
+
+/** ==1 if file exists */
+static int exists(const char * name)
+{
+    struct stat st;
+    return !stat(name, &st);
+}
+
+/** Open journal, check it opened */
+static inijournal * jopen(void)
+{
+    inijournal *j = inijournal_open(INI);
+    CHECK(j != NULL);
+    if(!j) exit(1);
+    return j;
+}
+
+/** Wait for compaction started by inijournal_compact() */
+static void jwait(inijournal * j)
+{
+    pthread_mutex_lock(&j->lock);
+    while(j->compacting == 1) pthread_cond_wait(&j->cond, &j->lock);
+    pthread_mutex_unlock(&j->lock);
+}
+
+int main(void)
+{
+    inijournal *j;
+    pid_t pid;
+    int status, fd;
+    struct stat st;
+
+    unlink(INI);
+    unlink(INI ".journal.0");
+    unlink(INI ".journal.1");
+    unlink(INI ".journal.2");
+    unlink(INI ".journal.3");
+
+    // crash: synced changes are replayed, changes in buffer are lost
+    if(!(pid = fork())){
+        j = jopen();
+        dictionary_set(j->d, "s:path", "C:\\dir\\");
+        dictionary_set(j->d, "s:x", "1");
+        dictionary_set(j->d, "top", "value ; with comment");
+        dictionary_set(j->d, "gone:k", "v");
+        dictionary_set(j->d, "gone", NULL);
+        inijournal_sync(j);
+        dictionary_set(j->d, "s:lost", "never synced");
+        _exit(0); // no close
+    }
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status));
+    j = jopen();
+    CHECK_STR(dictionary_get(j->d, "s:path", NULL), "C:\\dir\\");
+    CHECK_STR(dictionary_get(j->d, "s:x", NULL), "1");
+    CHECK_STR(dictionary_get(j->d, "top", NULL), "value ; with comment");
+    CHECK(dictentry_find(j->d, "gone") == NULL);
+    CHECK(dictionary_get(j->d, "s:lost", NULL) == NULL);
+    CHECK(!dictionary_set(j->d, "s:y", "2"));
+    CHECK(!inijournal_close(j));
+
+    // torn record at end of journal is cut off, the rest is replayed
+    CHECK(!stat(INI ".journal.0", &st));
+    fd = open(INI ".journal.0", O_WRONLY);
+    CHECK(fd > -1 && !ftruncate(fd, st.st_size - 3));
+    close(fd);
+    j = jopen();
+    CHECK_STR(dictionary_get(j->d, "s:x", NULL), "1");
+    CHECK(dictionary_get(j->d, "s:y", NULL) == NULL);
+    CHECK(!dictionary_set(j->d, "s:y", "3")); // appended after cut
+    CHECK(!inijournal_close(j));
+    j = jopen();
+    CHECK_STR(dictionary_get(j->d, "s:y", NULL), "3");
+
+    // compaction writes values exactly and removes folded journal
+    CHECK(!inijournal_compact(j));
+    jwait(j);
+    CHECK(!j->cerr);
+    CHECK(!exists(INI ".journal.0"));
+    CHECK(!dictionary_set(j->d, "s:z", "after compaction"));
+    CHECK(!inijournal_close(j));
+    j = jopen();
+    CHECK_STR(dictionary_get(j->d, "s:path", NULL), "C:\\dir\\");
+    CHECK_STR(dictionary_get(j->d, "s:x", NULL), "1");
+    CHECK_STR(dictionary_get(j->d, "top", NULL), "value ; with comment");
+    CHECK_STR(dictionary_get(j->d, "s:z", NULL), "after compaction");
+
+    // key read back changed (parser lowercases keys): ini file isn't replaced
+    CHECK(!dictionary_set(j->d, "s:Upper", "v"));
+    CHECK(!inijournal_compact(j));
+    jwait(j);
+    CHECK(j->cerr);
+    CHECK(!dictionary_set(j->d, "s:Upper", NULL));
+
+    // value which can't be written into ini file: compaction fails, journals are kept
+    CHECK(!dictionary_set(j->d, "s:multi", "line\nbreak"));
+    CHECK(!inijournal_compact(j));
+    jwait(j);
+    CHECK(j->cerr);
+    CHECK(exists(INI ".journal.1"));
+    CHECK(!inijournal_close(j));
+    j = jopen();
+    CHECK_STR(dictionary_get(j->d, "s:multi", NULL), "line\nbreak");
+    CHECK_STR(dictionary_get(j->d, "s:path", NULL), "C:\\dir\\");
+    CHECK(!inijournal_close(j));
+
+    unlink(INI);
+    unlink(INI ".journal.0");
+    unlink(INI ".journal.1");
+    unlink(INI ".journal.2");
+    unlink(INI ".journal.3");
+    TEST_END();
+}
@@ -0,0 +1,66 @@
+/* Automatic choice of lookup strategy: all keys are found in any mode */
+#include "iniparser.h"
+#include "test.h"
+
+/** Fill section `sec` with `n` keys */
+static void fill(dictionary * d, const char * sec, int n)
+{
+    char key[64], val[64];
+    int i;
+    for(i = 0; i < n; ++i){
+        snprintf(key, sizeof(key), "%s:key%d", sec, i);
+        snprintf(val, sizeof(val), "%d", i);
+        CHECK(!dictionary_set(d, key, val));
+    }
+}
+
+/** Check that all keys of section are found */
+static void check(const dictionary * d, const char * sec, int n)
+{
+    char key[64], val[64];
+    int i;
+    for(i = 0; i < n; ++i){
+        snprintf(key, sizeof(key), "%s:key%d", sec, i);
+        snprintf(val, sizeof(val), "%d", i);
+        CHECK_STR(dictionary_get(d, key, NULL), val);
+    }
+    snprintf(key, sizeof(key), "%s:key%d", sec, n);
+    CHECK(dictionary_get(d, key, NULL) == NULL);
+}
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0);
+    dicttune_t t = {.linear_max = 4, .hash_min = 32, .sort_ratio = 1, .count_reads = 0};
+    dictstats_t st;
+
+    fill(d, "small", 3);
+    fill(d, "middle", 20);
+    fill(d, "large", 500);
+    check(d, "small", 3);
+    check(d, "middle", 20);
+    check(d, "large", 500);
+    CHECK(!dictionary_stats(d, &st));
+    CHECK(st.nsections == 3);
+    CHECK(st.nkeys == 523);
+    CHECK(st.nlists[DICT_HASHED] >= 1); // "large"
+
+    CHECK(!dictionary_tune(d, &t));
+    CHECK(!dictionary_stats(d, &st));
+    CHECK(st.nlists[DICT_LINEAR] >= 1); // "small"
+    CHECK(st.nlists[DICT_HASHED] >= 1);
+    check(d, "small", 3);
+    check(d, "middle", 20);
+    check(d, "large", 500);
+    // deleted keys aren't found in any mode
+    CHECK(!dictionary_set(d, "large:key7", NULL));
+    CHECK(!dictionary_set(d, "middle:key7", NULL));
+    CHECK(dictionary_get(d, "large:key7", NULL) == NULL);
+    CHECK(dictionary_get(d, "middle:key7", NULL) == NULL);
+    CHECK_STR(dictionary_get(d, "large:key8", NULL), "8");
+
+    t.hash_min = 2; // wrong thresholds
+    CHECK(dictionary_tune(d, &t) == -1);
+    dictionary_del(d);
+    TEST_END();
+}
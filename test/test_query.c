@@ -0,0 +1,85 @@
+/* Queries and sorted iterators stay right when items are added and deleted between them */
+#include "iniparser.h"
+#include "test.h"
+
+#define NITEMS  200
+
+static int keys[NITEMS], secs[NITEMS];
+
+/** Number of items present with number starting with "1" */
+static int expected(const int * present)
+{
+    char name[32];
+    int i, n = 0;
+    for(i = 0; i < NITEMS; ++i){
+        snprintf(name, sizeof(name), "%d", i);
+        if(present[i] && name[0] == '1') ++n;
+    }
+    return n;
+}
+
+/** Query items by prefix and walk them in name and hash order */
+static void check(const dictionary * d, const char * pattern, const dictentry * de, const int * present, int extra)
+{
+    dictquery q;
+    dictiter it;
+    const char *name, *prev = NULL;
+    size_t pos;
+    const char *prefix = strchr(pattern, ':') ? strchr(pattern, ':') + 1 : pattern;
+    int i, n = 0, total = extra;
+    for(i = 0; i < NITEMS; ++i) total += present[i];
+    CHECK(!dictionary_query(d, pattern, 0, &q));
+    while(dictquery_next(&q, &name, NULL)){
+        CHECK(!strncmp(name, prefix, strlen(prefix)));
+        if(prev) CHECK(strcmp(prev, name) < 0);
+        prev = name;
+        ++n;
+    }
+    CHECK(n == expected(present));
+    for(i = DICT_BYNAME; i <= DICT_BYHASH; ++i){
+        CHECK(!dictionary_iter(d, de, (dictorder_t)i, &it));
+        prev = NULL;
+        n = 0;
+        while((pos = dictiter_next(&it)) != DICT_NOPOS){
+            name = de ? de->kvlist[pos].key : d->entries[pos]->name;
+            if(i == DICT_BYNAME && prev) CHECK(strcmp(prev, name) < 0);
+            prev = name;
+            ++n;
+        }
+        CHECK(n == total);
+    }
+}
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0);
+    char name[64];
+    int i;
+
+    srand(1);
+    CHECK(!dictionary_set(d, "s:z", "v")); // section "s" is never deleted
+    for(i = 0; i < 3000; ++i){
+        int k = rand() % NITEMS, sec = rand() & 1;
+        int *present = sec ? secs : keys;
+        if(sec) snprintf(name, sizeof(name), "x%d", k);
+        else snprintf(name, sizeof(name), "s:k%d", k);
+        if(present[k] && rand() % 3 == 0){
+            CHECK(!dictionary_set(d, name, NULL));
+            present[k] = 0;
+        }else{
+            if(sec) strcat(name, ":a"); // section is created with its key
+            CHECK(!dictionary_set(d, name, "v"));
+            if(sec) name[strlen(name) - 2] = 0;
+            present[k] = 1;
+        }
+        if(sec){
+            CHECK((dictentry_find(d, name) != NULL) == present[k]);
+            check(d, "x1", NULL, secs, 1); // + section "s"
+        }else{
+            CHECK((dictionary_get(d, name, NULL) != NULL) == present[k]);
+            check(d, "s:k1", dictentry_find(d, "s"), keys, 1); // + key "z"
+        }
+    }
+    dictionary_del(d);
+    TEST_END();
+}
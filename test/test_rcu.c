@@ -0,0 +1,78 @@
+/* Versioned dictionary: readers see whole versions, strings they got live until unlock */
+#include <pthread.h>
+#include <sched.h>
+
+#include "dictrcu.h"
+#include "test.h"
+
+#define NREADERS    4
+#define NVERSIONS   3000
+
+static dictrcu *rc;
+static int stop;
+
+/** Result of reader */
+typedef struct {
+    long    bad ;   /** Wrong values seen */
+    long    nread ; /** Versions read */
+} result;
+
+/** Reader: values are never older than before and stay the same until unlock */
+static void * reader(void * arg)
+{
+    epoch_reader *r = dictrcu_reader_new(rc);
+    result *res = (result*)arg;
+    long last = -1, n;
+    char copy[2][64];
+    if(!r){ ++res->bad; return NULL; }
+    while(!__atomic_load_n(&stop, __ATOMIC_ACQUIRE)){
+        const dictionary *d = dictrcu_read_lock(rc, r);
+        const char *v = dictionary_get(d, "s:v", NULL), *o = dictionary_get(d, "other:v", NULL);
+        int i;
+        if(!v || sscanf(v, "v%ld", &n) != 1 || n < last) ++res->bad;
+        else last = n;
+        snprintf(copy[0], sizeof(copy[0]), "%s", v ? v : "");
+        snprintf(copy[1], sizeof(copy[1]), "%s", o ? o : "");
+        for(i = 0; i < 100; ++i) sched_yield(); // writer frees old versions meanwhile
+        if(strcmp(copy[0], v ? v : "") || strcmp(copy[1], o ? o : "")) ++res->bad;
+        dictrcu_read_unlock(r);
+        ++res->nread;
+    }
+    dictrcu_reader_del(r);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t th[NREADERS];
+    result res[NREADERS];
+    dictionary *d = dictionary_new(0);
+    char val[64];
+    int i;
+
+    CHECK(!dictionary_set(d, "s:v", "v0"));
+    CHECK((rc = dictrcu_new(d)) != NULL);
+    memset(res, 0, sizeof(res));
+    for(i = 0; i < NREADERS; ++i) CHECK(!pthread_create(&th[i], NULL, reader, &res[i]));
+    for(i = 1; i < NVERSIONS; ++i){
+        snprintf(val, sizeof(val), "v%d", i);
+        if(i % 10 == 0){ // whole new dictionary
+            CHECK((d = dictionary_new(0)) != NULL);
+            CHECK(!dictionary_set(d, "s:v", val));
+            CHECK(!dictrcu_replace(rc, d));
+        }else{
+            CHECK(!dictrcu_set(rc, "s:v", val));
+            if(i % 3 == 0) CHECK(!dictrcu_set(rc, "other:v", val)); // new section
+            else if(i % 3 == 1) CHECK(!dictrcu_set(rc, "other", NULL)); // section deleted
+        }
+        if(i % 100 == 0) dictrcu_synchronize(rc);
+        sched_yield(); // let readers see most versions
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for(i = 0; i < NREADERS; ++i){
+        CHECK(!pthread_join(th[i], NULL));
+        CHECK(res[i].bad == 0 && res[i].nread > 0);
+    }
+    dictrcu_del(rc);
+    TEST_END();
+}
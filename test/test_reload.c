@@ -0,0 +1,59 @@
+/* Reload: result is the same as of fresh load, unchanged sections are shared */
+#include <unistd.h>
+
+#include "iniparser.h"
+#include "test.h"
+
+#define INI     "tmp_reload.ini"
+#define NSEC    8
+#define NKEY    5
+
+static int vals[NSEC][NKEY];
+
+/** Write file of current values; values of the same length, so only hashes tell changed text */
+static void putini(void)
+{
+    FILE *f = fopen(INI, "w");
+    int i, j;
+    if(!f){ perror(INI); exit(2); }
+    fprintf(f, "top = %d\n", vals[0][0]);
+    for(i = 1; i < NSEC; ++i){
+        fprintf(f, "[sec%d]\n", i);
+        for(j = 0; j < NKEY; ++j) fprintf(f, "key%d = %04d\n", j, vals[i][j]);
+    }
+    fclose(f);
+}
+
+int main(void)
+{
+    dictionary *old, *d, *f;
+    const dictentry *keep;
+    char name[16];
+    int i, n, s;
+
+    srand(1);
+    putini();
+    CHECK((old = iniparser_reload(NULL, INI)) != NULL);
+    for(i = 0; i < 200; ++i){
+        s = 1 + rand() % (NSEC - 1);
+        for(n = 1 + rand() % 3; n; --n){ // "%04d" keeps length of section
+            int k = rand() % NKEY;
+            vals[s][k] = rand() % 10000;
+        }
+        if(i % 5 == 0) vals[0][0] = rand() % 10;
+        putini();
+        snprintf(name, sizeof(name), "sec%d", 1 + s % (NSEC - 1));
+        keep = dictentry_find(old, name); // s % (NSEC-1) + 1 != s: not changed
+        CHECK((d = iniparser_reload(old, INI)) != NULL);
+        CHECK((f = iniparser_load(INI)) != NULL);
+        CHECK(d && f && test_same(d, f));
+        CHECK(d && f && iniparser_getnsec(d) == iniparser_getnsec(f));
+        CHECK(d && dictentry_find(d, name) == keep);
+        iniparser_freedict(f);
+        iniparser_freedict(old);
+        old = d;
+    }
+    iniparser_freedict(old);
+    unlink(INI);
+    TEST_END();
+}
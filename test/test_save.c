@@ -0,0 +1,73 @@
+/* Incremental save: many saves without reloading give the file parsed into the same dictionary */
+#include <unistd.h>
+
+#include "iniparser.h"
+#include "test.h"
+
+static const char ini[] =
+    "; comment kept\n"
+    "top = 1\n"
+    "other = two ; comment\n"
+    "\n"
+    "[alpha]\n"
+    "a = \"quoted ; value\"\n"
+    "b = multi \\\n"
+    "    line\n"
+    "c = 3\n"
+    "# another comment\n"
+    "\n"
+    "[beta]\n"
+    "x = 10\n"
+    "[gamma]\n"
+    "y = last"; // no newline at end
+
+/** Random value of length 1..20 */
+static const char * randval(void)
+{
+    static char v[32];
+    int i, n = 1 + rand() % 20;
+    for(i = 0; i < n; ++i) v[i] = (char)('a' + rand() % 26);
+    v[n] = 0;
+    return v;
+}
+
+/** Random change of dictionary */
+static void change(dictionary * d)
+{
+    static const char *secs[] = {"alpha", "beta", "gamma", "delta", "eps", NULL};
+    char key[64];
+    const char *sec = secs[rand() % 6];
+    int k = rand() % 6, op = rand() % 10;
+    if(sec) snprintf(key, sizeof(key), "%s:k%d", sec, k);
+    else snprintf(key, sizeof(key), "k%d", k);
+    if(op == 0 && sec) CHECK(!dictionary_set(d, sec, NULL)); // whole section
+    else if(op < 3) CHECK(!dictionary_set(d, key, NULL));
+    else CHECK(!dictionary_set(d, key, randval()));
+}
+
+int main(void)
+{
+    dictionary *d, *f;
+    char *text;
+    int i, j;
+
+    test_putfile("tmp_save.ini", ini);
+    d = iniparser_load_tracked("tmp_save.ini");
+    CHECK(d != NULL);
+    srand(1);
+    for(i = 0; i < 300; ++i){
+        int n = 1 + rand() % 4;
+        for(j = 0; j < n; ++j) change(d);
+        if(i % 7 == 0) CHECK(!dictionary_set(d, "top", i % 2 ? "2" : "1")); // in place
+        CHECK(!iniparser_save_incremental(d));
+        CHECK((f = iniparser_load("tmp_save.ini")) != NULL);
+        CHECK(f && test_same(d, f));
+        iniparser_freedict(f);
+    }
+    text = test_getfile("tmp_save.ini", NULL);
+    CHECK(text && strstr(text, "; comment kept\n"));
+    free(text);
+    iniparser_freedict(d);
+    unlink("tmp_save.ini");
+    TEST_END();
+}
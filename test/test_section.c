@@ -0,0 +1,82 @@
+/* Section handles: see changes of section, also after it was copied from clone */
+#include "iniparser.h"
+#include "test.h"
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0), *c;
+    iniparser_sec_t s, g, n;
+    iniparser_iter_t it;
+    iniparser_item_t item;
+    int nsec = 0;
+
+    CHECK(!dictionary_set(d, "top", "1"));
+    CHECK(!dictionary_set(d, "srv:port", "80"));
+    CHECK(!dictionary_set(d, "srv:host", "localhost"));
+    CHECK(!dictionary_set(d, "other:x", "1"));
+    s = iniparser_section(d, "SRV");
+    g = iniparser_section(d, NULL);
+    n = iniparser_section(d, "none");
+    CHECK(iniparser_sec_valid(s) && iniparser_sec_valid(g));
+    CHECK(!iniparser_sec_valid(n));
+    CHECK(iniparser_sec_getstring(n, "port", NULL) == NULL && get_error() == INIPARSER_NOT_FOUND);
+    CHECK(iniparser_sec_getint(s, "port", 0) == 80);
+    CHECK(iniparser_sec_nkeys(s) == 2);
+
+    // set and delete keys, add and delete other sections
+    CHECK(!dictionary_set(d, "srv:port", "81"));
+    CHECK(!dictionary_set(d, "srv:new", "n"));
+    CHECK(!dictionary_set(d, "srv:host", NULL));
+    CHECK(!dictionary_set(d, "other", NULL));
+    CHECK(!dictionary_set(d, "more:y", "2"));
+    CHECK(iniparser_sec_getint(s, "port", 0) == 81);
+    CHECK_STR(iniparser_sec_getstring(s, "new", NULL), "n");
+    CHECK(iniparser_sec_getstring(s, "host", NULL) == NULL);
+    CHECK(iniparser_sec_nkeys(s) == 2);
+
+    // section shared with clone is copied by change of source and of clone
+    CHECK((c = dictionary_clone(d)) != NULL);
+    CHECK(!dictionary_set(d, "srv:port", "8080"));
+    CHECK(!dictionary_set(d, "top", "2"));
+    CHECK_STR(iniparser_sec_getstring(s, "port", NULL), "8080");
+    CHECK_STR(iniparser_sec_getstring(g, "top", NULL), "2");
+    CHECK_STR(dictionary_get(c, "srv:port", NULL), "81");
+    dictionary_del(c); // section of handle isn't freed
+    CHECK_STR(iniparser_sec_getstring(s, "port", NULL), "8080");
+    CHECK((c = dictionary_clone(d)) != NULL);
+    n = iniparser_section(c, "srv");
+    CHECK(!dictionary_set(c, "srv:port", "9090"));
+    CHECK_STR(iniparser_sec_getstring(n, "port", NULL), "9090");
+    CHECK_STR(iniparser_sec_getstring(s, "port", NULL), "8080");
+    dictionary_del(c);
+
+    // handles of iterator
+    CHECK(!iniparser_iter_sections(d, INIPARSER_ORDER_NAME, &it));
+    while(iniparser_iter_next(&it, &item)){
+        ++nsec;
+        if(!strcmp(item.name, "srv")) n = item.sec;
+    }
+    CHECK(nsec == 2);
+    c = dictionary_clone(d);
+    CHECK(!dictionary_set(d, "srv:port", "1"));
+    CHECK(iniparser_sec_getint(n, "port", 0) == 1);
+    dictionary_del(c);
+    CHECK(!iniparser_iter_keys(n, INIPARSER_ORDER_NAME, &it));
+    CHECK(iniparser_iter_next(&it, &item) && !strcmp(item.name, "new"));
+    CHECK(iniparser_sec_getint(item.sec, "port", 0) == 1);
+
+    // sorting and deleting make handle stale
+    dictionary_sort(d);
+    CHECK(!iniparser_sec_valid(s));
+    CHECK(iniparser_sec_getstring(s, "port", NULL) == NULL && get_error() == INIPARSER_STALE_KEY);
+    s = iniparser_section(d, "srv");
+    CHECK(iniparser_sec_getint(s, "port", 0) == 1);
+    CHECK(!dictionary_set(d, "srv", NULL));
+    CHECK(!iniparser_sec_valid(s));
+    CHECK(iniparser_sec_getstring(s, "port", NULL) == NULL && get_error() == INIPARSER_STALE_KEY);
+    CHECK(!dictionary_set(d, "srv:port", "2")); // new section
+    CHECK(!iniparser_sec_valid(s));
+
+    dictionary_del(d);
+    TEST_END();
+}
@@ -0,0 +1,41 @@
+/* Shared snapshot without memfd: file in /dev/shm, descriptor can't change it */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "iniparser.h"
+#include "test.h"
+
+/** Kernel without memfd: this definition is linked instead of libc one */
+int memfd_create(const char * name, unsigned int flags)
+{
+    (void)name;
+    (void)flags;
+    errno = ENOSYS;
+    return -1;
+}
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0);
+    const dictsnap *s;
+    pid_t pid;
+    int fd, status;
+
+    CHECK(!dictionary_set(d, "sec:key", "value"));
+    CHECK((fd = iniparser_share(d)) > -1);
+    dictionary_del(d);
+    if(fd < 0) TEST_END();
+    CHECK(write(fd, "x", 1) == -1);
+    CHECK(ftruncate(fd, 0) == -1);
+    CHECK(mmap(NULL, 4096, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+    if(!(pid = fork())){
+        s = iniparser_attach(fd);
+        _exit(!s || strcmp(iniparser_snapshot_getstring(s, "sec:key", ""), "value"));
+    }
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status));
+    close(fd);
+    TEST_END();
+}
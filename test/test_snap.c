@@ -0,0 +1,170 @@
+/* Snapshot: broken snapshot is refused instead of read outside of block, broken cache is parsed again, shared one is sealed */
+#define _GNU_SOURCE // memmem()
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "dictsnap.h"
+#include "iniparser.h"
+#include "test.h"
+
+#define SNAP    "tmp_snap.bin"
+#define CACHE   "tmp_cache"
+
+/** Sections of snapshot in writable memory */
+static dictsnap_sec * secs(char * mem)
+{
+    return (dictsnap_sec*)(mem + ((dictsnap*)mem)->secs);
+}
+
+/** The first key of section `i` */
+static dictsnap_kv * firstkv(char * mem, int i)
+{
+    return (dictsnap_kv*)(mem + secs(mem)[i].keys);
+}
+
+/** Write `size` bytes of `mem` into file */
+static void putbin(const char * name, const char * mem, size_t size)
+{
+    FILE *f = fopen(name, "w");
+    CHECK(f && fwrite(mem, 1, size, f) == size);
+    if(f) fclose(f);
+}
+
+/** Name of the only snapshot in cache (NULL if there's no one) */
+static char * cached(void)
+{
+    static char name[512];
+    struct dirent *e;
+    DIR *dir = opendir(CACHE);
+    char *ret = NULL;
+    if(!dir) return NULL;
+    while((e = readdir(dir)))
+        if(e->d_name[0] != '.'){
+            snprintf(name, sizeof(name), CACHE "/%s", e->d_name);
+            ret = name;
+        }
+    closedir(dir);
+    return ret;
+}
+
+/** Damaged snapshot in cache is removed and file is parsed again */
+static void test_cache(void)
+{
+    const dictsnap *s;
+    char *name, *buf, *v;
+    size_t l;
+    test_putfile("tmp_cache.ini", "[sec]\nkey = value\n");
+    mkdir(CACHE, 0755);
+    CHECK((s = iniparser_load_cached("tmp_cache.ini", CACHE)) != NULL);
+    CHECK_STR(iniparser_snapshot_getstring(s, "sec:key", NULL), "value");
+    iniparser_snapshot_close(s);
+    CHECK((name = cached()) != NULL);
+    if(!name) return;
+    // offsets are right, but value is changed
+    buf = test_getfile(name, &l);
+    CHECK(buf && (v = memmem(buf, l, "value", 5)));
+    if(buf && v) v[0] = 'V';
+    putbin(name, buf, l);
+    free(buf);
+    CHECK((s = iniparser_load_cached("tmp_cache.ini", CACHE)) != NULL);
+    CHECK_STR(iniparser_snapshot_getstring(s, "sec:key", NULL), "value");
+    iniparser_snapshot_close(s);
+    // truncated
+    CHECK((name = cached()) != NULL && !truncate(name, (off_t)l - 8));
+    CHECK((s = iniparser_load_cached("tmp_cache.ini", CACHE)) != NULL);
+    CHECK_STR(iniparser_snapshot_getstring(s, "sec:key", NULL), "value");
+    iniparser_snapshot_close(s);
+    CHECK((s = dictsnap_open(cached())) != NULL && !dictsnap_verify(s)); // cached again
+    dictsnap_close(s);
+    unlink(cached());
+    rmdir(CACHE);
+    unlink("tmp_cache.ini");
+}
+
+/** Shared snapshot is read by other process and can't be changed */
+static void test_share(const dictionary * d)
+{
+    const dictsnap *s;
+    pid_t pid;
+    int fd = iniparser_share(d), status;
+    CHECK(fd > -1);
+    if(fd < 0) return;
+    CHECK(write(fd, "x", 1) == -1); // sealed
+    CHECK(ftruncate(fd, 0) == -1);
+    if(!(pid = fork())){
+        s = iniparser_attach(fd);
+        _exit(!s || strcmp(iniparser_snapshot_getstring(s, "sec:key", ""), "value"));
+    }
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status));
+    close(fd);
+}
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0);
+    const dictsnap *s;
+    dictsnap_sec *sec;
+    uint32_t *idx, k;
+    size_t size;
+    char *mem, *copy;
+
+    CHECK(!dictionary_set(d, "top", "1"));
+    CHECK(!dictionary_set(d, "sec:key", "value"));
+    CHECK(!dictionary_set(d, "sec:other", "2"));
+    size = dictsnap_size(d);
+    CHECK(size > 0);
+    mem = malloc(size);
+    copy = malloc(size);
+    CHECK(dictsnap_build(d, mem, size) == (const dictsnap*)mem);
+    CHECK((s = dictsnap_map(mem, size)) != NULL);
+    CHECK_STR(dictsnap_get_n(s, "sec:key", 7, 0, NULL), "value");
+    CHECK(dictsnap_map(mem, size - 8) == NULL); // truncated
+
+    // offsets and lengths of keys and values
+    memcpy(copy, mem, size);
+    firstkv(copy, 1)->val = size + 100;
+    CHECK(dictsnap_map(copy, size) == NULL);
+    memcpy(copy, mem, size);
+    firstkv(copy, 1)->val = UINT64_MAX - 2;
+    CHECK(dictsnap_map(copy, size) == NULL);
+    memcpy(copy, mem, size);
+    firstkv(copy, 0)->key = size - 1; // zero at the end of block but key is longer
+    CHECK(dictsnap_map(copy, size) == NULL);
+    memcpy(copy, mem, size);
+    firstkv(copy, 1)->vlen = UINT32_MAX;
+    CHECK(dictsnap_map(copy, size) == NULL);
+    memcpy(copy, mem, size);
+    firstkv(copy, 1)->klen += 1; // string isn't terminated
+    CHECK(dictsnap_map(copy, size) == NULL);
+
+    // the same for file
+    CHECK(!dictsnap_write(d, SNAP));
+    CHECK((s = iniparser_snapshot_open(SNAP)) != NULL);
+    CHECK_STR(iniparser_snapshot_getstring(s, "sec:other", NULL), "2");
+    iniparser_snapshot_close(s);
+    memcpy(copy, mem, size);
+    firstkv(copy, 1)->key = size;
+    putbin(SNAP, copy, size);
+    CHECK(iniparser_snapshot_open(SNAP) == NULL);
+
+    // index without empty slots: lookup of missing key ends
+    memcpy(copy, mem, size);
+    sec = &secs(copy)[1];
+    idx = (uint32_t*)(copy + sec->idx);
+    for(k = 0; k < sec->idxsz; ++k) idx[k] = 1;
+    idx = (uint32_t*)(copy + ((dictsnap*)copy)->idx);
+    for(k = 0; k < ((dictsnap*)copy)->idxsz; ++k) idx[k] = 1;
+    CHECK((s = dictsnap_map(copy, size)) != NULL);
+    CHECK(dictsnap_get_n(s, "sec:missing", 11, 0, NULL) == NULL);
+    CHECK(dictsnap_get_n(s, "nosec:key", 9, 0, NULL) == NULL);
+
+    unlink(SNAP);
+    free(mem);
+    free(copy);
+    test_share(d);
+    dictionary_del(d);
+    test_cache();
+    TEST_END();
+}
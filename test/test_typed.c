@@ -0,0 +1,72 @@
+/* Cached typed values: changed by dictionary_set(), independent in clones */
+#include "dictrcu.h"
+#include "iniparser.h"
+#include "test.h"
+
+/** Flags of cached values of key */
+static unsigned vtype(const dictionary * d, const char * key)
+{
+    const keyval *kv = dictionary_getkv(d, key, NULL);
+    return kv ? kv->vtype : 0;
+}
+
+int main(void)
+{
+    dictionary *d = dictionary_new(0), *c;
+    const dictionary *v;
+    dictrcu *rc;
+    epoch_reader *r;
+
+    CHECK(!dictionary_set(d, "s:n", "10"));
+    CHECK(!dictionary_set(d, "s:b", "yes"));
+    CHECK(vtype(d, "s:n") == 0);
+    CHECK(iniparser_getint(d, "s:n", -1) == 10);
+    CHECK(iniparser_getdouble(d, "s:n", -1.) == 10.);
+    CHECK(iniparser_getboolean(d, "s:b", -1) == 1);
+    CHECK((vtype(d, "s:n") & (KV_LONG|KV_DOUBLE)) == (KV_LONG|KV_DOUBLE));
+    CHECK(vtype(d, "s:b") == (KV_BOOL|KV_TRUE));
+
+    // new value drops cache
+    CHECK(!dictionary_set(d, "s:n", "20"));
+    CHECK(!dictionary_set(d, "s:b", "no"));
+    CHECK(vtype(d, "s:n") == 0 && vtype(d, "s:b") == 0);
+    CHECK(iniparser_getint(d, "s:n", -1) == 20);
+    CHECK(iniparser_getdouble(d, "s:n", -1.) == 20.);
+    CHECK(iniparser_getboolean(d, "s:b", -1) == 0);
+    CHECK(!dictionary_set(d, "s:n", "bad"));
+    iniparser_getint(d, "s:n", -1);
+    CHECK(get_error() == INIPARSER_BAD_NUMBER);
+    CHECK(vtype(d, "s:n") & KV_LONGBAD);
+    CHECK(!dictionary_set(d, "s:n", "0x1e"));
+    CHECK(iniparser_getint(d, "s:n", -1) == 30 && get_error() == INIPARSER_NO_ERROR);
+
+    // clone: caches of copied sections don't affect each other
+    CHECK((c = dictionary_clone(d)) != NULL);
+    CHECK(iniparser_getint(c, "s:n", -1) == 30); // cached in shared section
+    CHECK(!dictionary_set(d, "s:n", "40"));
+    CHECK(iniparser_getint(d, "s:n", -1) == 40);
+    CHECK(iniparser_getint(c, "s:n", -1) == 30);
+    CHECK(!dictionary_set(c, "s:n", "50"));
+    CHECK(iniparser_getint(c, "s:n", -1) == 50);
+    CHECK(iniparser_getint(d, "s:n", -1) == 40);
+    CHECK(!dictionary_set(c, "s:b", "1")); // section of `c` isn't shared already
+    CHECK(iniparser_getboolean(c, "s:b", -1) == 1);
+    CHECK(iniparser_getboolean(d, "s:b", -1) == 0);
+    dictionary_del(c);
+    CHECK(iniparser_getint(d, "s:n", -1) == 40);
+
+    // new versions of dictrcu
+    CHECK((rc = dictrcu_new(d)) != NULL);
+    CHECK((r = dictrcu_reader_new(rc)) != NULL);
+    v = dictrcu_read_lock(rc, r);
+    CHECK(iniparser_getint(v, "s:n", -1) == 40);
+    CHECK(!dictrcu_set(rc, "s:n", "60"));
+    CHECK(iniparser_getint(v, "s:n", -1) == 40); // old version
+    dictrcu_read_unlock(r);
+    v = dictrcu_read_lock(rc, r);
+    CHECK(iniparser_getint(v, "s:n", -1) == 60);
+    dictrcu_read_unlock(r);
+    dictrcu_reader_del(r);
+    dictrcu_del(rc);
+    TEST_END();
+}
@@ -0,0 +1,95 @@
+/* Writer: what is written is loaded back, what can't be loaded back isn't written */
+#include <unistd.h>
+
+#include "iniparser.h"
+#include "test.h"
+
+/** Values which should be written and read back */
+static const char *good[] = {
+    "plain", "", "C:\\dir\\", "with space", " lead", "trail ", "a;b", "a#b", "x = y",
+    "\"q\"", "'q'", "\"\"", "''", "it's \"so\"", "\"half", "end\\\\", "\\", "tab\there", NULL
+};
+
+/** Values which can't be read back */
+static const char *bad[] = {
+    "both \" and ' ; comment", "'both\"", "line\nbreak", "both \" ' \\", NULL
+};
+
+int main(void)
+{
+    iniwriter *w;
+    dictionary *d;
+    char key[64], big[1100];
+    int i;
+
+    CHECK((w = iniwriter_open("tmp_write.ini")) != NULL);
+    for(i = 0; good[i]; ++i){
+        snprintf(key, sizeof(key), "good%d", i);
+        CHECK(!iniwriter_kv(w, key, good[i]));
+    }
+    CHECK(!iniwriter_kv(w, "after", "next line")); // isn't joined to value ending with backslash
+    for(i = 0; bad[i]; ++i){
+        snprintf(key, sizeof(key), "bad%d", i);
+        CHECK(iniwriter_kv(w, key, bad[i]) == -1);
+        CHECK(get_error() == INIPARSER_BAD_VALUE);
+    }
+    CHECK(iniwriter_kv(w, "k=v", "x") == -1);
+    CHECK(iniwriter_kv(w, "sec:key", "x") == -1);
+    CHECK(iniwriter_kv(w, "new\nline", "x") == -1);
+    CHECK(iniwriter_kv(w, "[key", "x]") == -1);
+    CHECK(iniwriter_kv(w, ";key", "x") == -1);
+    CHECK(iniwriter_kv(w, " key", "x") == -1);
+    CHECK(iniwriter_kv(w, "", "x") == -1);
+    memset(big, 'b', sizeof(big) - 1);
+    big[sizeof(big) - 1] = 0;
+    CHECK(iniwriter_kv(w, "big", big) == -1); // longer than line of parser
+    big[1023 - 34] = 0; // "big" padded to 30 columns, " = " and newline
+    CHECK(!iniwriter_kv(w, "big", big));
+    CHECK(iniwriter_section(w, "a]b") == -1);
+    CHECK(iniwriter_section(w, "a:b") == -1);
+    CHECK(iniwriter_section(w, "a\nb") == -1);
+    CHECK(iniwriter_section(w, "") == -1);
+    CHECK(!iniwriter_section(w, "sec"));
+    CHECK(!iniwriter_kv(w, "last", "C:\\dir\\"));
+    CHECK(!iniwriter_close(w));
+
+    d = iniparser_load("tmp_write.ini");
+    CHECK(d != NULL);
+    for(i = 0; good[i]; ++i){
+        snprintf(key, sizeof(key), "good%d", i);
+        CHECK_STR(iniparser_getstring(d, key, NULL), good[i]);
+    }
+    CHECK_STR(iniparser_getstring(d, "after", NULL), "next line");
+    CHECK_STR(iniparser_getstring(d, "big", NULL), big);
+    CHECK_STR(iniparser_getstring(d, "sec:last", NULL), "C:\\dir\\");
+    CHECK(iniparser_getnsec(d) == 1);
+    for(i = 0; bad[i]; ++i){
+        snprintf(key, sizeof(key), "bad%d", i);
+        CHECK(iniparser_getstring(d, key, NULL) == NULL);
+    }
+    iniparser_freedict(d);
+
+    // incremental save refuses the same values and keeps file
+    d = iniparser_load_tracked("tmp_write.ini");
+    CHECK(d != NULL);
+    CHECK(!dictionary_set(d, "good0", "C:\\other\\"));
+    CHECK(!dictionary_set(d, "sec:new", "a;b"));
+    CHECK(!dictionary_set(d, "sec:worse", bad[0]));
+    CHECK(iniparser_save_incremental(d) == -1);
+    CHECK(get_error() == INIPARSER_BAD_VALUE);
+    CHECK(!dictionary_set(d, "sec:worse", NULL));
+    CHECK(!dictionary_set(d, "new]sec:key", "x"));
+    CHECK(iniparser_save_incremental(d) == -1);
+    CHECK(!dictionary_set(d, "new]sec", NULL));
+    CHECK(!iniparser_save_incremental(d));
+    iniparser_freedict(d);
+    d = iniparser_load("tmp_write.ini");
+    CHECK_STR(iniparser_getstring(d, "good0", NULL), "C:\\other\\");
+    CHECK_STR(iniparser_getstring(d, "good1", NULL), "");
+    CHECK_STR(iniparser_getstring(d, "sec:new", NULL), "a;b");
+    CHECK(iniparser_getstring(d, "sec:worse", NULL) == NULL);
+    iniparser_freedict(d);
+
+    unlink("tmp_write.ini");
+    TEST_END();
+}